@@ -0,0 +1,135 @@
+#include "AsciiCase.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+inline std::uint64_t fold64(std::uint64_t x) {
+  return AsciiCase::lower_word(x);
+}
+
+inline std::uint64_t load64(const char* p) {
+  std::uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// The last n < 8 bytes, zero-padded.
+inline std::uint64_t load_tail(const char* p, size_t n) {
+  std::uint64_t v = 0;
+  std::memcpy(&v, p, n);
+  return v;
+}
+
+#ifdef __SSE2__
+inline __m128i fold128(__m128i v) {
+  const __m128i upper =
+      _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                    _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+  return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+#ifdef __AVX2__
+inline __m256i fold256(__m256i v) {
+  const __m256i upper =
+      _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+  return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+bool equal_folded(const char* a, const char* b, size_t n) {
+  size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = fold256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+    const __m256i y = fold256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1) return false;
+  }
+#endif
+#ifdef __SSE2__
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x =
+        fold128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m128i y =
+        fold128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return false;
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    if (fold64(load64(a + i)) != fold64(load64(b + i))) return false;
+  }
+  if (i < n) {
+    return fold64(load_tail(a + i, n - i)) == fold64(load_tail(b + i, n - i));
+  }
+  return true;
+}
+}  // namespace
+
+namespace AsciiCase {
+bool equals(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && equal_folded(a.data(), b.data(), a.size());
+}
+
+bool ends_with(std::string_view text, std::string_view suffix) {
+  return text.size() >= suffix.size() &&
+         equal_folded(text.data() + text.size() - suffix.size(), suffix.data(),
+                      suffix.size());
+}
+
+std::uint64_t hash(std::string_view text) {
+  const char* p = text.data();
+  size_t n = text.size();
+  std::uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+  for (; n >= 8; p += 8, n -= 8) {
+    h = (h ^ fold64(load64(p))) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+  }
+  if (n > 0) {
+    h = (h ^ fold64(load_tail(p, n))) * 0xBF58476D1CE4E5B9ull;
+  }
+  // Final avalanche, as in MurmurHash3's fmix64.
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+void lower(std::string_view text, char* out) {
+  const char* in = text.data();
+  const size_t n = text.size();
+  size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        fold256(_mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(in + i))));
+  }
+#endif
+#ifdef __SSE2__
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(out + i),
+        fold128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    const std::uint64_t v = fold64(load64(in + i));
+    std::memcpy(out + i, &v, sizeof(v));
+  }
+  if (i < n) {
+    const std::uint64_t v = fold64(load_tail(in + i, n - i));
+    std::memcpy(out + i, &v, n - i);
+  }
+}
+}  // namespace AsciiCase
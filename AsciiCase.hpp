@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// ASCII case-insensitive string kernels. Only 'A'-'Z' are folded; every
+// other byte, including UTF-8 sequences, must match exactly. Nothing here
+// allocates: comparisons run 16 or 32 bytes at a time with SSE2/AVX2 where
+// the build targets them, and hashing folds eight bytes per step.
+namespace AsciiCase {
+bool equals(std::string_view a, std::string_view b);
+bool ends_with(std::string_view text, std::string_view suffix);
+// Equal for strings that differ only in ASCII case.
+std::uint64_t hash(std::string_view text);
+// Writes the lowercase form of `text` to `out`, which holds text.size()
+// bytes and may be text.data() itself.
+void lower(std::string_view text, char* out);
+
+// Lowercases eight bytes packed into a word. Adding to the low seven bits of
+// each byte never carries into the next byte, and bytes with the high bit set
+// are excluded, so only 'A'-'Z' change.
+inline std::uint64_t lower_word(std::uint64_t x) {
+  constexpr std::uint64_t kOnes = 0x0101010101010101ull;
+  constexpr std::uint64_t kHighBits = 0x8080808080808080ull;
+  const std::uint64_t low = x & ~kHighBits;
+  const std::uint64_t at_least_a = low + (0x80 - 'A') * kOnes;
+  const std::uint64_t above_z = low + (0x80 - 'Z' - 1) * kOnes;
+  const std::uint64_t upper = at_least_a & ~above_z & ~x & kHighBits;
+  return x | (upper >> 2);
+}
+
+// Heterogeneous hash and equality, so that containers keyed by std::string
+// can be probed with a string_view in any case.
+struct Hash {
+  using is_transparent = void;
+  size_t operator()(std::string_view text) const {
+    return static_cast<size_t>(hash(text));
+  }
+};
+struct Equal {
+  using is_transparent = void;
+  bool operator()(std::string_view a, std::string_view b) const {
+    return equals(a, b);
+  }
+};
+
+using Set = std::unordered_set<std::string, Hash, Equal>;
+template <typename Value>
+using Map = std::unordered_map<std::string, Value, Hash, Equal>;
+}  // namespace AsciiCase
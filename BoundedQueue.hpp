@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// A multi-producer, multi-consumer FIFO holding at most `capacity` items.
+// Producers never block: try_push() fails when the queue is full, so that a
+// producer can do a consumer's work instead of waiting for one that may not
+// be running. Consumers wait in pop() until an item arrives or the queue is
+// closed.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : m_capacity(capacity) {}
+
+  // Leaves `item` untouched and returns false if the queue is full.
+  bool try_push(T& item) {
+    {
+      std::scoped_lock lock(m_mutex);
+      if (m_items.size() >= m_capacity) return false;
+      m_items.push_back(std::move(item));
+    }
+    m_ready.notify_one();
+    return true;
+  }
+
+  std::optional<T> try_pop() {
+    std::scoped_lock lock(m_mutex);
+    return pop_locked();
+  }
+
+  // Returns std::nullopt once the queue is closed and empty.
+  std::optional<T> pop() {
+    std::unique_lock lock(m_mutex);
+    m_ready.wait(lock, [&] { return m_closed || !m_items.empty(); });
+    return pop_locked();
+  }
+
+  // Wakes every waiting consumer; items already queued can still be popped.
+  void close() {
+    {
+      std::scoped_lock lock(m_mutex);
+      m_closed = true;
+    }
+    m_ready.notify_all();
+  }
+
+ private:
+  std::optional<T> pop_locked() {
+    if (m_items.empty()) return std::nullopt;
+    T item = std::move(m_items.front());
+    m_items.pop_front();
+    return item;
+  }
+
+  const size_t m_capacity;
+  std::mutex m_mutex;
+  std::condition_variable m_ready;
+  std::deque<T> m_items;
+  bool m_closed = false;
+};
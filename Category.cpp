@@ -0,0 +1,45 @@
+#include "Category.hpp"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+struct Registry {
+  std::shared_mutex mutex;
+  // A deque, so that interning never moves the names already handed out.
+  std::deque<std::string> names{std::string()};
+  std::unordered_map<std::string_view, std::uint32_t> ids{{"", 0}};
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+}  // namespace
+
+Category Category::intern(std::string_view name) {
+  if (name.empty()) return {};
+  Registry& r = registry();
+  {
+    std::shared_lock lock(r.mutex);
+    if (auto it = r.ids.find(name); it != r.ids.end()) {
+      return Category(it->second);
+    }
+  }
+  std::unique_lock lock(r.mutex);
+  if (auto it = r.ids.find(name); it != r.ids.end()) {
+    return Category(it->second);
+  }
+  const auto id = static_cast<std::uint32_t>(r.names.size());
+  // The key views the stored copy, not the caller's string.
+  r.ids.emplace(r.names.emplace_back(name), id);
+  return Category(id);
+}
+
+const std::string& Category::name() const {
+  Registry& r = registry();
+  std::shared_lock lock(r.mutex);
+  return r.names[m_id];
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// An interned category name. A process sees only a handful of categories, so
+// each plan entry carries a 32-bit id instead of its own copy of the name.
+// Names are interned once and stay valid for the life of the process; the
+// default Category is the empty name.
+class Category {
+ public:
+  Category() = default;
+
+  // Thread-safe. Returns the same id for equal names.
+  static Category intern(std::string_view name);
+
+  const std::string& name() const;
+  std::uint32_t id() const { return m_id; }
+  bool empty() const { return m_id == 0; }
+
+  friend bool operator==(Category, Category) = default;
+
+ private:
+  explicit Category(std::uint32_t id) : m_id(id) {}
+
+  std::uint32_t m_id = 0;
+};
@@ -0,0 +1,273 @@
+#include "ContentSniffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Signatures are matched against this many leading bytes at once.
+constexpr size_t kWindow = 16;
+
+struct Part {
+  std::uint32_t offset = 0;
+  std::string_view bytes;
+  constexpr size_t end() const { return offset + bytes.size(); }
+};
+
+struct Signature {
+  std::string_view extension;
+  Part first;
+  Part second = {};
+};
+
+using namespace std::string_view_literals;
+
+// Ordered from most to least specific; the first match wins.
+constexpr std::array kSignatures = {
+    Signature{".pdf", {0, "%PDF-"sv}},
+    Signature{".png", {0, "\x89PNG\r\n\x1A\n"sv}},
+    Signature{".jpg", {0, "\xFF\xD8\xFF"sv}},
+    Signature{".gif", {0, "GIF87a"sv}},
+    Signature{".gif", {0, "GIF89a"sv}},
+    Signature{".webp", {0, "RIFF"sv}, {8, "WEBP"sv}},
+    Signature{".wav", {0, "RIFF"sv}, {8, "WAVE"sv}},
+    Signature{".avi", {0, "RIFF"sv}, {8, "AVI "sv}},
+    Signature{".zip", {0, "PK\x03\x04"sv}},
+    Signature{".7z", {0, "7z\xBC\xAF\x27\x1C"sv}},
+    Signature{".rar", {0, "Rar!\x1A\x07"sv}},
+    Signature{".gz", {0, "\x1F\x8B\x08"sv}},
+    Signature{".deb", {0, "!<arch>\ndebian"sv}},
+    Signature{".exe", {0, "\x7F" "ELF"sv}},
+    Signature{".exe", {0, "MZ"sv}},
+    Signature{".mov", {4, "ftypqt  "sv}},
+    Signature{".mp4", {4, "ftyp"sv}},
+    Signature{".mkv", {0, "\x1A\x45\xDF\xA3"sv}},
+    Signature{".mp3", {0, "ID3"sv}},
+    Signature{".flac", {0, "fLaC"sv}},
+    Signature{".ogg", {0, "OggS"sv}},
+    Signature{".woff2", {0, "wOF2"sv}},
+    Signature{".woff", {0, "wOFF"sv}},
+    Signature{".otf", {0, "OTTO"sv}},
+    Signature{".ttf", {0, "\x00\x01\x00\x00\x00"sv}},
+    Signature{".db", {0, "SQLite format 3\x00"sv}},
+    Signature{".tar", {257, "ustar"sv}},
+    Signature{".iso", {0x8001, "CD001"sv}},
+};
+
+// The signatures that fit in the first kWindow bytes, as pattern and mask
+// pairs, so that each is checked with one masked 16-byte comparison.
+struct WindowTable {
+  struct alignas(16) Entry {
+    std::array<unsigned char, kWindow> pattern{};
+    std::array<unsigned char, kWindow> mask{};
+  };
+  std::array<Entry, kSignatures.size()> entries{};
+  // Index into kSignatures for each entry, and bytes the header must have.
+  std::array<std::uint8_t, kSignatures.size()> signature{};
+  std::array<std::uint8_t, kSignatures.size()> min_size{};
+  size_t count = 0;
+};
+
+constexpr bool fits_window(const Signature& sig) {
+  return sig.first.end() <= kWindow && sig.second.end() <= kWindow;
+}
+
+const WindowTable& window_table() {
+  static const WindowTable table = [] {
+    WindowTable t;
+    for (size_t i = 0; i < kSignatures.size(); ++i) {
+      const Signature& sig = kSignatures[i];
+      if (!fits_window(sig)) continue;
+      auto& entry = t.entries[t.count];
+      for (const Part& part : {sig.first, sig.second}) {
+        for (size_t b = 0; b < part.bytes.size(); ++b) {
+          entry.pattern[part.offset + b] =
+              static_cast<unsigned char>(part.bytes[b]);
+          entry.mask[part.offset + b] = 0xFF;
+        }
+      }
+      t.signature[t.count] = static_cast<std::uint8_t>(i);
+      t.min_size[t.count] = static_cast<std::uint8_t>(
+          std::max(sig.first.end(), sig.second.end()));
+      t.count++;
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Returns the index of the first window signature matching `window`, or -1.
+int match_window(const unsigned char* window, size_t size) {
+  const WindowTable& table = window_table();
+#ifdef __SSE2__
+  const __m128i bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(window));
+  for (size_t i = 0; i < table.count; ++i) {
+    const auto& entry = table.entries[i];
+    const __m128i masked = _mm_and_si128(
+        bytes, _mm_load_si128(reinterpret_cast<const __m128i*>(
+                   entry.mask.data())));
+    const __m128i equal = _mm_cmpeq_epi8(
+        masked, _mm_load_si128(reinterpret_cast<const __m128i*>(
+                    entry.pattern.data())));
+    if (_mm_movemask_epi8(equal) == 0xFFFF && size >= table.min_size[i]) {
+      return table.signature[i];
+    }
+  }
+#else
+  std::uint64_t words[2];
+  std::memcpy(words, window, kWindow);
+  for (size_t i = 0; i < table.count; ++i) {
+    const auto& entry = table.entries[i];
+    std::uint64_t pattern[2], mask[2];
+    std::memcpy(pattern, entry.pattern.data(), kWindow);
+    std::memcpy(mask, entry.mask.data(), kWindow);
+    if ((words[0] & mask[0]) == pattern[0] &&
+        (words[1] & mask[1]) == pattern[1] && size >= table.min_size[i]) {
+      return table.signature[i];
+    }
+  }
+#endif
+  return -1;
+}
+
+bool contains(std::span<const unsigned char> header, std::string_view text) {
+  const std::string_view haystack(reinterpret_cast<const char*>(header.data()),
+                                  header.size());
+  return haystack.find(text) != std::string_view::npos;
+}
+
+// Narrows containers and weak signatures using more of the header.
+std::string_view refine(std::string_view extension,
+                        std::span<const unsigned char> header) {
+  if (extension == ".zip") {
+    if (contains(header, "mimetypeapplication/epub+zip")) return ".epub";
+    if (contains(header, "[Content_Types].xml")) {
+      if (contains(header, "word/")) return ".docx";
+      if (contains(header, "xl/")) return ".xlsx";
+      if (contains(header, "ppt/")) return ".pptx";
+    }
+  } else if (extension == ".mkv") {
+    if (contains(header, "webm")) return ".webm";
+  } else if (extension == ".exe" && header[0] == 'M') {
+    // "MZ" alone is too weak; require the PE header it points to.
+    if (header.size() < 0x40) return {};
+    std::uint32_t pe_offset = 0;
+    std::memcpy(&pe_offset, header.data() + 0x3C, sizeof(pe_offset));
+    if (pe_offset > header.size() - 4 ||
+        std::memcmp(header.data() + pe_offset, "PE\0\0", 4) != 0) {
+      return {};
+    }
+  }
+  return extension;
+}
+
+bool part_matches(const Part& part, std::span<const unsigned char> bytes) {
+  return part.bytes.empty() ||
+         (part.end() <= bytes.size() &&
+          std::memcmp(bytes.data() + part.offset, part.bytes.data(),
+                      part.bytes.size()) == 0);
+}
+
+#ifndef _WIN32
+// Matches the header read from `fd`, then the signatures beyond it.
+std::string_view sniff_fd(int fd) {
+  std::array<unsigned char, ContentSniffer::kHeaderSize> header;
+  const ssize_t got = ::pread(fd, header.data(), header.size(), 0);
+  if (got <= 0) return {};
+  const std::span<const unsigned char> bytes(header.data(),
+                                             static_cast<size_t>(got));
+  if (auto extension = ContentSniffer::match(bytes); !extension.empty()) {
+    return extension;
+  }
+
+  for (const Signature& sig : kSignatures) {
+    if (sig.first.end() <= ContentSniffer::kHeaderSize) continue;
+    std::array<char, kWindow> probe;
+    const size_t length = sig.first.bytes.size();
+    if (::pread(fd, probe.data(), length, sig.first.offset) ==
+            static_cast<ssize_t>(length) &&
+        std::memcmp(probe.data(), sig.first.bytes.data(), length) == 0) {
+      return sig.extension;
+    }
+  }
+  return {};
+}
+#endif
+}  // namespace
+
+namespace ContentSniffer {
+std::string_view match(std::span<const unsigned char> header) {
+  if (header.empty()) return {};
+
+  std::array<unsigned char, kWindow> window{};
+  std::memcpy(window.data(), header.data(),
+              std::min(header.size(), window.size()));
+  if (const int index = match_window(window.data(), header.size());
+      index >= 0) {
+    const std::string_view extension =
+        refine(kSignatures[static_cast<size_t>(index)].extension, header);
+    if (!extension.empty()) return extension;
+  }
+
+  // Signatures further into the header, checked directly.
+  for (const Signature& sig : kSignatures) {
+    if (fits_window(sig) || sig.first.end() > kHeaderSize) continue;
+    if (part_matches(sig.first, header) && part_matches(sig.second, header)) {
+      return sig.extension;
+    }
+  }
+  return {};
+}
+
+std::string_view sniff(const fs::path& path) {
+#ifdef _WIN32
+  std::ifstream in(path, std::ios::binary);
+  std::array<unsigned char, kHeaderSize> header;
+  in.read(reinterpret_cast<char*>(header.data()), kHeaderSize);
+  return match({header.data(), static_cast<size_t>(in.gcount())});
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return {};
+  const std::string_view extension = sniff_fd(fd);
+  ::close(fd);
+  return extension;
+#endif
+}
+
+std::vector<std::string_view> sniff_batch(std::span<const fs::path> paths) {
+  std::vector<std::string_view> results(paths.size());
+#ifdef _WIN32
+  for (size_t i = 0; i < paths.size(); ++i) results[i] = sniff(paths[i]);
+#else
+  std::vector<int> fds(paths.size(), -1);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    fds[i] = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef POSIX_FADV_WILLNEED
+    if (fds[i] >= 0) {
+      ::posix_fadvise(fds[i], 0, kHeaderSize, POSIX_FADV_WILLNEED);
+    }
+#endif
+  }
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (fds[i] < 0) continue;
+    results[i] = sniff_fd(fds[i]);
+    ::close(fds[i]);
+  }
+#endif
+  return results;
+}
+}  // namespace ContentSniffer
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "types.hpp"
+
+// Recognizes common file types from their leading bytes, for files whose
+// extension is missing or unknown. A type is reported as its usual extension
+// (".pdf", ".docx", ...), so that it maps to a category through the same
+// table as real extensions. Stateless and safe to call from any thread.
+namespace ContentSniffer {
+// Bytes read from the start of each file.
+constexpr size_t kHeaderSize = 4096;
+
+// Returns the extension of the type whose signature matches `header`, or an
+// empty view. Signatures beyond the header (e.g. ISO 9660) are not checked.
+std::string_view match(std::span<const unsigned char> header);
+
+// Reads the start of `path` and matches it, including signatures beyond the
+// header. Returns an empty view if nothing matched or the file is unreadable.
+std::string_view sniff(const fs::path& path);
+
+// Sniffs several files. On POSIX all of them are opened and their headers
+// requested with readahead before the first one is read, so that the reads
+// overlap instead of paying one round trip per file.
+std::vector<std::string_view> sniff_batch(std::span<const fs::path> paths);
+}  // namespace ContentSniffer
@@ -0,0 +1,619 @@
+#include "CrossDevice.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "IOManager.hpp"
+#include "StreamHash.hpp"
+#include "WorkerPool.hpp"
+#include "utils.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+#include <stdio.h>
+#include <sys/sendfile.h>
+#include <sys/xattr.h>
+#endif
+
+namespace CrossDevice {
+namespace {
+Options g_options;
+// Numbers the temporary names; a name taken by another process is skipped.
+std::atomic<unsigned> g_next_temp = 0;
+constexpr int kMaxTempAttempts = 64;
+// Buffer of the read/write copy and of verification.
+constexpr size_t kBufferSize = size_t{1} << 20;
+
+fs::path temp_name(const fs::path& dir) {
+  return dir / std::format(".organizer-copy-{}", g_next_temp.fetch_add(1));
+}
+
+#ifndef _WIN32
+std::error_code last_error() { return {errno, std::generic_category()}; }
+
+class Fd {
+ public:
+  explicit Fd(int fd = -1) : m_fd(fd) {}
+  Fd(const Fd&) = delete;
+  Fd& operator=(const Fd&) = delete;
+  ~Fd() { reset(); }
+
+  void reset(int fd = -1) {
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = fd;
+  }
+  int get() const { return m_fd; }
+  bool ok() const { return m_fd >= 0; }
+
+ private:
+  int m_fd;
+};
+
+SourceEntry source_entry(const fs::path& path, const struct stat& st) {
+  return {path,
+          static_cast<std::uint64_t>(st.st_dev),
+          static_cast<std::uint64_t>(st.st_ino),
+          static_cast<std::uint32_t>(st.st_mode),
+          static_cast<std::int64_t>(st.st_size),
+          static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+              st.st_mtim.tv_nsec};
+}
+
+// Whether `now` is still the entry that was copied, with the same contents.
+// A directory's contents are its listing, which is checked separately.
+bool same_entry(const SourceEntry& copied, const struct stat& st) {
+  const SourceEntry now = source_entry(copied.path, st);
+  if (now.dev != copied.dev || now.ino != copied.ino ||
+      (now.mode & S_IFMT) != (copied.mode & S_IFMT)) {
+    return false;
+  }
+  return S_ISDIR(now.mode) ||
+         (now.size == copied.size && now.mtime_ns == copied.mtime_ns);
+}
+
+// Returns the first entry of the source that is not as it was copied: one
+// that changed, went away, or was added to a copied directory.
+std::optional<fs::path> changed_source(
+    const std::vector<SourceEntry>& sources) {
+  std::unordered_set<std::string> copied;
+  for (const auto& entry : sources) copied.insert(entry.path.native());
+  for (const auto& entry : sources) {
+    struct stat st {};
+    if (::lstat(entry.path.c_str(), &st) != 0 || !same_entry(entry, st)) {
+      return entry.path;
+    }
+    if (!S_ISDIR(st.st_mode)) continue;
+    std::error_code ec;
+    for (fs::directory_iterator it(entry.path, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      if (!copied.contains(it->path().native())) return it->path();
+    }
+    if (ec) return entry.path;
+  }
+  return std::nullopt;
+}
+
+#ifdef __linux__
+// Errors of a first zero-copy call that mean the method does not work for
+// this pair of filesystems, as opposed to a failing disk.
+bool unsupported(const std::error_code& ec) {
+  const int e = ec.value();
+  return e == EXDEV || e == EINVAL || e == ENOSYS || e == EOPNOTSUPP;
+}
+#endif
+
+// Copies `length` bytes at `offset` from `in` to the same offset of `out`.
+std::error_code copy_range(int in, int out, std::uint64_t offset,
+                           std::uint64_t length, MoveMethod method) {
+#ifdef __linux__
+  if (method == MoveMethod::CopyFileRange) {
+    loff_t in_offset = static_cast<loff_t>(offset);
+    loff_t out_offset = in_offset;
+    while (length > 0) {
+      const ssize_t n = ::copy_file_range(in, &in_offset, out, &out_offset,
+                                          length, 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) return last_error();
+      // The source shrank while it was being copied.
+      if (n == 0) return std::make_error_code(std::errc::io_error);
+      length -= static_cast<std::uint64_t>(n);
+    }
+    return {};
+  }
+  if (method == MoveMethod::Sendfile) {
+    // sendfile() writes at the file offset of `out`, so ranges of one file
+    // cannot be copied concurrently with it.
+    off_t in_offset = static_cast<off_t>(offset);
+    if (::lseek(out, in_offset, SEEK_SET) < 0) return last_error();
+    while (length > 0) {
+      const ssize_t n = ::sendfile(
+          out, in, &in_offset, std::min<std::uint64_t>(length, 1u << 30));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) return last_error();
+      if (n == 0) return std::make_error_code(std::errc::io_error);
+      length -= static_cast<std::uint64_t>(n);
+    }
+    return {};
+  }
+#endif
+  std::vector<unsigned char> buffer(std::min<std::uint64_t>(length,
+                                                            kBufferSize));
+  while (length > 0) {
+    const ssize_t n =
+        ::pread(in, buffer.data(), std::min<std::uint64_t>(length,
+                                                           buffer.size()),
+                static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return last_error();
+    if (n == 0) return std::make_error_code(std::errc::io_error);
+    for (ssize_t done = 0; done < n;) {
+      const ssize_t w = ::pwrite(out, buffer.data() + done,
+                                 static_cast<size_t>(n - done),
+                                 static_cast<off_t>(offset) + done);
+      if (w < 0 && errno == EINTR) continue;
+      if (w < 0) return last_error();
+      done += w;
+    }
+    offset += static_cast<std::uint64_t>(n);
+    length -= static_cast<std::uint64_t>(n);
+  }
+  return {};
+}
+
+std::error_code hash_range(int fd, std::uint64_t offset, std::uint64_t length,
+                           std::uint64_t& digest) {
+  StreamHash64 hasher;
+  std::vector<unsigned char> buffer(std::min<std::uint64_t>(length,
+                                                            kBufferSize));
+  while (length > 0) {
+    const ssize_t n =
+        ::pread(fd, buffer.data(), std::min<std::uint64_t>(length,
+                                                           buffer.size()),
+                static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return last_error();
+    if (n == 0) return std::make_error_code(std::errc::io_error);
+    hasher.update({buffer.data(), static_cast<size_t>(n)});
+    offset += static_cast<std::uint64_t>(n);
+    length -= static_cast<std::uint64_t>(n);
+  }
+  digest = hasher.digest();
+  return {};
+}
+
+// Calls `fn(offset, length)` for the chunks of [begin, end) on up to
+// `max_chunk_workers` threads. Stops handing out chunks after the first
+// error, which is returned.
+template <typename F>
+std::error_code for_each_chunk(std::uint64_t begin, std::uint64_t end,
+                               F&& fn) {
+  const std::uint64_t chunk = std::max<std::uint64_t>(g_options.chunk_size,
+                                                      kBufferSize);
+  const size_t chunks = static_cast<size_t>((end - begin + chunk - 1) / chunk);
+  std::stop_source stop;
+  std::mutex mutex;
+  std::error_code first_error;
+  WorkerPool::shared().for_each_index(
+      PoolLane::Io, chunks,
+      [&](size_t i) {
+        const std::uint64_t offset = begin + i * chunk;
+        const std::error_code ec = fn(offset, std::min(chunk, end - offset));
+        if (!ec) return;
+        std::scoped_lock lock(mutex);
+        if (!first_error) first_error = ec;
+        stop.request_stop();
+      },
+      stop.get_token(), std::max(1u, g_options.max_chunk_workers));
+  return first_error;
+}
+
+// Copies the first chunk with the fastest method that works for this pair
+// of files, then the remaining chunks with that method, in parallel unless
+// it is sendfile().
+std::error_code copy_contents(int in, int out, std::uint64_t size,
+                              MoveMethod& method) {
+  const std::uint64_t first = std::min(
+      size, std::max<std::uint64_t>(g_options.chunk_size, kBufferSize));
+  method = MoveMethod::Buffered;
+#ifdef __linux__
+  // Reserving the space up front keeps chunks written out of order from
+  // fragmenting the file. Not every filesystem supports it.
+  if (size > first) (void)::fallocate(out, 0, 0, static_cast<off_t>(size));
+  for (MoveMethod candidate :
+       {MoveMethod::CopyFileRange, MoveMethod::Sendfile}) {
+    const std::error_code ec = copy_range(in, out, 0, first, candidate);
+    if (!ec) {
+      method = candidate;
+      break;
+    }
+    if (!unsupported(ec)) return ec;
+  }
+#endif
+  if (method == MoveMethod::Buffered) {
+    if (auto ec = copy_range(in, out, 0, first, method)) return ec;
+  }
+  if (size == first) return {};
+  if (method == MoveMethod::Sendfile) {
+    return copy_range(in, out, first, size - first, method);
+  }
+  return for_each_chunk(first, size,
+                        [&](std::uint64_t offset, std::uint64_t length) {
+                          return copy_range(in, out, offset, length, method);
+                        });
+}
+
+// Reads the copy back, from the disk rather than the page cache where the
+// kernel allows it, and compares it with the source chunk by chunk.
+std::error_code verify_contents(int in, int out, std::uint64_t size) {
+#ifdef __linux__
+  (void)::posix_fadvise(out, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+  return for_each_chunk(
+      0, size, [&](std::uint64_t offset, std::uint64_t length) {
+        std::uint64_t expected = 0;
+        std::uint64_t actual = 0;
+        if (auto ec = hash_range(in, offset, length, expected)) return ec;
+        if (auto ec = hash_range(out, offset, length, actual)) return ec;
+        return expected == actual
+                   ? std::error_code{}
+                   : std::make_error_code(std::errc::io_error);
+      });
+}
+
+#ifdef __linux__
+// Best effort, like `cp -p`: attributes the destination filesystem or the
+// user's privileges do not allow are left out.
+void copy_xattrs(int in, int out) {
+  ssize_t size = ::flistxattr(in, nullptr, 0);
+  if (size <= 0) return;
+  std::string names(static_cast<size_t>(size), '\0');
+  size = ::flistxattr(in, names.data(), names.size());
+  if (size <= 0) return;
+  names.resize(static_cast<size_t>(size));
+  std::vector<char> value;
+  for (size_t pos = 0; pos < names.size();) {
+    const char* name = names.c_str() + pos;
+    pos += std::strlen(name) + 1;
+    ssize_t length = ::fgetxattr(in, name, nullptr, 0);
+    if (length < 0) continue;
+    value.resize(static_cast<size_t>(length));
+    length = ::fgetxattr(in, name, value.data(), value.size());
+    if (length < 0) continue;
+    (void)::fsetxattr(out, name, value.data(), static_cast<size_t>(length), 0);
+  }
+}
+#endif
+
+// Gives `out` the owner, permissions, extended attributes and timestamps of
+// the source. Changing the owner needs privileges; without them the copy
+// belongs to the user and loses its set-user-ID and set-group-ID bits.
+std::error_code copy_metadata(int in, int out, const struct stat& st) {
+  mode_t mode = st.st_mode & 07777;
+  if (::fchown(out, st.st_uid, st.st_gid) != 0) mode &= ~mode_t{06000};
+  if (::fchmod(out, mode) != 0) return last_error();
+#ifdef __linux__
+  copy_xattrs(in, out);
+#else
+  (void)in;
+#endif
+  const struct timespec times[2] = {st.st_atim, st.st_mtim};
+  if (::futimens(out, times) != 0) return last_error();
+  return {};
+}
+
+std::error_code copy_file(const fs::path& from, int in, const struct stat& st,
+                          int out, MoveMethod& method) {
+  const auto size = static_cast<std::uint64_t>(st.st_size);
+  if (auto ec = copy_contents(in, out, size, method)) return ec;
+  if (auto ec = copy_metadata(in, out, st)) {
+    IOManager::log(LogLevel::Warning,
+                   std::format("Could not keep the attributes of '{}': {}",
+                               safe_path_to_string(from), ec.message()));
+  }
+  if (::fsync(out) != 0) return last_error();
+  if (g_options.verify) {
+    if (auto ec = verify_contents(in, out, size)) {
+      IOManager::log(LogLevel::Error,
+                     std::format("Copy of '{}' does not match the source",
+                                 safe_path_to_string(from)));
+      return ec;
+    }
+  }
+  // A download still being written must stay where it is, whole; the
+  // staged copy is dropped.
+  struct stat now {};
+  if (::fstat(in, &now) != 0) return last_error();
+  if (now.st_size != st.st_size || now.st_ino != st.st_ino ||
+      now.st_dev != st.st_dev || now.st_mtim.tv_sec != st.st_mtim.tv_sec ||
+      now.st_mtim.tv_nsec != st.st_mtim.tv_nsec) {
+    IOManager::log(LogLevel::Warning,
+                   std::format("'{}' changed while it was copied; left in "
+                               "place.",
+                               safe_path_to_string(from)));
+    return std::make_error_code(std::errc::device_or_resource_busy);
+  }
+  return {};
+}
+
+// Copies the contents of the directory `from`, open as `in`, into the new
+// directory `to`, then gives `to` the metadata of `from`. Sets `method` to
+// the slowest method used for a file, and adds each copied entry to
+// `sources` with the stat taken before it was copied.
+std::error_code copy_tree(const fs::path& from, int in, const struct stat& st,
+                          const fs::path& to, MoveMethod& method,
+                          std::vector<SourceEntry>& sources) {
+  std::error_code ec;
+  for (fs::directory_iterator it(from, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    const fs::path source = it->path();
+    const fs::path target = to / source.filename();
+    struct stat child {};
+    if (::lstat(source.c_str(), &child) != 0) return last_error();
+    sources.push_back(source_entry(source, child));
+
+    if (S_ISLNK(child.st_mode)) {
+      fs::copy_symlink(source, target, ec);
+      if (ec) return ec;
+      (void)::lchown(target.c_str(), child.st_uid, child.st_gid);
+      const struct timespec times[2] = {child.st_atim, child.st_mtim};
+      (void)::utimensat(AT_FDCWD, target.c_str(), times, AT_SYMLINK_NOFOLLOW);
+      continue;
+    }
+    const bool is_dir = S_ISDIR(child.st_mode);
+    if (!is_dir && !S_ISREG(child.st_mode)) {
+      return std::make_error_code(std::errc::not_supported);
+    }
+    Fd child_in(::open(source.c_str(),
+                       O_RDONLY | O_CLOEXEC | O_NOFOLLOW |
+                           (is_dir ? O_DIRECTORY : 0)));
+    if (!child_in.ok()) return last_error();
+    if (is_dir) {
+      if (::mkdir(target.c_str(), 0700) != 0) return last_error();
+      ec = copy_tree(source, child_in.get(), child, target, method, sources);
+    } else {
+      Fd child_out(::open(target.c_str(),
+                          O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+      if (!child_out.ok()) return last_error();
+      MoveMethod file_method = MoveMethod::Buffered;
+      ec = copy_file(source, child_in.get(), child, child_out.get(),
+                     file_method);
+      method = std::max(method, file_method);
+    }
+    if (ec) return ec;
+  }
+  if (ec) return ec;
+
+  Fd out(::open(to.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  if (!out.ok()) return last_error();
+  if (auto meta = copy_metadata(in, out.get(), st)) {
+    IOManager::log(LogLevel::Warning,
+                   std::format("Could not keep the attributes of '{}': {}",
+                               safe_path_to_string(from), meta.message()));
+  }
+  if (::fsync(out.get()) != 0) return last_error();
+  return {};
+}
+
+void sync_directory(const fs::path& dir) {
+  Fd fd(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  if (fd.ok()) (void)::fsync(fd.get());
+}
+#endif
+
+// Renames without replacing an existing `to`; fails with errc::file_exists.
+std::error_code rename_noreplace(const fs::path& from, const fs::path& to) {
+#ifdef __linux__
+  if (::renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(),
+                  RENAME_NOREPLACE) == 0) {
+    return {};
+  }
+  if (errno != EINVAL && errno != ENOSYS) return last_error();
+#endif
+  std::error_code ec;
+  if (fs::exists(fs::symlink_status(to, ec))) {
+    return std::make_error_code(std::errc::file_exists);
+  }
+  fs::rename(from, to, ec);
+  return ec;
+}
+}  // namespace
+
+void configure(Options options) { g_options = options; }
+
+const Options& options() { return g_options; }
+
+std::optional<StagedCopy> StagedCopy::create(const fs::path& from,
+                                             const fs::path& dir,
+                                             std::error_code& ec) {
+  ec.clear();
+#ifndef _WIN32
+  struct stat st {};
+  if (::lstat(from.c_str(), &st) != 0) {
+    ec = last_error();
+    return std::nullopt;
+  }
+  const bool is_dir = S_ISDIR(st.st_mode);
+  if (!is_dir && !S_ISREG(st.st_mode)) {
+    ec = std::make_error_code(std::errc::not_supported);
+    return std::nullopt;
+  }
+  Fd in(::open(from.c_str(),
+               O_RDONLY | O_CLOEXEC | O_NOFOLLOW | (is_dir ? O_DIRECTORY : 0)));
+  if (!in.ok()) {
+    ec = last_error();
+    return std::nullopt;
+  }
+
+  fs::path temp;
+  Fd out;
+  for (int attempt = 0;; ++attempt) {
+    temp = temp_name(dir);
+    if (is_dir) {
+      if (::mkdir(temp.c_str(), 0700) == 0) break;
+    } else {
+      out.reset(::open(temp.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+                       0600));
+      if (out.ok()) break;
+    }
+    if (errno != EEXIST || attempt + 1 == kMaxTempAttempts) {
+      ec = last_error();
+      return std::nullopt;
+    }
+  }
+
+  // Removes the partial copy if anything below fails.
+  StagedCopy staged(from, temp, MoveMethod::CopyFileRange);
+  staged.m_sources.push_back(source_entry(from, st));
+  ec = is_dir ? copy_tree(from, in.get(), st, temp, staged.m_method,
+                          staged.m_sources)
+              : copy_file(from, in.get(), st, out.get(), staged.m_method);
+  if (ec) return std::nullopt;
+  return staged;
+#else
+  fs::path temp = temp_name(dir);
+  for (int attempt = 1; fs::exists(temp) && attempt < kMaxTempAttempts;
+       ++attempt) {
+    temp = temp_name(dir);
+  }
+  StagedCopy staged(from, temp, MoveMethod::Buffered);
+  fs::copy(from, temp,
+           fs::copy_options::recursive | fs::copy_options::copy_symlinks, ec);
+  if (ec) return std::nullopt;
+  return staged;
+#endif
+}
+
+StagedCopy::StagedCopy(StagedCopy&& other) noexcept
+    : m_from(std::move(other.m_from)),
+      m_path(std::exchange(other.m_path, {})),
+      m_method(other.m_method),
+      m_committed(other.m_committed),
+      m_sources(std::move(other.m_sources)) {}
+
+StagedCopy& StagedCopy::operator=(StagedCopy&& other) noexcept {
+  if (this != &other) {
+    StagedCopy discarded(std::move(*this));
+    m_from = std::move(other.m_from);
+    m_path = std::exchange(other.m_path, {});
+    m_method = other.m_method;
+    m_committed = other.m_committed;
+    m_sources = std::move(other.m_sources);
+  }
+  return *this;
+}
+
+StagedCopy::~StagedCopy() {
+  if (m_path.empty() || m_committed) return;
+  std::error_code ignored;
+  fs::remove_all(m_path, ignored);
+}
+
+std::error_code StagedCopy::commit(const fs::path& landed) {
+  m_committed = true;
+  std::error_code ec;
+  auto drop_landed = [&landed] {
+    std::error_code ignored;
+    fs::remove_all(landed, ignored);
+  };
+#ifndef _WIN32
+  // The copy must be in place for good before the source goes away.
+  sync_directory(landed.parent_path());
+
+  // Anything added to or changed in the source since it was copied exists
+  // only there, so the source stays whole.
+  if (auto changed = changed_source(m_sources)) {
+    IOManager::log(LogLevel::Warning,
+                   std::format("'{}' changed while '{}' was copied; left in "
+                               "place.",
+                               safe_path_to_string(*changed),
+                               safe_path_to_string(m_from)));
+    drop_landed();
+    return std::make_error_code(std::errc::device_or_resource_busy);
+  }
+
+  // Contents before their directory, and only entries that are still the
+  // ones that were copied.
+  for (auto it = m_sources.rbegin(); it != m_sources.rend(); ++it) {
+    struct stat st {};
+    if (::lstat(it->path.c_str(), &st) != 0) {
+      ec = last_error();
+    } else if (!same_entry(*it, st)) {
+      ec = std::make_error_code(std::errc::device_or_resource_busy);
+    } else if ((S_ISDIR(st.st_mode) ? ::rmdir(it->path.c_str())
+                                    : ::unlink(it->path.c_str())) != 0) {
+      ec = last_error();
+    }
+    if (!ec) continue;
+    if (it == m_sources.rbegin()) {
+      drop_landed();
+    } else {
+      // Part of the source is gone, so the complete copy is kept.
+      IOManager::log(
+          LogLevel::Warning,
+          std::format("Copied '{}' but could not remove '{}': {}",
+                      safe_path_to_string(m_from),
+                      safe_path_to_string(it->path), ec.message()));
+    }
+    return ec;
+  }
+  return {};
+#else
+  if (fs::is_directory(fs::symlink_status(m_from, ec))) {
+    fs::remove_all(m_from, ec);
+    if (ec) {
+      IOManager::log(
+          LogLevel::Warning,
+          std::format("Copied '{}' but could not remove all of it: {}",
+                      safe_path_to_string(m_from), ec.message()));
+    }
+    return ec;
+  }
+  fs::remove(m_from, ec);
+  if (ec) drop_landed();
+  return ec;
+#endif
+}
+
+std::error_code move(const fs::path& from, const fs::path& to,
+                     MoveMethod& method) {
+  std::error_code ec;
+  if (fs::exists(fs::symlink_status(to, ec))) {
+    return std::make_error_code(std::errc::file_exists);
+  }
+  auto staged = StagedCopy::create(from, to.parent_path(), ec);
+  if (!staged) return ec;
+  if ((ec = rename_noreplace(staged->path(), to))) return ec;
+  method = staged->method();
+  return staged->commit(to);
+}
+
+std::error_code copy(const fs::path& from, const fs::path& to,
+                     MoveMethod& method) {
+  std::error_code ec;
+  if (fs::exists(fs::symlink_status(to, ec))) {
+    return std::make_error_code(std::errc::file_exists);
+  }
+  auto staged = StagedCopy::create(from, to.parent_path(), ec);
+  if (!staged) return ec;
+  if ((ec = rename_noreplace(staged->path(), to))) return ec;
+  // The copy is in place and the source stays.
+  staged->m_committed = true;
+  method = staged->method();
+  return {};
+}
+}  // namespace CrossDevice
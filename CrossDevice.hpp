@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#include "types.hpp"
+
+// Moves between filesystems, where rename() fails with EXDEV. The source is
+// copied into the destination directory under a temporary name, with its
+// permissions, owner, timestamps and extended attributes, flushed to disk
+// and optionally verified. Only then does the copy take its final name and
+// the source get removed, so an interrupted move leaves the source intact.
+// A file that changes while it is copied, such as a download still being
+// written, is not moved, and neither is a folder that gains or changes
+// entries before its copy is committed.
+namespace CrossDevice {
+struct Options {
+  // Hashes each copied file back from disk and compares it with the source
+  // before the source is removed.
+  bool verify = false;
+  // Files of at least two chunks are copied chunk by chunk on several I/O
+  // lane workers of the shared pool.
+  std::uint64_t chunk_size = std::uint64_t{64} << 20;
+  unsigned max_chunk_workers = 4;
+};
+
+// Sets the options of later cross-device moves. Call before any move starts.
+void configure(Options options);
+const Options& options();
+
+// An entry of a copied source as it was stat'ed before it was copied.
+struct SourceEntry {
+  fs::path path;
+  std::uint64_t dev = 0;
+  std::uint64_t ino = 0;
+  std::uint32_t mode = 0;
+  std::int64_t size = 0;
+  std::int64_t mtime_ns = 0;
+};
+
+// A copy of a file or directory tree staged next to its destination under a
+// hidden temporary name. Removed on destruction unless committed.
+class StagedCopy {
+ public:
+  // Copies `from` into the directory `dir`. On failure returns std::nullopt
+  // with `ec` set, and nothing is left in `dir`.
+  static std::optional<StagedCopy> create(const fs::path& from,
+                                          const fs::path& dir,
+                                          std::error_code& ec);
+  StagedCopy(StagedCopy&& other) noexcept;
+  StagedCopy& operator=(StagedCopy&& other) noexcept;
+  ~StagedCopy();
+
+  const fs::path& path() const { return m_path; }
+  // The slowest way any of its files was copied.
+  MoveMethod method() const { return m_method; }
+
+  // To be called once the copy has been renamed to `landed`: flushes the
+  // rename and removes the source, entry by entry, removing only what was
+  // copied. If the source gained or changed entries since, nothing is
+  // removed, the landed copy is dropped and errc::device_or_resource_busy
+  // returned. If an entry cannot be removed, the error is returned; the
+  // landed copy is dropped only if the source is still whole.
+  std::error_code commit(const fs::path& landed);
+
+ private:
+  friend std::error_code copy(const fs::path& from, const fs::path& to,
+                              MoveMethod& method);
+
+  StagedCopy(fs::path from, fs::path path, MoveMethod method)
+      : m_from(std::move(from)), m_path(std::move(path)), m_method(method) {}
+
+  fs::path m_from;
+  fs::path m_path;
+  MoveMethod m_method = MoveMethod::Buffered;
+  bool m_committed = false;
+  // Every entry that was copied, each directory before its contents.
+  std::vector<SourceEntry> m_sources;
+};
+
+// Moves `from` to `to` on another filesystem, never replacing an existing
+// `to` (errc::file_exists). Sets `method` to how the contents were copied.
+std::error_code move(const fs::path& from, const fs::path& to,
+                     MoveMethod& method);
+// Copies `from` to `to` the way move() does, with its metadata, but keeps
+// `from`. Never replaces an existing `to`.
+std::error_code copy(const fs::path& from, const fs::path& to,
+                     MoveMethod& method);
+}  // namespace CrossDevice
@@ -0,0 +1,514 @@
+#include "Deduplicator.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "DirectoryReader.hpp"
+#include "IOManager.hpp"
+#include "StreamHash.hpp"
+#include "WorkerPool.hpp"
+#include "utils.hpp"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace {
+constexpr size_t kNotPlanned = static_cast<size_t>(-1);
+constexpr size_t kReadChunk = 1 << 20;
+
+struct Candidate {
+  fs::path path;
+  std::uintmax_t size = 0;
+  // Zero where the platform does not expose file identities.
+  std::uint64_t dev = 0;
+  std::uint64_t ino = 0;
+  // Index of the planned move of this file, or kNotPlanned.
+  size_t action = kNotPlanned;
+  std::uint64_t hash = 0;
+  bool failed = false;
+};
+
+// Regular files only; symlinks are never followed.
+std::optional<Candidate> stat_candidate(const fs::path& path) {
+  Candidate candidate;
+  candidate.path = path;
+#ifndef _WIN32
+  struct stat st {};
+  if (::lstat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return std::nullopt;
+  }
+  candidate.size = static_cast<std::uintmax_t>(st.st_size);
+  candidate.dev = static_cast<std::uint64_t>(st.st_dev);
+  candidate.ino = static_cast<std::uint64_t>(st.st_ino);
+#else
+  std::error_code ec;
+  if (!fs::is_regular_file(fs::symlink_status(path, ec))) return std::nullopt;
+  candidate.size = fs::file_size(path, ec);
+  if (ec) return std::nullopt;
+#endif
+  return candidate;
+}
+
+// Positional reads of one file.
+class ContentReader {
+ public:
+  ContentReader(const fs::path& path, bool sequential) {
+#ifdef _WIN32
+    (void)sequential;
+    m_in.open(path, std::ios::binary);
+#else
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef POSIX_FADV_SEQUENTIAL
+    if (m_fd >= 0 && sequential) {
+      ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#else
+    (void)sequential;
+#endif
+#endif
+  }
+  ContentReader(const ContentReader&) = delete;
+  ContentReader& operator=(const ContentReader&) = delete;
+  ~ContentReader() {
+#ifndef _WIN32
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+  }
+
+  bool ok() const {
+#ifdef _WIN32
+    return m_in.is_open();
+#else
+    return m_fd >= 0;
+#endif
+  }
+
+  // Reads exactly `out.size()` bytes starting at `offset`.
+  bool read(std::uint64_t offset, std::span<unsigned char> out) {
+    while (!out.empty()) {
+#ifdef _WIN32
+      m_in.seekg(static_cast<std::streamoff>(offset));
+      if (!m_in.read(reinterpret_cast<char*>(out.data()),
+                     static_cast<std::streamsize>(out.size()))) {
+        return false;
+      }
+      const size_t got = out.size();
+#else
+      const ssize_t n = ::pread(m_fd, out.data(), out.size(),
+                                static_cast<off_t>(offset));
+      if (n < 0 && errno == EINTR) continue;
+      // A short file means it changed since it was sized.
+      if (n <= 0) return false;
+      const size_t got = static_cast<size_t>(n);
+#endif
+      out = out.subspan(got);
+      offset += got;
+    }
+    return true;
+  }
+
+  // Feeds `length` bytes starting at `offset` into `hasher`.
+  bool hash_range(std::uint64_t offset, std::uint64_t length,
+                  StreamHash64& hasher, std::vector<unsigned char>& buffer) {
+    while (length > 0) {
+      const size_t want =
+          static_cast<size_t>(std::min<std::uint64_t>(length, buffer.size()));
+      if (!read(offset, {buffer.data(), want})) return false;
+      hasher.update({buffer.data(), want});
+      offset += want;
+      length -= want;
+    }
+    return true;
+  }
+
+ private:
+#ifdef _WIN32
+  std::ifstream m_in;
+#else
+  int m_fd = -1;
+#endif
+};
+
+thread_local std::vector<unsigned char> t_buffer;
+
+std::optional<std::uint64_t> hash_edges(const Candidate& candidate,
+                                        std::uint64_t edge) {
+  ContentReader reader(candidate.path, false);
+  if (!reader.ok()) return std::nullopt;
+  t_buffer.resize(kReadChunk);
+  StreamHash64 hasher;
+  if (candidate.size <= 2 * edge) {
+    if (!reader.hash_range(0, candidate.size, hasher, t_buffer)) {
+      return std::nullopt;
+    }
+  } else if (!reader.hash_range(0, edge, hasher, t_buffer) ||
+             !reader.hash_range(candidate.size - edge, edge, hasher,
+                                t_buffer)) {
+    return std::nullopt;
+  }
+  return hasher.digest();
+}
+
+std::optional<std::uint64_t> hash_full(const Candidate& candidate) {
+  ContentReader reader(candidate.path, true);
+  if (!reader.ok()) return std::nullopt;
+  t_buffer.resize(kReadChunk);
+  StreamHash64 hasher;
+  if (!reader.hash_range(0, candidate.size, hasher, t_buffer)) {
+    return std::nullopt;
+  }
+  return hasher.digest();
+}
+
+// Compares two files of `size` bytes, stopping at the first difference. A
+// matching hash alone is not enough to delete or replace a file.
+bool same_contents(const fs::path& a, const fs::path& b, std::uint64_t size) {
+  ContentReader left(a, true);
+  ContentReader right(b, true);
+  if (!left.ok() || !right.ok()) return false;
+  const size_t chunk =
+      static_cast<size_t>(std::min<std::uint64_t>(size, kReadChunk));
+  std::vector<unsigned char> left_buffer(chunk);
+  std::vector<unsigned char> right_buffer(chunk);
+  for (std::uint64_t offset = 0; offset < size;) {
+    const size_t want =
+        static_cast<size_t>(std::min<std::uint64_t>(size - offset, chunk));
+    if (!left.read(offset, {left_buffer.data(), want}) ||
+        !right.read(offset, {right_buffer.data(), want}) ||
+        std::memcmp(left_buffer.data(), right_buffer.data(), want) != 0) {
+      return false;
+    }
+    offset += want;
+  }
+  return true;
+}
+
+// Hashes every member of `groups` in parallel and splits each group into
+// runs of equal hashes. Files that could not be read are dropped.
+template <typename HashFn>
+std::vector<std::vector<size_t>> split_by_hash(
+    const std::vector<std::vector<size_t>>& groups,
+    std::vector<Candidate>& candidates, HashFn hash,
+    const std::stop_token& stoken, unsigned width) {
+  std::vector<size_t> members;
+  for (const auto& group : groups) {
+    members.insert(members.end(), group.begin(), group.end());
+  }
+  // The stop check stays inside, so that every member is marked.
+  WorkerPool::shared().for_each_index(
+      PoolLane::Io, members.size(), [&](size_t m) {
+        Candidate& candidate = candidates[members[m]];
+        if (stoken.stop_requested()) {
+          candidate.failed = true;
+          return;
+        }
+        const auto digest = hash(candidate);
+        candidate.failed = !digest;
+        candidate.hash = digest.value_or(0);
+      },
+      {}, width);
+
+  std::vector<std::vector<size_t>> runs;
+  for (auto group : groups) {
+    std::erase_if(group, [&](size_t i) { return candidates[i].failed; });
+    std::ranges::sort(group, {}, [&](size_t i) { return candidates[i].hash; });
+    for (size_t begin = 0; begin < group.size();) {
+      size_t end = begin + 1;
+      while (end < group.size() &&
+             candidates[group[end]].hash == candidates[group[begin]].hash) {
+        ++end;
+      }
+      runs.emplace_back(group.begin() + begin, group.begin() + end);
+      begin = end;
+    }
+  }
+  return runs;
+}
+
+const char* verb_for(DedupePolicy policy) {
+  switch (policy) {
+    case DedupePolicy::Skip:
+      return "Keeping";
+    case DedupePolicy::Delete:
+      return "Deleting";
+    case DedupePolicy::Hardlink:
+      return "Hard-linking";
+    case DedupePolicy::Reflink:
+      return "Cloning";
+    case DedupePolicy::Off:
+      break;
+  }
+  return "";
+}
+}  // namespace
+
+std::optional<DedupePolicy> parse_dedupe_policy(std::string_view name) {
+  if (name == "off") return DedupePolicy::Off;
+  if (name == "skip") return DedupePolicy::Skip;
+  if (name == "delete") return DedupePolicy::Delete;
+  if (name == "hardlink") return DedupePolicy::Hardlink;
+  if (name == "reflink") return DedupePolicy::Reflink;
+  return std::nullopt;
+}
+
+Deduplicator::Deduplicator(DedupeOptions options) : m_options(options) {}
+
+DedupeStats Deduplicator::process(std::vector<Action>& plan,
+                                  std::stop_token stoken) const {
+  DedupeStats stats;
+  if (m_options.policy == DedupePolicy::Off) return stats;
+
+  // Planned files first, then what already sits in their destinations.
+  std::vector<Candidate> candidates;
+  std::unordered_set<fs::path::string_type> planned;
+  std::map<fs::path, bool> destinations;
+  for (size_t i = 0; i < plan.size(); ++i) {
+    const Action& action = plan[i];
+    if (action.type != ActionType::MOVE) continue;
+    auto candidate = stat_candidate(action.from);
+    if (!candidate || candidate->size < m_options.min_size) continue;
+    candidate->action = i;
+    candidates.push_back(std::move(*candidate));
+    planned.insert(action.from.native());
+    destinations.emplace(action.to.parent_path(), true);
+  }
+  if (candidates.empty()) return stats;
+  for (const auto& [directory, unused] : destinations) {
+    std::error_code ec;
+    for (const DirEntry& entry : read_directory(directory, ec)) {
+      if (entry.type != EntryType::Regular &&
+          entry.type != EntryType::Unknown) {
+        continue;
+      }
+      fs::path path = directory / entry.name;
+      if (planned.contains(path.native())) continue;
+      auto candidate = stat_candidate(path);
+      if (candidate && candidate->size >= m_options.min_size) {
+        candidates.push_back(std::move(*candidate));
+      }
+    }
+  }
+  stats.candidates = candidates.size();
+
+  // Stage 0: group by size. Further names of an already seen inode are
+  // recorded as its aliases and never read.
+  std::vector<std::vector<size_t>> aliases(candidates.size());
+  std::vector<std::vector<size_t>> groups;
+  {
+    std::unordered_map<std::uintmax_t, std::vector<size_t>> by_size;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      by_size[candidates[i].size].push_back(i);
+    }
+    for (auto& [size, members] : by_size) {
+      if (members.size() < 2) continue;
+      std::map<std::pair<std::uint64_t, std::uint64_t>, size_t> first_name;
+      std::vector<size_t> unique;
+      for (size_t i : members) {
+        const Candidate& c = candidates[i];
+        if (c.ino != 0) {
+          auto [it, inserted] = first_name.try_emplace({c.dev, c.ino}, i);
+          if (!inserted) {
+            aliases[it->second].push_back(i);
+            continue;
+          }
+        }
+        unique.push_back(i);
+      }
+      groups.push_back(std::move(unique));
+    }
+  }
+
+  std::vector<std::vector<size_t>> sets;
+  auto settle = [&](const std::vector<size_t>& run) {
+    if (run.size() > 1 || !aliases[run.front()].empty()) sets.push_back(run);
+  };
+
+  // Stage 1: the first and last edge_bytes. For small files this is the
+  // whole contents.
+  const std::uint64_t edge = std::max<size_t>(1, m_options.edge_bytes);
+  std::vector<std::vector<size_t>> to_hash;
+  for (auto& group : groups) {
+    if (group.size() > 1) {
+      to_hash.push_back(std::move(group));
+    } else {
+      settle(group);
+    }
+  }
+  std::vector<std::vector<size_t>> to_hash_fully;
+  for (auto& run : split_by_hash(
+           to_hash, candidates,
+           [&](const Candidate& c) { return hash_edges(c, edge); }, stoken,
+           m_options.max_workers)) {
+    for (size_t i : run) {
+      stats.edge_hashed++;
+      stats.bytes_read += std::min<std::uint64_t>(candidates[i].size, 2 * edge);
+    }
+    if (run.size() > 1 && candidates[run.front()].size > 2 * edge) {
+      to_hash_fully.push_back(std::move(run));
+    } else {
+      settle(run);
+    }
+  }
+
+  // Stage 2: whole contents of the files whose edges all match.
+  for (auto& run : split_by_hash(
+           to_hash_fully, candidates,
+           [](const Candidate& c) { return hash_full(c); }, stoken,
+           m_options.max_workers)) {
+    for (size_t i : run) {
+      stats.full_hashed++;
+      stats.bytes_read += candidates[i].size;
+    }
+    settle(run);
+  }
+  if (stoken.stop_requested()) return stats;
+
+  // Each planned duplicate is rewritten relative to the kept copy.
+  std::vector<std::optional<Action>> extra(plan.size());
+  std::vector<bool> dropped(plan.size(), false);
+  for (const auto& run : sets) {
+    std::vector<size_t> members;
+    for (size_t i : run) {
+      members.push_back(i);
+      members.insert(members.end(), aliases[i].begin(), aliases[i].end());
+    }
+    const size_t kept = *std::ranges::min_element(
+        members, {}, [&](size_t i) {
+          const Candidate& c = candidates[i];
+          return std::make_tuple(c.action != kNotPlanned,
+                                 c.path.filename().native().size(), c.path);
+        });
+    const Candidate& original = candidates[kept];
+
+    for (size_t i : members) {
+      const Candidate& c = candidates[i];
+      if (i == kept || c.action == kNotPlanned) continue;
+      Action& action = plan[c.action];
+      const bool same_inode = c.ino != 0 && c.dev == original.dev &&
+                              c.ino == original.ino;
+      const bool same_device = c.dev == original.dev;
+      switch (m_options.policy) {
+        case DedupePolicy::Skip:
+          dropped[c.action] = true;
+          break;
+        case DedupePolicy::Delete:
+          action.type = ActionType::REMOVE;
+          action.to = original.path;
+          break;
+        case DedupePolicy::Hardlink:
+        case DedupePolicy::Reflink:
+          // Links cannot span filesystems; the move stays as it is.
+          if (same_inode || !same_device) continue;
+          extra[c.action] = Action{c.path, original.path, action.category,
+                                   m_options.policy == DedupePolicy::Hardlink
+                                       ? ActionType::HARDLINK
+                                       : ActionType::REFLINK};
+          break;
+        case DedupePolicy::Off:
+          break;
+      }
+      stats.duplicates++;
+      IOManager::log(std::format("{} duplicate '{}' of '{}'",
+                                 verb_for(m_options.policy),
+                                 safe_path_to_string(c.path),
+                                 safe_path_to_string(original.path)));
+    }
+  }
+
+  std::vector<Action> rewritten;
+  rewritten.reserve(plan.size() + stats.duplicates);
+  for (size_t i = 0; i < plan.size(); ++i) {
+    if (extra[i]) rewritten.push_back(std::move(*extra[i]));
+    if (!dropped[i]) rewritten.push_back(std::move(plan[i]));
+  }
+  plan = std::move(rewritten);
+
+  IOManager::log(std::format(
+      "Duplicates: {} found among {} files; {} edge-hashed, {} fully hashed, "
+      "{} MiB read.",
+      stats.duplicates, stats.candidates, stats.edge_hashed,
+      stats.full_hashed, stats.bytes_read >> 20));
+  return stats;
+}
+
+std::error_code Deduplicator::apply(const Action& action) {
+  std::error_code ec;
+  const std::uintmax_t kept_size = fs::file_size(action.to, ec);
+  if (ec) return ec;
+  const std::uintmax_t size = fs::file_size(action.from, ec);
+  if (ec) return ec;
+  // One of the files changed since the plan was made, or only their hashes
+  // matched.
+  if (size != kept_size || !same_contents(action.from, action.to, size)) {
+    IOManager::log(LogLevel::Warning,
+                   std::format("'{}' no longer matches '{}'; left in place.",
+                               safe_path_to_string(action.from),
+                               safe_path_to_string(action.to)));
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  const fs::path tmp = action.from.parent_path() /
+                       fs::path(action.from.filename()).concat(".dedupe.tmp");
+  switch (action.type) {
+    case ActionType::REMOVE:
+      fs::remove(action.from, ec);
+      return ec;
+    case ActionType::HARDLINK:
+      fs::create_hard_link(action.to, tmp, ec);
+      break;
+    case ActionType::REFLINK: {
+#ifdef __linux__
+      const int src = ::open(action.to.c_str(), O_RDONLY | O_CLOEXEC);
+      if (src < 0) return {errno, std::generic_category()};
+      struct stat st {};
+      ::fstat(src, &st);
+      const int dst = ::open(tmp.c_str(),
+                             O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                             st.st_mode & 07777);
+      if (dst < 0) {
+        ec = {errno, std::generic_category()};
+        ::close(src);
+        return ec;
+      }
+      if (::ioctl(dst, FICLONE, src) != 0) {
+        ec = {errno, std::generic_category()};
+      }
+      ::close(dst);
+      ::close(src);
+      if (ec) {
+        std::error_code ignored;
+        fs::remove(tmp, ignored);
+        return ec;
+      }
+#else
+      return std::make_error_code(std::errc::operation_not_supported);
+#endif
+      break;
+    }
+    case ActionType::MOVE:
+      return std::make_error_code(std::errc::invalid_argument);
+  }
+  if (ec) return ec;
+  fs::rename(tmp, action.from, ec);
+  if (ec) {
+    std::error_code ignored;
+    fs::remove(tmp, ignored);
+  }
+  return ec;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "types.hpp"
+
+// What happens to a planned file that duplicates another file.
+enum class DedupePolicy {
+  Off,
+  // The duplicate is left where it is.
+  Skip,
+  // The duplicate is deleted.
+  Delete,
+  // The duplicate is replaced by a hard link to the kept copy, then moved.
+  Hardlink,
+  // The duplicate is replaced by a copy-on-write clone, then moved.
+  Reflink
+};
+
+std::optional<DedupePolicy> parse_dedupe_policy(std::string_view name);
+
+struct DedupeOptions {
+  DedupePolicy policy = DedupePolicy::Off;
+  // Smaller files are never treated as duplicates.
+  std::uintmax_t min_size = 1;
+  // Bytes hashed at each end of a file before its whole contents are.
+  size_t edge_bytes = 64 * 1024;
+  // Upper bound on the shared pool's I/O lane workers hashing at once; 0 for
+  // the whole lane.
+  unsigned max_workers = 0;
+};
+
+struct DedupeStats {
+  size_t candidates = 0;
+  size_t edge_hashed = 0;
+  size_t full_hashed = 0;
+  size_t duplicates = 0;
+  std::uintmax_t bytes_read = 0;
+};
+
+// Finds planned files whose contents equal another planned file or a file
+// already in a destination folder, and rewrites their moves per policy.
+// Candidates are filtered in stages, so that most files are never read:
+// files of a unique size are dropped, then files whose first and last
+// `edge_bytes` differ, and only the remaining ones are hashed in full
+// (64-bit XXH64). Hard links of one file count as duplicates unread. Of
+// each set of duplicates, a file already in a destination folder is kept,
+// else the one with the shortest name.
+class Deduplicator {
+ public:
+  explicit Deduplicator(DedupeOptions options);
+
+  DedupeStats process(std::vector<Action>& plan,
+                      std::stop_token stoken = {}) const;
+
+  // Performs a REMOVE, HARDLINK or REFLINK action. The kept copy at
+  // `action.to` must still exist with the same contents, compared byte for
+  // byte; otherwise nothing is changed.
+  static std::error_code apply(const Action& action);
+
+ private:
+  DedupeOptions m_options;
+};
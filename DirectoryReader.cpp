@@ -0,0 +1,170 @@
+#include "DirectoryReader.hpp"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#endif
+
+namespace {
+#ifdef __linux__
+// Large enough for a few thousand entries per system call; glibc's readdir
+// uses 32 KiB.
+constexpr size_t kGetdentsBuffer = 64 * 1024;
+
+// The record layout returned by getdents64(2).
+struct LinuxDirent64 {
+  std::uint64_t d_ino;
+  std::int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+EntryType from_d_type(unsigned char d_type) {
+  switch (d_type) {
+    case DT_REG:
+      return EntryType::Regular;
+    case DT_DIR:
+      return EntryType::Directory;
+    case DT_LNK:
+      return EntryType::Symlink;
+    case DT_UNKNOWN:
+      return EntryType::Unknown;
+    default:
+      return EntryType::Other;
+  }
+}
+
+EntryType from_mode(unsigned mode) {
+  if (S_ISREG(mode)) return EntryType::Regular;
+  if (S_ISDIR(mode)) return EntryType::Directory;
+  if (S_ISLNK(mode)) return EntryType::Symlink;
+  return EntryType::Other;
+}
+#endif
+}  // namespace
+
+#ifdef __linux__
+DirectoryReader::DirectoryReader(const fs::path& directory) {
+  m_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (m_fd < 0) {
+    m_error = {errno, std::generic_category()};
+  } else {
+    m_buffer.resize(kGetdentsBuffer);
+  }
+}
+
+DirectoryReader::~DirectoryReader() {
+  if (m_fd >= 0) ::close(m_fd);
+}
+
+bool DirectoryReader::next(std::vector<DirEntry>& entries) {
+  entries.clear();
+  if (m_fd < 0) return false;
+
+  size_t unknown = 0;
+  while (entries.empty()) {
+    const long bytes = ::syscall(SYS_getdents64, m_fd, m_buffer.data(),
+                                 m_buffer.size());
+    if (bytes <= 0) {
+      if (bytes < 0) m_error = {errno, std::generic_category()};
+      ::close(m_fd);
+      m_fd = -1;
+      return false;
+    }
+    for (long offset = 0; offset < bytes;) {
+      const auto* record =
+          reinterpret_cast<const LinuxDirent64*>(m_buffer.data() + offset);
+      offset += record->d_reclen;
+      const char* name = record->d_name;
+      if (name[0] == '.' &&
+          (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        continue;
+      }
+      const EntryType type = from_d_type(record->d_type);
+      if (type == EntryType::Unknown) unknown++;
+      entries.push_back({name, type});
+    }
+  }
+
+  // Filesystems without d_type report every entry as unknown; resolve them
+  // in one pass relative to the open directory.
+  if (unknown > 0) {
+    for (auto& entry : entries) {
+      if (entry.type != EntryType::Unknown) continue;
+      struct statx stx {};
+      if (::statx(m_fd, entry.name.c_str(),
+                  AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE,
+                  &stx) == 0) {
+        entry.type = from_mode(stx.stx_mode);
+      }
+    }
+  }
+  return true;
+}
+#else
+DirectoryReader::DirectoryReader(const fs::path& directory)
+    : m_it(directory, fs::directory_options::skip_permission_denied,
+           m_error) {}
+
+DirectoryReader::~DirectoryReader() = default;
+
+bool DirectoryReader::next(std::vector<DirEntry>& entries) {
+  constexpr size_t kBatch = 1024;
+  entries.clear();
+  for (; m_it != fs::directory_iterator{} && entries.size() < kBatch;
+       m_it.increment(m_error)) {
+    std::error_code ec;
+    EntryType type = EntryType::Other;
+    if (m_it->is_symlink(ec)) {
+      type = EntryType::Symlink;
+    } else if (m_it->is_directory(ec)) {
+      type = EntryType::Directory;
+    } else if (m_it->is_regular_file(ec)) {
+      type = EntryType::Regular;
+    } else if (ec) {
+      type = EntryType::Unknown;
+    }
+    entries.push_back({m_it->path().filename().native(), type});
+  }
+  return !entries.empty();
+}
+#endif
+
+std::vector<DirEntry> read_directory(const fs::path& directory,
+                                     std::error_code& ec) {
+  DirectoryReader reader(directory);
+  std::vector<DirEntry> entries;
+  std::vector<DirEntry> batch;
+  while (reader.next(batch)) {
+    if (entries.empty()) {
+      entries.swap(batch);
+    } else {
+      entries.insert(entries.end(), std::make_move_iterator(batch.begin()),
+                     std::make_move_iterator(batch.end()));
+    }
+  }
+  ec = reader.error();
+  return entries;
+}
+
+EntryType entry_type_of(const fs::path& path) {
+  std::error_code ec;
+  const fs::file_status status = fs::status(path, ec);
+  if (ec) return EntryType::Unknown;
+  switch (status.type()) {
+    case fs::file_type::regular:
+      return EntryType::Regular;
+    case fs::file_type::directory:
+      return EntryType::Directory;
+    default:
+      return EntryType::Other;
+  }
+}
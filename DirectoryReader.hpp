@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "types.hpp"
+#include "utils.hpp"
+
+enum class EntryType : std::uint8_t {
+  Unknown,
+  Regular,
+  Directory,
+  Symlink,
+  Other
+};
+
+struct DirEntry {
+  fs::path::string_type name;
+  // The type of the entry itself; a symlink is not followed.
+  EntryType type = EntryType::Unknown;
+};
+
+// Enumerates a directory without a stat per entry. On Linux the raw
+// getdents64 records are read into a large buffer and each entry's type is
+// taken from d_type; only entries the filesystem reports as DT_UNKNOWN are
+// resolved, with statx, once per buffer. Elsewhere the types cached by the
+// std::filesystem iterator are used. "." and ".." are never returned.
+class DirectoryReader {
+ public:
+  explicit DirectoryReader(const fs::path& directory);
+  ~DirectoryReader();
+  DirectoryReader(const DirectoryReader&) = delete;
+  DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+  // Replaces the contents of `entries` with the next entries. Returns false
+  // once the directory is exhausted or reading failed.
+  bool next(std::vector<DirEntry>& entries);
+
+  // Set if the directory could not be opened or read.
+  const std::error_code& error() const { return m_error; }
+
+ private:
+  std::error_code m_error;
+#ifdef __linux__
+  int m_fd = -1;
+  std::vector<char> m_buffer;
+#else
+  fs::directory_iterator m_it;
+#endif
+};
+
+// Reads all entries of a directory. Sets `ec` on failure.
+std::vector<DirEntry> read_directory(const fs::path& directory,
+                                     std::error_code& ec);
+
+// The type of whatever `path` refers to, following symlinks. Needed only for
+// entries listed as Unknown or Symlink.
+EntryType entry_type_of(const fs::path& path);
+
+#ifdef _WIN32
+inline std::string entry_name_utf8(const DirEntry& entry) {
+  return safe_path_to_string(fs::path(entry.name));
+}
+#else
+// POSIX names are used as they are, without a copy.
+inline const std::string& entry_name_utf8(const DirEntry& entry) {
+  return entry.name;
+}
+#endif
+
+// The extension of a file name, as fs::path::extension() would return it.
+inline std::string_view extension_of(std::string_view name) {
+  const size_t dot = name.rfind('.');
+  if (dot == std::string_view::npos || dot == 0 || name == "..") return {};
+  return name.substr(dot);
+}
@@ -0,0 +1,196 @@
+#include "ExifCache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "IOManager.hpp"
+#include "utils.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr std::array<char, 8> kMagic = {'O', 'R', 'G', 'E', 'X', 'I', 'F', '1'};
+
+enum SlotState : std::uint8_t { kEmpty = 0, kHasDate = 1, kNoDate = 2 };
+}  // namespace
+
+struct ExifCache::Header {
+  std::array<char, 8> magic;
+  std::uint32_t slot_count;
+  // Incremented every time the cache is opened; used as the LRU clock.
+  std::uint32_t generation;
+  std::array<std::uint8_t, 48> reserved;
+};
+
+struct ExifCache::Slot {
+  std::uint64_t dev;
+  std::uint64_t ino;
+  std::uint64_t size;
+  std::int64_t mtime_ns;
+  std::uint32_t last_used;
+  std::uint8_t state;
+  std::array<char, 10> date;
+  std::uint8_t padding;
+};
+
+std::unique_ptr<ExifCache> ExifCache::open(const fs::path& path,
+                                           std::uint32_t slot_count) {
+  // The file layout must not depend on the compiler's padding choices.
+  static_assert(sizeof(Header) == 64);
+  static_assert(sizeof(Slot) == 48);
+#ifdef _WIN32
+  (void)path;
+  (void)slot_count;
+  return nullptr;
+#else
+  slot_count = std::max(kBucketSize, slot_count - slot_count % kBucketSize);
+  const size_t mapping_size =
+      sizeof(Header) + static_cast<size_t>(slot_count) * sizeof(Slot);
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    IOManager::log(std::format("EXIF cache disabled: cannot open '{}': {}",
+                               safe_path_to_string(path),
+                               std::strerror(errno)));
+    return nullptr;
+  }
+  // The table has no per-entry locking across processes, so only one process
+  // may use it at a time.
+  if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    IOManager::log("EXIF cache disabled: it is in use by another process.");
+    ::close(fd);
+    return nullptr;
+  }
+
+  struct stat st {};
+  const bool fresh = ::fstat(fd, &st) != 0 ||
+                     static_cast<size_t>(st.st_size) != mapping_size;
+  if (fresh && ::ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  void* mapping = ::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  auto* header = static_cast<Header*>(mapping);
+  if (fresh || header->magic != kMagic || header->slot_count != slot_count) {
+    std::memset(mapping, 0, mapping_size);
+    header->magic = kMagic;
+    header->slot_count = slot_count;
+  }
+  header->generation++;
+
+  return std::unique_ptr<ExifCache>(
+      new ExifCache(fd, mapping, mapping_size));
+#endif
+}
+
+ExifCache::ExifCache(int fd, void* mapping, size_t mapping_size)
+    : m_fd(fd),
+      m_mapping(mapping),
+      m_mapping_size(mapping_size),
+      m_header(static_cast<Header*>(mapping)),
+      m_slots(reinterpret_cast<Slot*>(static_cast<char*>(mapping) +
+                                      sizeof(Header))),
+      m_generation(m_header->generation) {}
+
+ExifCache::~ExifCache() {
+#ifndef _WIN32
+  ::msync(m_mapping, m_mapping_size, MS_ASYNC);
+  ::munmap(m_mapping, m_mapping_size);
+  ::close(m_fd);
+#endif
+}
+
+ExifCache::Slot* ExifCache::bucket_for(const FileIdentity& id,
+                                       size_t& stripe) const {
+  std::uint64_t h = id.ino * 0x9E3779B97F4A7C15ull;
+  h ^= id.dev + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+  h ^= static_cast<std::uint64_t>(id.mtime_ns) + (h << 6) + (h >> 2);
+  h ^= id.size + (h << 6) + (h >> 2);
+  const std::uint64_t bucket = h % (m_header->slot_count / kBucketSize);
+  stripe = bucket % kLockStripes;
+  return m_slots + bucket * kBucketSize;
+}
+
+ExifCache::Lookup ExifCache::lookup(const FileIdentity& identity,
+                                    std::string& date) {
+  size_t stripe = 0;
+  Slot* bucket = bucket_for(identity, stripe);
+  std::scoped_lock lock(m_locks[stripe]);
+
+  for (std::uint32_t i = 0; i < kBucketSize; ++i) {
+    Slot& slot = bucket[i];
+    if (slot.state == kEmpty || !same_file(slot, identity)) continue;
+    slot.last_used = m_generation;
+    if (slot.state == kHasDate) {
+      m_hits++;
+      date.assign(slot.date.data(), slot.date.size());
+      return Lookup::HasDate;
+    }
+    m_negative_hits++;
+    return Lookup::NoDate;
+  }
+  m_misses++;
+  return Lookup::Miss;
+}
+
+void ExifCache::store(const FileIdentity& identity,
+                      const std::optional<std::string>& date) {
+  size_t stripe = 0;
+  Slot* bucket = bucket_for(identity, stripe);
+  std::scoped_lock lock(m_locks[stripe]);
+
+  // Reuse the slot of the same file, else an empty one, else the one used
+  // least recently.
+  Slot* victim = nullptr;
+  for (std::uint32_t i = 0; i < kBucketSize; ++i) {
+    Slot& slot = bucket[i];
+    if (slot.state != kEmpty && same_file(slot, identity)) {
+      victim = &slot;
+      break;
+    }
+    if (slot.state == kEmpty) {
+      if (!victim || victim->state != kEmpty) victim = &slot;
+    } else if (!victim || (victim->state != kEmpty &&
+                           slot.last_used < victim->last_used)) {
+      victim = &slot;
+    }
+  }
+  if (victim->state != kEmpty && !same_file(*victim, identity)) m_evictions++;
+
+  victim->dev = identity.dev;
+  victim->ino = identity.ino;
+  victim->size = identity.size;
+  victim->mtime_ns = identity.mtime_ns;
+  victim->last_used = m_generation;
+  victim->date.fill('\0');
+  if (date && date->size() >= victim->date.size()) {
+    std::memcpy(victim->date.data(), date->data(), victim->date.size());
+    victim->state = kHasDate;
+  } else {
+    victim->state = kNoDate;
+  }
+}
+
+ExifCache::Stats ExifCache::stats() const {
+  return {m_hits.load(), m_negative_hits.load(), m_misses.load(),
+          m_evictions.load()};
+}
+
+bool ExifCache::same_file(const Slot& slot, const FileIdentity& id) {
+  return slot.dev == id.dev && slot.ino == id.ino && slot.size == id.size &&
+         slot.mtime_ns == id.mtime_ns;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ScanIndex.hpp"
+
+// A persistent, fixed-size cache of EXIF capture dates, stored in a
+// memory-mapped file. Entries are keyed by file identity (dev, ino, size,
+// mtime), so an unchanged image is never opened twice. Images without a date
+// are cached as well. When a bucket is full, the entry least recently used
+// (by session) is evicted. Safe for concurrent use; POSIX only.
+class ExifCache {
+ public:
+  enum class Lookup { Miss, HasDate, NoDate };
+
+  struct Stats {
+    std::uint64_t hits = 0;
+    std::uint64_t negative_hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+  };
+
+  // Opens or creates the cache file. Returns nullptr if the cache cannot be
+  // used, e.g. on Windows or when another process holds it.
+  static std::unique_ptr<ExifCache> open(const fs::path& path,
+                                         std::uint32_t slot_count = 1 << 18);
+  ~ExifCache();
+  ExifCache(const ExifCache&) = delete;
+  ExifCache& operator=(const ExifCache&) = delete;
+
+  // On HasDate, `date` receives the cached "YYYY:MM:DD" string.
+  Lookup lookup(const FileIdentity& identity, std::string& date);
+  void store(const FileIdentity& identity,
+             const std::optional<std::string>& date);
+
+  Stats stats() const;
+
+ private:
+  struct Header;
+  struct Slot;
+  static constexpr std::uint32_t kBucketSize = 8;
+  static constexpr size_t kLockStripes = 64;
+
+  ExifCache(int fd, void* mapping, size_t mapping_size);
+
+  Slot* bucket_for(const FileIdentity& identity, size_t& stripe) const;
+  static bool same_file(const Slot& slot, const FileIdentity& id);
+
+  int m_fd;
+  void* m_mapping;
+  size_t m_mapping_size;
+  Header* m_header;
+  Slot* m_slots;
+  std::uint32_t m_generation;
+
+  mutable std::array<std::mutex, kLockStripes> m_locks;
+  std::atomic<std::uint64_t> m_hits = 0;
+  std::atomic<std::uint64_t> m_negative_hits = 0;
+  std::atomic<std::uint64_t> m_misses = 0;
+  std::atomic<std::uint64_t> m_evictions = 0;
+};
@@ -0,0 +1,232 @@
+#include "ExifReader.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Metadata lives at the start of every supported format, so one read of this
+// size is usually all that is needed.
+constexpr size_t kHeadSize = 64 * 1024;
+constexpr std::uint16_t kMaxIfdEntries = 1024;
+constexpr std::uint16_t kTagExifIfd = 0x8769;
+constexpr std::uint16_t kTagDateTimeOriginal = 0x9003;
+constexpr std::uint16_t kTypeAscii = 2;
+
+// Serves reads from a cached head of the file, falling back to positional
+// reads for anything beyond it.
+class ByteSource {
+ public:
+  explicit ByteSource(const fs::path& path) {
+#ifdef _WIN32
+    m_stream.open(path, std::ios::binary);
+    if (!m_stream) return;
+    m_head.resize(kHeadSize);
+    m_stream.read(reinterpret_cast<char*>(m_head.data()), kHeadSize);
+    m_head.resize(static_cast<size_t>(m_stream.gcount()));
+    m_stream.clear();
+    m_ok = true;
+#else
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) return;
+    m_head.resize(kHeadSize);
+    const ssize_t n = ::pread(m_fd, m_head.data(), kHeadSize, 0);
+    if (n < 0) return;
+    m_head.resize(static_cast<size_t>(n));
+    m_ok = true;
+#endif
+  }
+  ByteSource(const ByteSource&) = delete;
+  ByteSource& operator=(const ByteSource&) = delete;
+  ~ByteSource() {
+#ifndef _WIN32
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+  }
+
+  bool ok() const { return m_ok; }
+  const std::vector<std::uint8_t>& head() const { return m_head; }
+
+  bool read(std::uint64_t offset, size_t length, void* out) {
+    if (offset + length <= m_head.size()) {
+      std::memcpy(out, m_head.data() + offset, length);
+      return true;
+    }
+#ifdef _WIN32
+    m_stream.seekg(static_cast<std::streamoff>(offset));
+    m_stream.read(static_cast<char*>(out),
+                  static_cast<std::streamsize>(length));
+    const bool good = static_cast<size_t>(m_stream.gcount()) == length;
+    m_stream.clear();
+    return good;
+#else
+    return ::pread(m_fd, out, length, static_cast<off_t>(offset)) ==
+           static_cast<ssize_t>(length);
+#endif
+  }
+
+ private:
+#ifdef _WIN32
+  std::ifstream m_stream;
+#else
+  int m_fd = -1;
+#endif
+  bool m_ok = false;
+  std::vector<std::uint8_t> m_head;
+};
+
+// Walks the IFDs of a TIFF structure that begins at `base` in the file.
+class TiffParser {
+ public:
+  TiffParser(ByteSource& source, std::uint64_t base)
+      : m_source(source), m_base(base) {}
+
+  ExifReader::Result find_date_time_original() {
+    std::array<std::uint8_t, 8> header{};
+    if (!m_source.read(m_base, header.size(), header.data()))
+      return unsupported();
+    if (header[0] == 'I' && header[1] == 'I') {
+      m_little_endian = true;
+    } else if (header[0] == 'M' && header[1] == 'M') {
+      m_little_endian = false;
+    } else {
+      return unsupported();
+    }
+    if (u16(header.data() + 2) != 42) return unsupported();
+
+    std::uint32_t exif_ifd = 0;
+    if (!find_tag(u32(header.data() + 4), kTagExifIfd, nullptr, &exif_ifd))
+      return not_found();
+
+    std::uint16_t type = 0;
+    std::uint32_t count = 0;
+    std::array<std::uint8_t, 4> inline_value{};
+    if (!find_tag(exif_ifd, kTagDateTimeOriginal, &type, nullptr, &count,
+                  &inline_value)) {
+      return not_found();
+    }
+    if (type != kTypeAscii || count < 10) return not_found();
+
+    std::array<char, 10> date{};
+    const std::uint32_t value_offset = u32(inline_value.data());
+    if (!m_source.read(m_base + value_offset, date.size(), date.data()))
+      return not_found();
+    if (std::memchr(date.data(), '\0', date.size()) != nullptr)
+      return not_found();
+
+    return {ExifReader::Status::Found, std::string(date.data(), date.size())};
+  }
+
+ private:
+  static ExifReader::Result unsupported() {
+    return {ExifReader::Status::Unsupported, {}};
+  }
+  static ExifReader::Result not_found() {
+    return {ExifReader::Status::NotFound, {}};
+  }
+
+  std::uint16_t u16(const std::uint8_t* p) const {
+    return m_little_endian ? static_cast<std::uint16_t>(p[0] | (p[1] << 8))
+                           : static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+  }
+  std::uint32_t u32(const std::uint8_t* p) const {
+    return m_little_endian
+               ? static_cast<std::uint32_t>(p[0]) | (p[1] << 8) |
+                     (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24)
+               : (static_cast<std::uint32_t>(p[0]) << 24) | (p[1] << 16) |
+                     (p[2] << 8) | p[3];
+  }
+
+  // Looks up `tag` in the IFD at `ifd_offset`. The raw 4-byte value field is
+  // returned through `raw` and, decoded as a LONG, through `value`.
+  bool find_tag(std::uint32_t ifd_offset, std::uint16_t tag,
+                std::uint16_t* type, std::uint32_t* value,
+                std::uint32_t* count = nullptr,
+                std::array<std::uint8_t, 4>* raw = nullptr) {
+    std::array<std::uint8_t, 2> count_bytes{};
+    if (!m_source.read(m_base + ifd_offset, 2, count_bytes.data()))
+      return false;
+    const std::uint16_t entries = u16(count_bytes.data());
+    if (entries == 0 || entries > kMaxIfdEntries) return false;
+
+    std::vector<std::uint8_t> table(static_cast<size_t>(entries) * 12);
+    if (!m_source.read(m_base + ifd_offset + 2, table.size(), table.data()))
+      return false;
+
+    for (std::uint16_t i = 0; i < entries; ++i) {
+      const std::uint8_t* entry = table.data() + i * 12;
+      if (u16(entry) != tag) continue;
+      if (type) *type = u16(entry + 2);
+      if (count) *count = u32(entry + 4);
+      if (value) *value = u32(entry + 8);
+      if (raw) std::memcpy(raw->data(), entry + 8, 4);
+      return true;
+    }
+    return false;
+  }
+
+  ByteSource& m_source;
+  std::uint64_t m_base;
+  bool m_little_endian = true;
+};
+
+ExifReader::Result parse_jpeg(ByteSource& source) {
+  const auto& head = source.head();
+  size_t pos = 2;  // Past SOI.
+  while (pos + 4 <= head.size()) {
+    if (head[pos] != 0xFF) break;
+    const std::uint8_t marker = head[pos + 1];
+    if (marker == 0xFF) {  // Fill byte.
+      ++pos;
+      continue;
+    }
+    if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      pos += 2;
+      continue;
+    }
+    // Start of scan or end of image: no metadata segments can follow.
+    if (marker == 0xDA || marker == 0xD9) break;
+
+    const size_t length = (static_cast<size_t>(head[pos + 2]) << 8) |
+                          head[pos + 3];
+    if (length < 2) break;
+    if (marker == 0xE1 && length >= 8 && pos + 10 <= head.size() &&
+        std::memcmp(head.data() + pos + 4, "Exif\0\0", 6) == 0) {
+      auto result = TiffParser(source, pos + 10).find_date_time_original();
+      if (result.status == ExifReader::Status::Unsupported)
+        result.status = ExifReader::Status::NotFound;
+      return result;
+    }
+    pos += 2 + length;
+  }
+  // Either no EXIF segment exists, or the header segments are larger than the
+  // head we read; only the latter warrants a full parse.
+  if (pos + 4 > head.size() && head.size() == kHeadSize) {
+    return {ExifReader::Status::Unsupported, {}};
+  }
+  return {ExifReader::Status::NotFound, {}};
+}
+}  // namespace
+
+ExifReader::Result ExifReader::read_date_time_original(const fs::path& path) {
+  ByteSource source(path);
+  if (!source.ok()) return {Status::Unsupported, {}};
+
+  const auto& head = source.head();
+  if (head.size() >= 4 && head[0] == 0xFF && head[1] == 0xD8) {
+    return parse_jpeg(source);
+  }
+  if (head.size() >= 8 && ((head[0] == 'I' && head[1] == 'I') ||
+                           (head[0] == 'M' && head[1] == 'M'))) {
+    return TiffParser(source, 0).find_date_time_original();
+  }
+  return {Status::Unsupported, {}};
+}
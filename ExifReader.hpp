@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "types.hpp"
+
+// A minimal, reentrant reader for the EXIF DateTimeOriginal tag. It handles
+// JPEG (APP1) and TIFF-container files, which covers DNG, CR2, NEF and ARW,
+// using positional reads of only the bytes it needs. No global state is
+// touched, so it is safe to call from any number of threads at once.
+namespace ExifReader {
+enum class Status {
+  Found,        // `date` holds the first 10 characters, "YYYY:MM:DD".
+  NotFound,     // The file was parsed but has no DateTimeOriginal.
+  Unsupported,  // Not a format this reader understands; use Exiv2 instead.
+};
+
+struct Result {
+  Status status = Status::Unsupported;
+  std::string date;
+};
+
+Result read_date_time_original(const fs::path& path);
+}  // namespace ExifReader
@@ -0,0 +1,79 @@
+#include "ExtensionTable.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+// Seeds tried per bucket before the table is grown.
+constexpr std::uint32_t kMaxSeed = 1 << 16;
+}  // namespace
+
+void ExtensionTable::insert(std::string_view extension, CategoryId id) {
+  if (extension.empty() || extension.size() > sizeof(std::uint64_t)) {
+    m_long.insert_or_assign(std::string(extension), id);
+  } else {
+    m_short.insert_or_assign(pack(extension), id);
+  }
+}
+
+void ExtensionTable::build() {
+  m_seeds.clear();
+  m_slots.clear();
+  if (m_short.empty()) return;
+  size_t slot_count =
+      std::bit_ceil(std::max<size_t>(8, m_short.size() * 5 / 4));
+  while (!try_build(slot_count)) slot_count *= 2;
+  m_short = {};
+}
+
+bool ExtensionTable::try_build(size_t slot_count) {
+  // About four keys per bucket. The largest buckets are placed first, while
+  // most slots are still free.
+  const size_t bucket_count = std::max<size_t>(1, m_short.size() / 4);
+  std::vector<std::vector<std::uint64_t>> buckets(bucket_count);
+  for (const auto& [key, id] : m_short) {
+    buckets[bucket_of(mix(key), bucket_count)].push_back(key);
+  }
+  std::vector<size_t> order(bucket_count);
+  for (size_t b = 0; b < bucket_count; ++b) order[b] = b;
+  std::ranges::stable_sort(order, std::greater<>{},
+                           [&](size_t b) { return buckets[b].size(); });
+
+  std::vector<Slot> slots(slot_count);
+  std::vector<std::uint32_t> seeds(bucket_count, 0);
+  std::vector<size_t> placed;
+  for (size_t b : order) {
+    const auto& keys = buckets[b];
+    if (keys.empty()) break;
+    std::uint32_t seed = 0;
+    for (;; ++seed) {
+      if (seed == kMaxSeed) return false;
+      placed.clear();
+      bool fits = true;
+      for (std::uint64_t key : keys) {
+        const size_t slot = slot_of(key, seed) & (slot_count - 1);
+        if (slots[slot].key != 0 ||
+            std::ranges::find(placed, slot) != placed.end()) {
+          fits = false;
+          break;
+        }
+        placed.push_back(slot);
+      }
+      if (fits) break;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+      slots[placed[i]] = {keys[i], m_short.at(keys[i])};
+    }
+    seeds[b] = seed;
+  }
+  m_slots = std::move(slots);
+  m_seeds = std::move(seeds);
+  return true;
+}
+
+std::optional<CategoryId> ExtensionTable::find_long(
+    std::string_view extension) const {
+  if (m_long.empty()) return std::nullopt;
+  if (auto it = m_long.find(extension); it != m_long.end()) return it->second;
+  return std::nullopt;
+}
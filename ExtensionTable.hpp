@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "AsciiCase.hpp"
+
+using CategoryId = std::uint16_t;
+
+// Maps file extensions (with their dot) to category ids, ignoring ASCII case.
+// Extensions of up to eight bytes, nearly all of them, are packed into a
+// word and lowercased in registers, then found in a perfect-hash table
+// (hash and displace: a key's bucket selects the seed that sends it to a slot
+// of its own) with one probe; longer ones fall back to a hash map. Lookups
+// never allocate.
+class ExtensionTable {
+ public:
+  // A later insert of the same extension replaces the earlier one. Only
+  // valid before build().
+  void insert(std::string_view extension, CategoryId id);
+  void build();
+
+  std::optional<CategoryId> find(std::string_view extension) const {
+    const size_t n = extension.size();
+    if (n == 0 || n > sizeof(std::uint64_t)) return find_long(extension);
+    if (m_slots.empty()) return std::nullopt;
+    const std::uint64_t key = pack(extension);
+    const std::uint64_t h = mix(key);
+    const std::uint32_t seed = m_seeds[bucket_of(h, m_seeds.size())];
+    const Slot& slot = m_slots[slot_of(key, seed) & (m_slots.size() - 1)];
+    if (slot.key != key) return std::nullopt;
+    return slot.id;
+  }
+
+ private:
+  struct Slot {
+    std::uint64_t key = 0;  // 0 marks an empty slot; names hold no NUL.
+    CategoryId id = 0;
+  };
+
+  static std::uint64_t pack(std::string_view extension) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, extension.data(), extension.size());
+    return AsciiCase::lower_word(word);
+  }
+  // MurmurHash3's fmix64.
+  static std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    return x ^ (x >> 33);
+  }
+  static size_t bucket_of(std::uint64_t h, size_t buckets) {
+    return static_cast<size_t>(((h >> 32) * buckets) >> 32);
+  }
+  static std::uint64_t slot_of(std::uint64_t key, std::uint32_t seed) {
+    return mix(key + seed * 0x9E3779B97F4A7C15ull);
+  }
+
+  bool try_build(size_t slot_count);
+  std::optional<CategoryId> find_long(std::string_view extension) const;
+
+  std::unordered_map<std::uint64_t, CategoryId> m_short;
+  AsciiCase::Map<CategoryId> m_long;
+  std::vector<std::uint32_t> m_seeds;  // One per bucket.
+  std::vector<Slot> m_slots;           // A power of two.
+};
@@ -3,8 +3,16 @@
 #include <chrono>
 #include <fstream>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <print>
+#include <set>
+
+#include "Deduplicator.hpp"
+#include "Journal.hpp"
+#include "MoveExecutor.hpp"
+#include "RootScheduler.hpp"
+#include "utils.hpp"
 
 #ifdef _WIN32
 #include <Shlobj.h>
@@ -18,36 +26,69 @@ std::ofstream& get_log_stream() {
   return log_file;
 }
 
-std::mutex log_mutex;
+// Only taken by the logger's writer thread and by set_log_handler.
+std::mutex handler_mutex;
 
 std::function<void(std::string_view)> g_log_handler = nullptr;
 
+Logger& get_logger() {
+  // Opened first so that it outlives the logger's final drain.
+  auto& log_stream = get_log_stream();
+  static Logger logger([&log_stream](std::string_view line,
+                                     bool end_of_batch) {
+    if (end_of_batch) {
+      log_stream.flush();
+      return;
+    }
+    {
+      std::scoped_lock lock(handler_mutex);
+      if (g_log_handler) g_log_handler(line);
+    }
+    if (log_stream.is_open()) log_stream << line << '\n';
+  });
+  return logger;
+}
+
+// Reconciles a journal left behind by a crash, once per process and right
+// before it is first appended to or undone, so that modes that only read
+// the disk (dry runs, browsing the TUI) never change it.
+void recover_journal_once(const fs::path& journalPath) {
+  static std::mutex mutex;
+  static std::set<std::string> recovered;
+  std::error_code ec;
+  const fs::path absolute = fs::absolute(journalPath, ec);
+  std::scoped_lock lock(mutex);
+  if (recovered.insert(safe_path_to_string(ec ? journalPath : absolute))
+          .second) {
+    Journal::recover(journalPath);
+  }
+}
+
 }  // namespace
 
-void IOManager::initialize_logger() { get_log_stream(); }
+void IOManager::initialize_logger() { get_logger(); }
 
 void IOManager::set_log_handler(std::function<void(std::string_view)> handler) {
-  std::scoped_lock lock(log_mutex);
+  std::scoped_lock lock(handler_mutex);
   g_log_handler = handler;
 }
 
 void IOManager::log(std::string_view message) {
-  std::scoped_lock lock(log_mutex);
-
-  auto now = std::chrono::system_clock::now();
-  auto time_str = std::format("{:%Y-%m-%d %H:%M:%S}", now);
-  std::string full_message = std::format("{} | {}", time_str, message);
+  get_logger().log(LogLevel::Info, message);
+}
 
-  if (g_log_handler) {
-    g_log_handler(full_message);
-  }
+void IOManager::log(LogLevel level, std::string_view message) {
+  get_logger().log(level, message);
+}
 
-  auto& log_stream = get_log_stream();
-  if (log_stream.is_open()) {
-    log_stream << full_message << "\n" << std::flush;
-  }
+void IOManager::set_log_level(LogLevel level) {
+  get_logger().set_min_level(level);
 }
 
+void IOManager::flush_log() { get_logger().flush(); }
+
+LoggerStats IOManager::log_stats() { return get_logger().stats(); }
+
 std::optional<fs::path> IOManager::get_downloads_folder_path() {
 #ifdef _WIN32
   PWSTR path_raw = nullptr;
@@ -100,7 +141,8 @@ std::optional<fs::path> IOManager::get_downloads_folder_path() {
 
 std::optional<Config> IOManager::load_config(const fs::path& configPath) {
   if (!fs::exists(configPath)) {
-    log(std::format("Error: Config file not found at {}", configPath.string()));
+    log(LogLevel::Error,
+        std::format("Error: Config file not found at {}", configPath.string()));
     return std::nullopt;
   }
   std::ifstream configFile(configPath);
@@ -113,52 +155,128 @@ std::optional<Config> IOManager::load_config(const fs::path& configPath) {
         config.categories[ext.get<std::string>()] = category;
     }
     config.rules = configJson["rules"].get<std::vector<Rule>>();
+    config.sniff_content = configJson.value("sniff_content", false);
     std::sort(
         config.rules.begin(), config.rules.end(),
         [](const auto& a, const auto& b) { return a.priority < b.priority; });
     return config;
   } catch (const json::exception& e) {
-    log(std::format("Error parsing config.json: {}", e.what()));
+    log(LogLevel::Error,
+        std::format("Error parsing config.json: {}", e.what()));
     return std::nullopt;
   }
 }
 
-void IOManager::run_undo(const fs::path& journalPath) {
-  if (!fs::exists(journalPath)) {
-    log("No journal file found. Nothing to undo.");
-    return;
+std::optional<std::vector<RootSpec>> IOManager::load_roots(
+    const fs::path& rootsPath) {
+  std::ifstream rootsFile(rootsPath);
+  if (!rootsFile) {
+    log(LogLevel::Error, std::format("Error: Roots file not found at {}",
+                                     rootsPath.string()));
+    return std::nullopt;
   }
-  std::ifstream journalFile(journalPath);
-  json j = json::parse(journalFile);
-  auto journal = j.get<std::vector<JournalEntry>>();
-  std::reverse(journal.begin(), journal.end());
-
-  log("Starting undo operation...");
-  for (const auto& entry : journal) {
-    if (entry.action == ActionType::MOVE) {
-      log(std::format("Undoing move: '{}' -> '{}'", entry.to.string(),
-                      entry.from.string()));
-      try {
-        if (entry.from.has_parent_path() &&
-            !fs::exists(entry.from.parent_path())) {
-          fs::create_directories(entry.from.parent_path());
-        }
-        fs::rename(entry.to, entry.from);
-      } catch (const fs::filesystem_error& e) {
-        log(std::format("   Error undoing move: {}", e.what()));
+  const fs::path base = rootsPath.parent_path();
+  auto resolve = [&](const json& value) {
+    const fs::path path = path_from_utf8(value.get<std::string>());
+    return path.is_relative() ? base / path : path;
+  };
+  try {
+    const json rootsJson = json::parse(rootsFile);
+    if (!rootsJson.is_array() || rootsJson.empty()) {
+      log(LogLevel::Error,
+          std::format("Error: {} must be a non-empty array of roots",
+                      rootsPath.string()));
+      return std::nullopt;
+    }
+    std::vector<RootSpec> roots;
+    // Two entries for one folder would run at once against the same files,
+    // journal and scan index.
+    std::map<std::string, fs::path> targets;
+    for (const auto& root : rootsJson) {
+      roots.push_back({resolve(root.at("target")),
+                       root.contains("config") ? resolve(root.at("config"))
+                                               : fs::path()});
+      const fs::path& target = roots.back().target;
+      auto [it, inserted] = targets.try_emplace(root_key(target), target);
+      if (!inserted) {
+        log(LogLevel::Error,
+            std::format("Error: {} lists '{}' and '{}', which are the same "
+                        "folder",
+                        rootsPath.string(), safe_path_to_string(it->second),
+                        safe_path_to_string(target)));
+        return std::nullopt;
       }
     }
+    return roots;
+  } catch (const json::exception& e) {
+    log(LogLevel::Error, std::format("Error parsing {}: {}",
+                                     rootsPath.string(), e.what()));
+    return std::nullopt;
   }
-  fs::remove(journalPath);
-  log("Undo complete. Journal file removed.");
 }
 
-void IOManager::save_journal(const fs::path& journalPath,
-                             const std::vector<JournalEntry>& journal) {
-  if (!journal.empty()) {
-    std::ofstream j_file(journalPath);
-    j_file << json(journal).dump(2);
-    log(std::format("Journal saved with {} actions. Use TUI to undo.",
-                    journal.size()));
+UndoResult IOManager::run_undo(const fs::path& journalPath,
+                               const UndoFilter& filter,
+                               const UndoOptions& options) {
+  recover_journal_once(journalPath);
+  if (!fs::exists(journalPath)) {
+    log("No journal file found. Nothing to undo.");
+    return {};
   }
-}
\ No newline at end of file
+  log("Starting undo operation...");
+  const UndoResult result = UndoEngine(options).run(journalPath, filter);
+  log(std::format("Undo complete: {} moves reverted, {} failed, {} kept.",
+                  result.undone, result.failed, result.skipped));
+  return result;
+}
+
+std::vector<JournalEntry> IOManager::apply_plan(
+    const std::vector<Action>& actions, const fs::path& journalPath,
+    std::stop_token stoken, const MoveExecutorOptions& options) {
+  recover_journal_once(journalPath);
+  auto journal = Journal::Writer::open(journalPath);
+  if (!journal) {
+    log("Refusing to move files without a journal to undo them.");
+    return {};
+  }
+  // Duplicates are resolved first, while the copies they are checked
+  // against are still where the plan found them.
+  std::vector<JournalEntry> performed;
+  std::vector<Action> moves;
+  for (const Action& action : actions) {
+    if (action.type == ActionType::MOVE) {
+      moves.push_back(action);
+      continue;
+    }
+    if (stoken.stop_requested()) break;
+    if (const std::error_code ec = Deduplicator::apply(action)) {
+      log(LogLevel::Error,
+          std::format("ERROR resolving duplicate {}: {}",
+                      safe_path_to_string(action.from), ec.message()));
+      continue;
+    }
+    log(std::format("Resolved duplicate '{}' of '{}' ({})",
+                    safe_path_to_string(action.from),
+                    safe_path_to_string(action.to),
+                    json(action.type).get<std::string>()));
+    JournalEntry entry{
+        action.type, action.from, action.to, action.category.name(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count()};
+    if (!journal->append(entry)) {
+      log(LogLevel::Error,
+          std::format("ERROR: could not journal duplicate '{}'",
+                      safe_path_to_string(action.from)));
+    }
+    performed.push_back(std::move(entry));
+  }
+  auto moved = MoveExecutor(options).execute(moves, stoken, journal.get());
+  performed.insert(performed.end(), std::make_move_iterator(moved.begin()),
+                   std::make_move_iterator(moved.end()));
+  if (!performed.empty()) {
+    log(std::format("Journal updated with {} actions. Use TUI to undo.",
+                    performed.size()));
+  }
+  return performed;
+}
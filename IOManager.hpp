@@ -2,7 +2,12 @@
 
 #include <functional>
 #include <optional>
+#include <stop_token>
+#include <vector>
 
+#include "Logger.hpp"
+#include "MoveExecutor.hpp"
+#include "UndoEngine.hpp"
 #include "types.hpp"
 
 namespace IOManager {
@@ -10,10 +15,36 @@ void initialize_logger();
 
 void set_log_handler(std::function<void(std::string_view)> handler);
 
+// Logging is asynchronous: messages are queued and written by a background
+// thread, so the UI handler is also called from that thread.
 void log(std::string_view message);
+void log(LogLevel level, std::string_view message);
+void set_log_level(LogLevel level);
+// Blocks until every message logged so far has been written.
+void flush_log();
+LoggerStats log_stats();
 std::optional<fs::path> get_downloads_folder_path();
 std::optional<Config> load_config(const fs::path& configPath);
-void run_undo(const fs::path& journalPath);
-void save_journal(const fs::path& journalPath,
-                  const std::vector<JournalEntry>& journal);
+// Reads a roots file for a multi-root run: a JSON array of
+// {"target": DIR, "config": FILE} objects. Relative paths are resolved
+// against the file's folder. A root without "config" gets an empty one, for
+// the default config. Fails if two entries name the same folder.
+std::optional<std::vector<RootSpec>> load_roots(const fs::path& rootsPath);
+// Journal recovery (Journal::recover) runs on a journal once per process,
+// at the first call to run_undo or apply_plan with it.
+
+// Reverts the journaled moves selected by `filter`, newest first.
+UndoResult run_undo(const fs::path& journalPath,
+                    const UndoFilter& filter = {},
+                    const UndoOptions& options = {});
+// Moves each action's source to its destination, creating destination
+// directories as needed and never overwriting existing files. Duplicate
+// actions (REMOVE, HARDLINK, REFLINK) are performed before any move. Each
+// action is appended to the journal at `journalPath` as it completes.
+// Returns the journal of the actions that were actually performed:
+// duplicates first, then moves in plan order.
+std::vector<JournalEntry> apply_plan(const std::vector<Action>& actions,
+                                     const fs::path& journalPath,
+                                     std::stop_token stoken = {},
+                                     const MoveExecutorOptions& options = {});
 }  // namespace IOManager
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "Journal.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <string>
+
+#include "IOManager.hpp"
+#include "utils.hpp"
+
+#include <fcntl.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace Journal {
+namespace {
+std::FILE* open_for_append(const fs::path& path) {
+#ifdef _WIN32
+  return ::_wfopen(path.c_str(), L"ab");
+#else
+  return std::fopen(path.c_str(), "ab");
+#endif
+}
+
+std::error_code sync_file(std::FILE* file) {
+#ifdef _WIN32
+  const int result = ::_commit(::_fileno(file));
+#elif defined(__APPLE__)
+  const int result = ::fsync(::fileno(file));
+#else
+  const int result = ::fdatasync(::fileno(file));
+#endif
+  if (result == 0) return {};
+  return {errno, std::generic_category()};
+}
+
+bool sync_path(const fs::path& path) {
+#ifdef _WIN32
+  const int fd = ::_wopen(path.c_str(), _O_RDWR | _O_BINARY);
+  if (fd < 0) return false;
+  const bool ok = ::_commit(fd) == 0;
+  ::_close(fd);
+  return ok;
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  const bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+#endif
+}
+
+std::optional<JournalEntry> parse_line(const std::string& line) {
+  try {
+    return json::parse(line).get<JournalEntry>();
+  } catch (const json::exception&) {
+    return std::nullopt;
+  }
+}
+
+// Returns whether the file has the older single-array layout.
+bool is_legacy_array(std::ifstream& in) {
+  char c = 0;
+  while (in.get(c) && std::isspace(static_cast<unsigned char>(c))) {
+  }
+  const bool legacy = in && c == '[';
+  in.clear();
+  in.seekg(0);
+  return legacy;
+}
+
+// A line of a journal, and its entry if it could be parsed.
+struct Record {
+  std::string text;
+  std::optional<JournalEntry> entry;
+};
+
+struct Contents {
+  std::vector<Record> records;
+  // The file is a single JSON array, from an older version.
+  bool legacy = false;
+  // The file could not be parsed as a whole (legacy arrays only).
+  bool unreadable = false;
+  // The final line had no newline; `torn` if it could not be parsed either,
+  // which is what a crash in the middle of an append leaves.
+  bool unterminated = false;
+  bool torn = false;
+};
+
+// Reads every line. Lines that cannot be parsed are kept, without an entry,
+// except for a torn final line.
+Contents read_contents(const fs::path& path) {
+  Contents contents;
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return contents;
+
+  if (is_legacy_array(in)) {
+    contents.legacy = true;
+    try {
+      for (auto& entry :
+           json::parse(in).get<std::vector<JournalEntry>>()) {
+        contents.records.push_back({json(entry).dump(), std::move(entry)});
+      }
+    } catch (const json::exception& e) {
+      IOManager::log(LogLevel::Error,
+                     std::format("Journal '{}' is unreadable: {}",
+                                 safe_path_to_string(path), e.what()));
+      contents.records.clear();
+      contents.unreadable = true;
+    }
+    return contents;
+  }
+
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.empty()) continue;
+    auto entry = parse_line(line);
+    if (in.eof()) {
+      contents.unterminated = true;
+      if (!entry) {
+        contents.torn = true;
+        break;
+      }
+    } else if (!entry) {
+      IOManager::log(LogLevel::Warning,
+                     std::format("Journal '{}': line {} is unreadable; kept "
+                                 "as is",
+                                 safe_path_to_string(path), line_number));
+    }
+    contents.records.push_back({std::move(line), std::move(entry)});
+  }
+  return contents;
+}
+
+// Replaces the journal with the given lines, each terminated.
+bool write_records(const fs::path& path, const std::vector<Record>& records) {
+  const fs::path tmp = fs::path(path).concat(".tmp");
+#ifdef _WIN32
+  std::FILE* file = ::_wfopen(tmp.c_str(), L"wb");
+#else
+  std::FILE* file = std::fopen(tmp.c_str(), "wb");
+#endif
+  if (!file) return false;
+  bool ok = true;
+  for (const auto& record : records) {
+    ok = ok &&
+         std::fwrite(record.text.data(), 1, record.text.size(), file) ==
+             record.text.size() &&
+         std::fputc('\n', file) != EOF;
+  }
+  ok = std::fclose(file) == 0 && ok;
+  return ok && replace(tmp, path);
+}
+}  // namespace
+
+bool replace(const fs::path& tmp, const fs::path& path) {
+  if (!sync_path(tmp)) return false;
+  std::error_code ec;
+  fs::rename(tmp, path, ec);
+  if (ec) return false;
+#ifndef _WIN32
+  // Directories cannot be opened for syncing on Windows, where the rename
+  // is written through by the file system.
+  sync_path(path.has_parent_path() ? path.parent_path() : fs::path("."));
+#endif
+  return true;
+}
+
+std::unique_ptr<Writer> Writer::open(const fs::path& path,
+                                     WriterOptions options) {
+  std::FILE* file = open_for_append(path);
+  if (!file) {
+    IOManager::log(LogLevel::Error,
+                   std::format("ERROR: cannot open journal '{}'",
+                               safe_path_to_string(path)));
+    return nullptr;
+  }
+  return std::unique_ptr<Writer>(new Writer(file, options));
+}
+
+Writer::Writer(std::FILE* file, WriterOptions options)
+    : m_file(file),
+      m_options(options),
+      m_syncer([this](std::stop_token st) { sync_loop(st); }) {}
+
+Writer::~Writer() {
+  m_syncer.request_stop();
+  m_syncer.join();
+  sync();
+  std::fclose(m_file);
+}
+
+bool Writer::append(const JournalEntry& entry) {
+  std::string line = json(entry).dump();
+  line.push_back('\n');
+
+  std::scoped_lock lock(m_mutex);
+  // Each line reaches the OS right away; only the fsync is deferred.
+  if (std::fwrite(line.data(), 1, line.size(), m_file) != line.size() ||
+      std::fflush(m_file) != 0) {
+    return false;
+  }
+  ++m_written;
+  if (++m_unsynced >= m_options.sync_every) m_cv.notify_one();
+  return true;
+}
+
+bool Writer::sync() {
+  std::scoped_lock sync_lock(m_sync_mutex);
+  size_t syncing = 0;
+  {
+    std::scoped_lock lock(m_mutex);
+    if (m_unsynced == 0) return true;
+    syncing = m_unsynced;
+  }
+  if (auto ec = sync_file(m_file)) {
+    IOManager::log(LogLevel::Error,
+                   std::format("ERROR: could not sync the journal: {}",
+                               ec.message()));
+    return false;
+  }
+  // Entries appended during the sync are left for the next one.
+  std::scoped_lock lock(m_mutex);
+  m_unsynced -= syncing;
+  return true;
+}
+
+size_t Writer::entries_written() const {
+  std::scoped_lock lock(m_mutex);
+  return m_written;
+}
+
+void Writer::sync_loop(std::stop_token stoken) {
+  std::unique_lock lock(m_mutex);
+  while (!stoken.stop_requested()) {
+    m_cv.wait_for(lock, stoken, m_options.sync_interval, [&] {
+      return m_unsynced >= m_options.sync_every;
+    });
+    if (m_unsynced == 0) continue;
+    lock.unlock();
+    const bool synced = sync();
+    lock.lock();
+    // A failed sync is retried after the interval, not in a busy loop.
+    if (!synced) {
+      m_cv.wait_for(lock, stoken, m_options.sync_interval,
+                    [] { return false; });
+    }
+  }
+}
+
+ReverseReader::ReverseReader(const fs::path& path)
+    : m_in(path, std::ios::binary | std::ios::ate) {
+  if (!m_in) return;
+  const auto size = m_in.tellg();
+  if (size < 0) return;
+  m_buffer_start = static_cast<std::uint64_t>(size);
+  m_ok = true;
+}
+
+std::optional<ReverseReader::Line> ReverseReader::previous() {
+  constexpr std::uint64_t kBlockSize = 64 * 1024;
+  if (!m_ok) return std::nullopt;
+
+  for (;;) {
+    // The line ends at the buffer's end, minus its newline if it has one.
+    size_t end = m_buffer.size();
+    if (end > 0 && m_buffer[end - 1] == '\n') --end;
+    const size_t newline = end == 0 ? std::string::npos
+                                    : m_buffer.rfind('\n', end - 1);
+
+    if (newline == std::string::npos && m_buffer_start > 0) {
+      // The line starts in an earlier block.
+      const std::uint64_t read_size = std::min(kBlockSize, m_buffer_start);
+      m_buffer_start -= read_size;
+      std::string block(read_size, '\0');
+      m_in.seekg(static_cast<std::streamoff>(m_buffer_start));
+      if (!m_in.read(block.data(), static_cast<std::streamsize>(read_size))) {
+        m_ok = false;
+        return std::nullopt;
+      }
+      m_buffer.insert(0, block);
+      continue;
+    }
+
+    const size_t start = newline == std::string::npos ? 0 : newline + 1;
+    if (start == 0 && end == 0 && m_buffer.empty()) return std::nullopt;
+
+    Line line{m_buffer_start + start, m_buffer.substr(start, end - start)};
+    m_buffer.resize(start);
+    if (!line.text.empty()) return line;
+  }
+}
+
+bool is_legacy(const fs::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return in && is_legacy_array(in);
+}
+
+std::vector<JournalEntry> read(const fs::path& path) {
+  std::vector<JournalEntry> entries;
+  for (auto& record : read_contents(path).records) {
+    if (record.entry) entries.push_back(std::move(*record.entry));
+  }
+  return entries;
+}
+
+size_t recover(const fs::path& path) {
+  std::error_code ec;
+  if (!fs::exists(path, ec)) return 0;
+
+  Contents contents = read_contents(path);
+  if (contents.unreadable) {
+    // Nothing in it can be undone automatically, but it is not discarded.
+    const fs::path aside = fs::path(path).concat(std::format(
+        ".unreadable-{}",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count()));
+    fs::rename(path, aside, ec);
+    IOManager::log(LogLevel::Error,
+                   ec ? std::format("ERROR: could not move unreadable journal "
+                                    "'{}' aside: {}",
+                                    safe_path_to_string(path), ec.message())
+                      : std::format("Journal recovery: moved unreadable "
+                                    "journal aside to '{}'.",
+                                    safe_path_to_string(aside)));
+    return 0;
+  }
+
+  // A move is still in effect if its destination exists, or if neither side
+  // exists any more (the user moved it on; keep it rather than guess).
+  // Unreadable lines are always kept.
+  auto& records = contents.records;
+  const size_t total = records.size();
+  std::erase_if(records, [](const Record& record) {
+    if (!record.entry) return false;
+    std::error_code ec;
+    return !fs::exists(record.entry->to, ec) &&
+           fs::exists(record.entry->from, ec);
+  });
+  const size_t dropped = total - records.size();
+  const size_t kept = static_cast<size_t>(
+      std::ranges::count_if(records, [](const Record& record) {
+        return record.entry.has_value();
+      }));
+
+  if (records.empty()) {
+    fs::remove(path, ec);
+    if (contents.torn || dropped > 0) {
+      IOManager::log("Journal recovery: no moves left to undo; removed it.");
+    }
+    return 0;
+  }
+  // The file is rewritten whenever an append to it would not start a line
+  // of its own.
+  if (!contents.legacy && !contents.unterminated && dropped == 0) {
+    return kept;
+  }
+
+  if (!write_records(path, records)) {
+    IOManager::log(LogLevel::Error,
+                   std::format("ERROR: journal recovery could not rewrite '{}'",
+                               safe_path_to_string(path)));
+    return kept;
+  }
+  IOManager::log(std::format(
+      "Journal recovery: kept {} entries, dropped {} already undone{}{}.",
+      kept, dropped, contents.torn ? ", cut off a torn record" : "",
+      contents.legacy ? ", converted to JSON Lines" : ""));
+  return kept;
+}
+
+}  // namespace Journal
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+// The undo journal, stored as JSON Lines: one JournalEntry per line, appended
+// as each move completes. A crash can therefore only lose the moves that
+// were not yet synced, and at worst leave a torn final line. A move is
+// recorded after its rename, since only then is its final name known; a
+// crash between the two leaves that one move out of the journal, so it
+// cannot be undone automatically.
+namespace Journal {
+
+struct WriterOptions {
+  // Entries are flushed to the OS immediately but fsynced in groups: after
+  // this many entries, or after `sync_interval`, whichever comes first.
+  size_t sync_every = 256;
+  std::chrono::milliseconds sync_interval{50};
+};
+
+class Writer {
+ public:
+  // Opens `path` for appending. Returns nullptr if it cannot be opened.
+  static std::unique_ptr<Writer> open(const fs::path& path,
+                                      WriterOptions options = {});
+  // Syncs any remaining entries.
+  ~Writer();
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  // Thread-safe. Returns false if the entry could not be written.
+  bool append(const JournalEntry& entry);
+  // Blocks until every appended entry is durable. Returns false, and logs,
+  // if the sync failed; its entries are then synced again on the next call.
+  bool sync();
+
+  size_t entries_written() const;
+
+ private:
+  Writer(std::FILE* file, WriterOptions options);
+  void sync_loop(std::stop_token stoken);
+
+  std::FILE* m_file;
+  const WriterOptions m_options;
+  mutable std::mutex m_mutex;
+  std::condition_variable_any m_cv;
+  size_t m_written = 0;
+  size_t m_unsynced = 0;
+  // Serializes fsync calls so that sync() can wait for an in-flight one.
+  std::mutex m_sync_mutex;
+  std::jthread m_syncer;
+};
+
+// Reads a journal's lines from last to first, one block at a time, so that
+// undo can walk a large journal without loading it.
+class ReverseReader {
+ public:
+  struct Line {
+    // Byte offset of the line in the file, and its text without the newline.
+    std::uint64_t offset = 0;
+    std::string text;
+  };
+
+  explicit ReverseReader(const fs::path& path);
+  bool ok() const { return m_ok; }
+  // Returns the previous non-empty line, or std::nullopt at the start.
+  std::optional<Line> previous();
+
+ private:
+  std::ifstream m_in;
+  bool m_ok = false;
+  // Unconsumed bytes, which start at file offset m_buffer_start.
+  std::string m_buffer;
+  std::uint64_t m_buffer_start = 0;
+};
+
+// Returns whether the journal uses the older single-array layout.
+bool is_legacy(const fs::path& path);
+
+// Reads every entry, ignoring lines that cannot be parsed. Also accepts the
+// older format, a single JSON array.
+std::vector<JournalEntry> read(const fs::path& path);
+
+// Syncs the finished file `tmp`, renames it over `path` and syncs the
+// directory, so that a crash leaves either the old or the new journal.
+// Returns false, leaving `path` as it was, if `tmp` cannot be synced or
+// renamed.
+bool replace(const fs::path& tmp, const fs::path& path);
+
+// Startup recovery. Cuts off a torn final line left by a crash, converts an
+// older array journal to JSON Lines, and drops entries whose move is no
+// longer in effect (e.g. an undo that was interrupted part-way). Other lines
+// that cannot be parsed are kept as they are, and an array journal that
+// cannot be parsed is renamed aside. Removes the journal when nothing is
+// left. Returns the number of entries kept.
+size_t recover(const fs::path& path);
+
+}  // namespace Journal
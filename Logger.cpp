@@ -0,0 +1,170 @@
+#include "Logger.hpp"
+
+#include <bit>
+#include <format>
+#include <vector>
+
+Logger::Logger(Sink sink, LoggerOptions options)
+    : m_sink(std::move(sink)),
+      m_options(options),
+      m_min_level(options.min_level),
+      m_mask(std::bit_ceil(std::max<size_t>(2, options.capacity)) - 1),
+      m_cells(new Cell[m_mask + 1]) {
+  for (size_t i = 0; i <= m_mask; ++i) {
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  m_writer = std::jthread([this](std::stop_token st) { writer_loop(st); });
+}
+
+Logger::~Logger() {
+  m_writer.request_stop();
+  wake_writer();
+  m_writer.join();
+}
+
+bool Logger::log(LogLevel level, std::string_view message) {
+  if (level < m_min_level.load(std::memory_order_relaxed)) return false;
+
+  Record record{level, std::chrono::system_clock::now(), std::string(message)};
+  while (!try_push(record)) {
+    if (level < m_options.never_drop_level) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    wake_writer();
+    std::this_thread::yield();
+  }
+  // Pairs with the fence in writer_loop: either the writer sees this record
+  // when it re-checks the queue, or this thread sees that it is asleep.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_writer_sleeping.load(std::memory_order_relaxed)) wake_writer();
+  return true;
+}
+
+// Bounded MPMC queue after D. Vyukov, used with a single consumer. Each cell's
+// sequence tells producers whether it is free for a given position.
+bool Logger::try_push(Record& record) {
+  std::uint64_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = m_cells[pos & m_mask];
+    const std::uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+    const auto diff = static_cast<std::int64_t>(seq - pos);
+    if (diff == 0) {
+      if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+        cell.record = std::move(record);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;  // Full.
+    } else {
+      pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::wake_writer() {
+  m_wake.fetch_add(1, std::memory_order_release);
+  m_wake.notify_one();
+}
+
+void Logger::flush() {
+  const std::uint64_t target = m_enqueue_pos.load(std::memory_order_acquire);
+  wake_writer();
+  for (std::uint64_t done = m_consumed.load(std::memory_order_acquire);
+       done < target; done = m_consumed.load(std::memory_order_acquire)) {
+    m_consumed.wait(done, std::memory_order_acquire);
+  }
+}
+
+LoggerStats Logger::stats() const {
+  return {m_written.load(std::memory_order_relaxed),
+          m_dropped.load(std::memory_order_relaxed),
+          m_suppressed.load(std::memory_order_relaxed)};
+}
+
+void Logger::writer_loop(std::stop_token stoken) {
+  std::uint64_t pos = 0;
+  std::vector<Record> batch;
+
+  // Timestamps are formatted at most once per second.
+  std::chrono::sys_seconds cached_second{};
+  std::string cached_stamp;
+  auto emit = [&](std::chrono::system_clock::time_point time,
+                  std::string_view text) {
+    const auto second = std::chrono::floor<std::chrono::seconds>(time);
+    if (second != cached_second || cached_stamp.empty()) {
+      cached_second = second;
+      cached_stamp = std::format("{:%Y-%m-%d %H:%M:%S}", second);
+    }
+    m_sink(std::format("{} | {}", cached_stamp, text), false);
+    m_written.fetch_add(1, std::memory_order_relaxed);
+  };
+
+  std::string last_message;
+  std::chrono::system_clock::time_point last_time;
+  std::uint64_t repeats = 0;
+  std::uint64_t reported_drops = 0;
+  auto flush_repeats = [&] {
+    if (repeats == 0) return;
+    emit(last_time, std::format("(previous message repeated {} more times)",
+                                repeats));
+    repeats = 0;
+  };
+
+  for (;;) {
+    const std::uint32_t wake = m_wake.load(std::memory_order_acquire);
+
+    batch.clear();
+    for (;;) {
+      Cell& cell = m_cells[pos & m_mask];
+      if (cell.sequence.load(std::memory_order_acquire) != pos + 1) break;
+      batch.push_back(std::move(cell.record));
+      cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+      ++pos;
+    }
+
+    if (!batch.empty()) {
+      for (const Record& record : batch) {
+        if (record.message == last_message &&
+            record.time - last_time < m_options.duplicate_window) {
+          ++repeats;
+          m_suppressed.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        flush_repeats();
+        emit(record.time, record.message);
+        last_message = record.message;
+        last_time = record.time;
+      }
+      const std::uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+      if (dropped != reported_drops) {
+        emit(std::chrono::system_clock::now(),
+             std::format("[logger] {} messages dropped, buffer full",
+                         dropped - reported_drops));
+        reported_drops = dropped;
+      }
+      m_sink({}, true);
+      m_consumed.store(pos, std::memory_order_release);
+      m_consumed.notify_all();
+      continue;
+    }
+
+    if (stoken.stop_requested()) break;
+    // Queue looked empty: announce sleep, then check once more before
+    // waiting, so that a record published in between is not missed.
+    m_writer_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool empty =
+        m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) !=
+        pos + 1;
+    if (empty && !stoken.stop_requested()) {
+      m_wake.wait(wake, std::memory_order_acquire);
+    }
+    m_writer_sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  flush_repeats();
+  m_sink({}, true);
+}
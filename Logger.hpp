@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel : std::uint8_t { Debug, Info, Warning, Error };
+
+struct LoggerOptions {
+  // Ring buffer slots; rounded up to a power of two.
+  size_t capacity = 8192;
+  LogLevel min_level = LogLevel::Info;
+  // When the buffer is full, messages below this level are dropped and
+  // counted; messages at or above it wait for space instead.
+  LogLevel never_drop_level = LogLevel::Error;
+  // Repeats of the previous message within this window are collapsed into a
+  // single "repeated N times" line.
+  std::chrono::milliseconds duplicate_window{1000};
+};
+
+struct LoggerStats {
+  std::uint64_t written = 0;
+  std::uint64_t dropped = 0;
+  std::uint64_t suppressed = 0;
+};
+
+// An asynchronous logger. Producers only claim a slot in a bounded
+// multi-producer ring buffer; a dedicated thread formats timestamps, drops
+// duplicates and hands whole batches to the sink.
+class Logger {
+ public:
+  // Receives each finished line, without a trailing newline, and a flush
+  // call (empty line, `end_of_batch` true) after every batch.
+  using Sink = std::function<void(std::string_view line, bool end_of_batch)>;
+
+  explicit Logger(Sink sink, LoggerOptions options = {});
+  // Writes everything still queued.
+  ~Logger();
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  // Never takes a lock. Returns false if the message was filtered or dropped.
+  bool log(LogLevel level, std::string_view message);
+  // Blocks until every message logged before the call has reached the sink.
+  void flush();
+
+  void set_min_level(LogLevel level) {
+    m_min_level.store(level, std::memory_order_relaxed);
+  }
+  LoggerStats stats() const;
+
+ private:
+  struct Record {
+    LogLevel level = LogLevel::Info;
+    std::chrono::system_clock::time_point time;
+    std::string message;
+  };
+  struct Cell {
+    std::atomic<std::uint64_t> sequence;
+    Record record;
+  };
+
+  bool try_push(Record& record);
+  void wake_writer();
+  void writer_loop(std::stop_token stoken);
+
+  const Sink m_sink;
+  const LoggerOptions m_options;
+  std::atomic<LogLevel> m_min_level;
+
+  const size_t m_mask;
+  std::unique_ptr<Cell[]> m_cells;
+  alignas(64) std::atomic<std::uint64_t> m_enqueue_pos = 0;
+  // Records the writer has consumed; flush() waits on it.
+  alignas(64) std::atomic<std::uint64_t> m_consumed = 0;
+  std::atomic<std::uint32_t> m_wake = 0;
+  std::atomic<bool> m_writer_sleeping = false;
+
+  std::atomic<std::uint64_t> m_written = 0;
+  std::atomic<std::uint64_t> m_dropped = 0;
+  std::atomic<std::uint64_t> m_suppressed = 0;
+
+  std::jthread m_writer;
+};
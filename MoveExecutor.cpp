@@ -0,0 +1,408 @@
+#include "MoveExecutor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+
+#include "CrossDevice.hpp"
+#include "IOManager.hpp"
+#include "NameIndex.hpp"
+#include "WorkerPool.hpp"
+#include "utils.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+#include <stdio.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace {
+// How often a move is retried under a new name when another process creates
+// the chosen name between indexing and renaming.
+constexpr int kMaxNameAttempts = 64;
+struct DestinationGroup {
+  fs::path directory;
+  std::vector<size_t> action_indices;
+  std::uint64_t dev = 0;
+};
+
+// A directory that names are resolved against. On POSIX this holds an open
+// descriptor so that each rename skips the path walk to its parent.
+class DirHandle {
+ public:
+  explicit DirHandle(const fs::path& path) : m_path(path) {
+#ifndef _WIN32
+    m_fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat st {};
+    if (m_fd >= 0 && ::fstat(m_fd, &st) == 0) {
+      m_dev = static_cast<std::uint64_t>(st.st_dev);
+    }
+#endif
+  }
+  DirHandle(const DirHandle&) = delete;
+  DirHandle& operator=(const DirHandle&) = delete;
+  ~DirHandle() {
+#ifndef _WIN32
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+  }
+
+  bool ok() const {
+#ifndef _WIN32
+    return m_fd >= 0;
+#else
+    return true;
+#endif
+  }
+  const fs::path& path() const { return m_path; }
+  // The device the directory is on; 0 where unknown.
+  std::uint64_t dev() const { return m_dev; }
+#ifndef _WIN32
+  int fd() const { return m_fd; }
+#endif
+
+ private:
+  fs::path m_path;
+  std::uint64_t m_dev = 0;
+#ifndef _WIN32
+  int m_fd = -1;
+#endif
+};
+
+#ifdef __linux__
+// Devices whose kernel or filesystem rejects RENAME_NOREPLACE. rename(2)
+// also fails with EINVAL for reasons of its own, such as moving a directory
+// into itself, so a device is only added once a plain rename of the same
+// entry succeeded.
+class NoReplaceSupport {
+ public:
+  bool supported(std::uint64_t dev) const {
+    std::scoped_lock lock(m_mutex);
+    return !m_unsupported.contains(dev);
+  }
+  void mark_unsupported(std::uint64_t dev) {
+    std::scoped_lock lock(m_mutex);
+    if (m_unsupported.insert(dev).second) {
+      IOManager::log(LogLevel::Warning,
+                     std::format("Device {}:{} does not support atomic "
+                                 "no-replace renames; checking names first.",
+                                 major(dev), minor(dev)));
+    }
+  }
+
+ private:
+  mutable std::mutex m_mutex;
+  std::set<std::uint64_t> m_unsupported;
+};
+NoReplaceSupport g_noreplace;
+#endif
+
+// Renames without ever replacing an existing destination; fails with
+// errc::file_exists instead.
+std::error_code rename_noreplace(const DirHandle& from_dir,
+                                 const fs::path& from_name,
+                                 const DirHandle& to_dir,
+                                 const fs::path& to_name) {
+#ifndef _WIN32
+#ifdef __linux__
+  bool flag_rejected = false;
+  if (g_noreplace.supported(to_dir.dev())) {
+    if (::renameat2(from_dir.fd(), from_name.c_str(), to_dir.fd(),
+                    to_name.c_str(), RENAME_NOREPLACE) == 0) {
+      return {};
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+      return {errno, std::generic_category()};
+    }
+    flag_rejected = true;
+  }
+#endif
+  // No atomic primitive available: check, then rename.
+  struct stat st {};
+  if (::fstatat(to_dir.fd(), to_name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+    return std::make_error_code(std::errc::file_exists);
+  }
+  if (::renameat(from_dir.fd(), from_name.c_str(), to_dir.fd(),
+                 to_name.c_str()) != 0) {
+    return {errno, std::generic_category()};
+  }
+#ifdef __linux__
+  // The rename itself was valid, so it was the flag that was rejected.
+  if (flag_rejected) g_noreplace.mark_unsupported(to_dir.dev());
+#endif
+  return {};
+#else
+  std::error_code ec;
+  const fs::path to_path = to_dir.path() / to_name;
+  if (fs::exists(to_path, ec)) {
+    return std::make_error_code(std::errc::file_exists);
+  }
+  fs::rename(from_dir.path() / from_name, to_path, ec);
+  return ec;
+#endif
+}
+
+std::uint64_t device_of(const fs::path& path) {
+#ifndef _WIN32
+  struct stat st {};
+  if (::stat(path.c_str(), &st) == 0) {
+    return static_cast<std::uint64_t>(st.st_dev);
+  }
+#else
+  (void)path;
+#endif
+  return 0;
+}
+
+#ifdef __linux__
+// Reads the block layer's rotational flag for a device, checking the parent
+// device for partitions. Returns std::nullopt for virtual filesystems.
+std::optional<bool> is_rotational(std::uint64_t dev) {
+  const fs::path base = std::format("/sys/dev/block/{}:{}", major(dev),
+                                    minor(dev));
+  for (const fs::path& candidate :
+       {base / "queue/rotational", base / "../queue/rotational"}) {
+    std::ifstream in(candidate);
+    int value = 0;
+    if (in >> value) return value != 0;
+  }
+  return std::nullopt;
+}
+#endif
+}  // namespace
+
+MoveExecutor::MoveExecutor(MoveExecutorOptions options)
+    : m_options(options) {}
+
+unsigned MoveExecutor::limit_for_device(std::uint64_t dev) const {
+#ifdef __linux__
+  if (is_rotational(dev).value_or(false)) {
+    return std::max(1u, m_options.rotational_device_limit);
+  }
+#else
+  (void)dev;
+#endif
+  return std::max(1u, m_options.per_device_limit);
+}
+
+std::vector<JournalEntry> MoveExecutor::execute(
+    const std::vector<Action>& actions, std::stop_token stoken,
+    Journal::Writer* journal) const {
+  // Group by destination directory, keeping first-seen order.
+  std::vector<DestinationGroup> groups;
+  {
+    std::map<fs::path, size_t> group_of;
+    for (size_t i = 0; i < actions.size(); ++i) {
+      const fs::path dir = actions[i].to.parent_path();
+      auto [it, inserted] = group_of.try_emplace(dir, groups.size());
+      if (inserted) groups.push_back({dir, {}, 0});
+      groups[it->second].action_indices.push_back(i);
+    }
+  }
+
+  // Each destination directory is created exactly once, up front, so that
+  // its device is known before scheduling.
+  std::list<size_t> pending;
+  std::map<std::uint64_t, unsigned> device_limits;
+  for (size_t g = 0; g < groups.size(); ++g) {
+    auto& group = groups[g];
+    std::error_code ec;
+    if (fs::create_directories(group.directory, ec)) {
+      IOManager::log(std::format("[DIR] Creating directory: '{}'",
+                                 safe_path_to_string(group.directory)));
+    } else if (ec) {
+      IOManager::log(
+          std::format("[DIR] Failed to create directory '{}': {}",
+                      safe_path_to_string(group.directory), ec.message()));
+      continue;
+    }
+    group.dev = device_of(group.directory);
+    if (!device_limits.contains(group.dev)) {
+      device_limits[group.dev] = limit_for_device(group.dev);
+    }
+    pending.push_back(g);
+  }
+
+  std::vector<std::optional<JournalEntry>> results(actions.size());
+  std::mutex schedule_mutex;
+  std::condition_variable_any schedule_cv;
+  std::map<std::uint64_t, unsigned> device_active;
+
+  auto process_group = [&](const DestinationGroup& group) {
+    DirHandle to_dir(group.directory);
+    if (!to_dir.ok()) {
+      IOManager::log(LogLevel::Error,
+                     std::format("ERROR opening directory '{}'",
+                                 safe_path_to_string(group.directory)));
+      return;
+    }
+    std::map<fs::path, std::unique_ptr<DirHandle>> from_dirs;
+    DirectoryNameIndex names(group.directory);
+
+    for (size_t index : group.action_indices) {
+      if (stoken.stop_requested()) return;
+      // One action that throws is logged and skipped; the rest of the
+      // group is still moved.
+      try {
+        const Action& action = actions[index];
+        const fs::path from_parent = action.from.parent_path();
+
+        auto& from_dir = from_dirs[from_parent];
+        if (!from_dir) from_dir = std::make_unique<DirHandle>(from_parent);
+        if (!from_dir->ok()) {
+          IOManager::log(LogLevel::Error,
+                         std::format("ERROR moving file {}: cannot open '{}'",
+                                     safe_path_to_string(action.from),
+                                     safe_path_to_string(from_parent)));
+          continue;
+        }
+
+        // Across filesystems the source is first copied into the directory
+        // under a temporary name, which then takes a free name like a local
+        // rename would. Bind mounts of one filesystem share a device but still
+        // refuse renames, so EXDEV switches to a copy as well.
+        const std::string wanted = safe_path_to_string(action.to.filename());
+        fs::path final_to_path;
+        std::error_code ec;
+        std::optional<CrossDevice::StagedCopy> staged;
+        auto stage = [&] {
+          staged = CrossDevice::StagedCopy::create(action.from, group.directory,
+                                                   ec);
+          return staged.has_value();
+        };
+        if (from_dir->dev() != to_dir.dev() && !stage()) {
+          IOManager::log(LogLevel::Error,
+                         std::format("ERROR copying file {}: {}",
+                                     safe_path_to_string(action.from),
+                                     ec.message()));
+          continue;
+        }
+        for (int attempt = 0; attempt < kMaxNameAttempts; ++attempt) {
+          const std::string name = names.claim(wanted);
+          final_to_path = group.directory / path_from_utf8(name);
+          ec = staged ? rename_noreplace(to_dir, staged->path().filename(),
+                                         to_dir, final_to_path.filename())
+                      : rename_noreplace(*from_dir, action.from.filename(),
+                                         to_dir, final_to_path.filename());
+          if (ec == std::errc::cross_device_link && !staged) {
+            if (!stage()) {
+              names.release(name);
+              break;
+            }
+            ec = rename_noreplace(to_dir, staged->path().filename(), to_dir,
+                                  final_to_path.filename());
+          }
+          // On a collision the name stays claimed; the next one is tried.
+          if (ec != std::errc::file_exists) {
+            if (ec) names.release(name);
+            break;
+          }
+        }
+        if (!ec && staged) ec = staged->commit(final_to_path);
+        if (ec) {
+          IOManager::log(LogLevel::Error,
+                         std::format("ERROR moving file {}: {}",
+                                     safe_path_to_string(action.from),
+                                     ec.message()));
+          continue;
+        }
+        const MoveMethod method =
+            staged ? staged->method() : MoveMethod::Rename;
+        IOManager::log(std::format(
+            "Moving '{}' -> '{}'{}", safe_path_to_string(action.from),
+            safe_path_to_string(final_to_path),
+            staged ? std::format(" (copied with {})",
+                                 json(method).get<std::string>())
+                   : std::string()));
+        results[index] = JournalEntry{
+            ActionType::MOVE, action.from, final_to_path,
+            action.category.name(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count(),
+            method};
+        // Recorded once the move has its final name. A crash before this
+        // line leaves the move out of the journal (see Journal.hpp).
+        if (journal && !journal->append(*results[index])) {
+          IOManager::log(LogLevel::Error,
+                         std::format("ERROR: could not journal move of '{}'",
+                                     safe_path_to_string(action.from)));
+        }
+      } catch (const std::exception& e) {
+        IOManager::log(LogLevel::Error,
+                       std::format("ERROR moving file {}: {}",
+                                   safe_path_to_string(actions[index].from),
+                                   e.what()));
+      }
+    }
+  };
+
+  auto worker = [&] {
+    std::unique_lock lock(schedule_mutex);
+    for (;;) {
+      auto next = pending.end();
+      schedule_cv.wait(lock, stoken, [&] {
+        if (pending.empty()) return true;
+        next = std::find_if(pending.begin(), pending.end(), [&](size_t g) {
+          const auto dev = groups[g].dev;
+          return device_active[dev] < device_limits[dev];
+        });
+        return next != pending.end();
+      });
+      if (pending.empty() || stoken.stop_requested()) return;
+
+      const size_t g = *next;
+      pending.erase(next);
+      unsigned& active = device_active[groups[g].dev];
+      active++;
+
+      // Gives the device slot back even if the group throws, so that the
+      // workers waiting for it are not left waiting forever.
+      struct SlotGuard {
+        std::unique_lock<std::mutex>& lock;
+        unsigned& active;
+        std::condition_variable_any& cv;
+        ~SlotGuard() {
+          if (!lock.owns_lock()) lock.lock();
+          active--;
+          cv.notify_all();
+        }
+      } guard{lock, active, schedule_cv};
+
+      lock.unlock();
+      process_group(groups[g]);
+      lock.lock();
+    }
+  };
+
+  const size_t worker_count =
+      std::min<size_t>(std::max(1u, m_options.max_workers), pending.size());
+  WorkerPool::shared().run_parallel(PoolLane::Io,
+                                    static_cast<unsigned>(worker_count),
+                                    [&](unsigned) { worker(); });
+
+  if (stoken.stop_requested()) {
+    IOManager::log("Execution cancelled by user.");
+  }
+
+  std::vector<JournalEntry> performed;
+  performed.reserve(actions.size());
+  for (auto& entry : results) {
+    if (entry) performed.push_back(std::move(*entry));
+  }
+  return performed;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "Journal.hpp"
+#include "types.hpp"
+
+struct MoveExecutorOptions {
+  // Upper bound on the shared pool's I/O lane workers used by one run.
+  unsigned max_workers = std::max(1u, std::thread::hardware_concurrency());
+  // Concurrent destination directories per device. Rotational disks are
+  // limited further so that parallel renames do not turn into seek storms.
+  unsigned per_device_limit = 4;
+  unsigned rotational_device_limit = 1;
+};
+
+// Applies a plan of moves in parallel. Actions are grouped by destination
+// directory; each directory is created once and its moves are renamed
+// relative to open directory handles by a single worker, so that naming
+// within one directory stays sequential. Free names come from an index of the
+// directory built once per run, and renames never replace an existing file.
+// Directories on the same device are processed concurrently only up to that
+// device's limit. Moves from another filesystem are copied, then removed at
+// the source (see CrossDevice.hpp).
+class MoveExecutor {
+ public:
+  explicit MoveExecutor(MoveExecutorOptions options = {});
+
+  // Returns the journal of completed moves, in the order of `actions`. If
+  // `journal` is given, each move is also appended to it as soon as it lands.
+  std::vector<JournalEntry> execute(const std::vector<Action>& actions,
+                                    std::stop_token stoken = {},
+                                    Journal::Writer* journal = nullptr) const;
+
+ private:
+  unsigned limit_for_device(std::uint64_t dev) const;
+
+  MoveExecutorOptions m_options;
+};
@@ -0,0 +1,35 @@
+#include "NameIndex.hpp"
+
+#include <format>
+
+#include "utils.hpp"
+
+DirectoryNameIndex::DirectoryNameIndex(const fs::path& directory) {
+  std::error_code ec;
+  for (fs::directory_iterator it(directory, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    m_names.insert(safe_path_to_string(it->path().filename()));
+  }
+}
+
+std::string DirectoryNameIndex::claim(const std::string& filename) {
+  if (m_names.insert(filename).second) return filename;
+
+  // "name (n).ext", splitting like fs::path::stem() and extension().
+  const fs::path as_path = path_from_utf8(filename);
+  const std::string stem = safe_path_to_string(as_path.stem());
+  const std::string ext = safe_path_to_string(as_path.extension());
+
+  int& suffix = m_next_suffix.try_emplace(filename, 1).first->second;
+  for (;; ++suffix) {
+    std::string candidate = std::format("{} ({}){}", stem, suffix, ext);
+    if (m_names.insert(candidate).second) {
+      ++suffix;
+      return candidate;
+    }
+  }
+}
+
+void DirectoryNameIndex::release(const std::string& filename) {
+  m_names.erase(filename);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "types.hpp"
+
+// The set of names in one destination directory, listed once and then kept
+// up to date as names are handed out. Replaces probing the filesystem for
+// each "name (N).ext" candidate. Not thread-safe; each destination directory
+// is owned by a single worker.
+class DirectoryNameIndex {
+ public:
+  explicit DirectoryNameIndex(const fs::path& directory);
+
+  // Returns `filename` if it is free, otherwise the first free
+  // "stem (N).ext", and marks the returned name as taken.
+  std::string claim(const std::string& filename);
+  // Marks a name as free again, e.g. after a move into it failed.
+  void release(const std::string& filename);
+
+  bool contains(const std::string& filename) const {
+    return m_names.contains(filename);
+  }
+
+ private:
+  std::unordered_set<std::string> m_names;
+  // Next suffix to try, per original filename.
+  std::unordered_map<std::string, int> m_next_suffix;
+};
@@ -0,0 +1,161 @@
+#include "NameMatcher.hpp"
+
+#include <deque>
+
+namespace {
+constexpr std::uint32_t kNoState = static_cast<std::uint32_t>(-1);
+
+unsigned char fold(char c) {
+  return static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+bool is_glob(std::string_view pattern) {
+  return pattern.find_first_of("*?") != std::string_view::npos;
+}
+
+// Matches a whole name against a glob, ignoring ASCII case. On a mismatch
+// only the most recent '*' is retried, which is sufficient for globs and
+// keeps the match linear in practice.
+bool glob_match_nocase(std::string_view pattern, std::string_view text) {
+  size_t p = 0;
+  size_t t = 0;
+  size_t star = std::string_view::npos;
+  size_t resume = 0;
+  while (t < text.size()) {
+    if (p < pattern.size() &&
+        (pattern[p] == '?' || fold(pattern[p]) == fold(text[t]))) {
+      ++p;
+      ++t;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      resume = t;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      t = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') ++p;
+  return p == pattern.size();
+}
+
+// The longest run of literal characters in a glob, lowercased.
+std::string longest_fragment(std::string_view pattern) {
+  std::string_view best;
+  size_t start = 0;
+  for (size_t i = 0; i <= pattern.size(); ++i) {
+    if (i == pattern.size() || pattern[i] == '*' || pattern[i] == '?') {
+      if (i - start > best.size()) best = pattern.substr(start, i - start);
+      start = i + 1;
+    }
+  }
+  std::string fragment(best);
+  AsciiCase::lower(fragment, fragment.data());
+  return fragment;
+}
+}  // namespace
+
+void NameMatcher::add(NameTarget target, std::string_view pattern,
+                      bool case_sensitive, std::uint32_t condition) {
+  Table& table = m_tables[static_cast<size_t>(target)];
+  if (case_sensitive) {
+    table.exact[std::string(pattern)].push_back(condition);
+  } else if (!is_glob(pattern)) {
+    table.nocase[std::string(pattern)].push_back(condition);
+  } else {
+    const auto index = static_cast<std::uint32_t>(table.globs.size());
+    table.globs.push_back({std::string(pattern), condition});
+    table.fragments.push_back(longest_fragment(pattern));
+    if (table.fragments.back().empty()) table.unanchored.push_back(index);
+  }
+}
+
+void NameMatcher::build() {
+  for (Table& table : m_tables) build_automaton(table);
+}
+
+void NameMatcher::build_automaton(Table& table) {
+  Automaton& automaton = table.automaton;
+  automaton.next.assign(256, kNoState);
+  automaton.outputs.assign(1, {});
+
+  for (std::uint32_t g = 0; g < table.globs.size(); ++g) {
+    if (table.fragments[g].empty()) continue;
+    std::uint32_t state = 0;
+    for (char c : table.fragments[g]) {
+      const size_t slot = state * 256 + fold(c);
+      if (automaton.next[slot] == kNoState) {
+        automaton.next[slot] =
+            static_cast<std::uint32_t>(automaton.outputs.size());
+        automaton.outputs.emplace_back();
+        automaton.next.resize(automaton.next.size() + 256, kNoState);
+      }
+      state = automaton.next[slot];
+    }
+    automaton.outputs[state].push_back(g);
+  }
+
+  // Breadth-first, each missing transition is taken from the failure state,
+  // whose row is already complete, and each state inherits its failure
+  // state's outputs.
+  std::vector<std::uint32_t> failure(automaton.outputs.size(), 0);
+  std::deque<std::uint32_t> queue;
+  for (unsigned c = 0; c < 256; ++c) {
+    std::uint32_t& slot = automaton.next[c];
+    if (slot == kNoState) {
+      slot = 0;
+    } else {
+      queue.push_back(slot);
+    }
+  }
+  while (!queue.empty()) {
+    const std::uint32_t state = queue.front();
+    queue.pop_front();
+    const std::uint32_t fail = failure[state];
+    const auto& inherited = automaton.outputs[fail];
+    automaton.outputs[state].insert(automaton.outputs[state].end(),
+                                    inherited.begin(), inherited.end());
+    for (unsigned c = 0; c < 256; ++c) {
+      std::uint32_t& slot = automaton.next[state * 256 + c];
+      const std::uint32_t fallback = automaton.next[fail * 256 + c];
+      if (slot == kNoState) {
+        slot = fallback;
+      } else {
+        failure[slot] = fallback;
+        queue.push_back(slot);
+      }
+    }
+  }
+}
+
+void NameMatcher::match(NameTarget target, std::string_view name,
+                        ConditionBits& matched) const {
+  const Table& table = m_tables[static_cast<size_t>(target)];
+  if (!table.exact.empty()) {
+    if (auto it = table.exact.find(name); it != table.exact.end()) {
+      for (std::uint32_t id : it->second) matched.set(id);
+    }
+  }
+  if (!table.nocase.empty()) {
+    if (auto it = table.nocase.find(name); it != table.nocase.end()) {
+      for (std::uint32_t id : it->second) matched.set(id);
+    }
+  }
+  if (table.globs.empty()) return;
+
+  auto check = [&](std::uint32_t g) {
+    const Glob& glob = table.globs[g];
+    if (!matched.test(glob.condition) &&
+        glob_match_nocase(glob.pattern, name)) {
+      matched.set(glob.condition);
+    }
+  };
+  for (std::uint32_t g : table.unanchored) check(g);
+  const Automaton& automaton = table.automaton;
+  std::uint32_t state = 0;
+  for (char c : name) {
+    state = automaton.next[state * 256 + fold(c)];
+    for (std::uint32_t g : automaton.outputs[state]) check(g);
+  }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "AsciiCase.hpp"
+
+// A fixed-size set of condition ids.
+class ConditionBits {
+ public:
+  void resize(size_t count) { m_words.assign((count + 63) / 64, 0); }
+  void set(std::uint32_t id) {
+    m_words[id / 64] |= std::uint64_t{1} << (id % 64);
+  }
+  bool test(std::uint32_t id) const {
+    return (m_words[id / 64] >> (id % 64)) & 1;
+  }
+
+ private:
+  std::vector<std::uint64_t> m_words;
+};
+
+enum class NameTarget : std::uint8_t { File, Subdirectory };
+
+// Matches a name against every pattern of every rule at once. Each pattern
+// is registered with the id of the condition it belongs to; matching a name
+// sets the ids of all patterns it satisfies. Literal patterns are looked up
+// in hash tables. Globs ('*' and '?', case-insensitive) are found through an
+// Aho-Corasick automaton over their longest literal fragment and verified
+// only when that fragment occurs in the name, so the cost per name does not
+// grow with the number of patterns.
+class NameMatcher {
+ public:
+  // Case-sensitive patterns are always literal.
+  void add(NameTarget target, std::string_view pattern, bool case_sensitive,
+           std::uint32_t condition);
+  // Must be called after the last add() and before match().
+  void build();
+
+  void match(NameTarget target, std::string_view name,
+             ConditionBits& matched) const;
+
+ private:
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const {
+      return std::hash<std::string_view>{}(text);
+    }
+  };
+
+  struct Glob {
+    std::string pattern;
+    std::uint32_t condition;
+  };
+
+  // An Aho-Corasick automaton over lowercased bytes, with the goto function
+  // expanded into a full transition table.
+  struct Automaton {
+    std::vector<std::uint32_t> next;  // 256 entries per state.
+    std::vector<std::vector<std::uint32_t>> outputs;  // Glob indices.
+  };
+
+  struct Table {
+    std::unordered_map<std::string, std::vector<std::uint32_t>, StringHash,
+                       std::equal_to<>>
+        exact;
+    AsciiCase::Map<std::vector<std::uint32_t>> nocase;
+    std::vector<Glob> globs;
+    // Globs without a literal fragment; checked against every name.
+    std::vector<std::uint32_t> unanchored;
+    std::vector<std::string> fragments;  // Parallel to globs.
+    Automaton automaton;
+  };
+
+  static void build_automaton(Table& table);
+
+  Table m_tables[2];
+};
@@ -0,0 +1,102 @@
+#include "PlanListView.hpp"
+
+#include <algorithm>
+#include <format>
+
+#include "utils.hpp"
+
+using namespace ftxui;
+
+namespace {
+// Rows rendered beyond the measured height, so that a resize shows no gap
+// before the next frame measures the box again.
+constexpr size_t kRowMargin = 4;
+}  // namespace
+
+PlanListView::PlanListView(const std::vector<Action>& plan,
+                           SelectionSet& selections)
+    : m_plan(plan), m_selections(selections) {}
+
+void PlanListView::reset() {
+  m_selected = 0;
+  m_first_visible = 0;
+}
+
+size_t PlanListView::visible_rows() const {
+  const int height = m_box.y_max - m_box.y_min + 1;
+  return height > 1 ? static_cast<size_t>(height) : 1;
+}
+
+std::string PlanListView::format_row(size_t index) const {
+  const Action& action = m_plan[index];
+  const char* mark = m_selections.test(index) ? "[X]" : "[ ]";
+  const std::string name = safe_path_to_string(action.from.filename());
+  switch (action.type) {
+    case ActionType::REMOVE:
+      return std::format("{} Delete '{}', same as '{}'", mark, name,
+                         safe_path_to_string(action.to));
+    case ActionType::HARDLINK:
+      return std::format("{} Hard-link '{}' to '{}'", mark, name,
+                         safe_path_to_string(action.to));
+    case ActionType::REFLINK:
+      return std::format("{} Clone '{}' from '{}'", mark, name,
+                         safe_path_to_string(action.to));
+    case ActionType::MOVE:
+      break;
+  }
+  return std::format("{} Move '{}' to '{}'", mark, name,
+                     safe_path_to_string(action.to.parent_path()));
+}
+
+Element PlanListView::render() {
+  const size_t rows = visible_rows();
+  m_selected = std::min(m_selected, m_plan.empty() ? 0 : m_plan.size() - 1);
+  if (m_selected < m_first_visible) {
+    m_first_visible = m_selected;
+  } else if (m_selected >= m_first_visible + rows) {
+    m_first_visible = m_selected - rows + 1;
+  }
+
+  const size_t end =
+      std::min(m_plan.size(), m_first_visible + rows + kRowMargin);
+  Elements elements;
+  elements.reserve(end - m_first_visible);
+  for (size_t i = m_first_visible; i < end; ++i) {
+    Element entry = text(format_row(i));
+    if (i == m_selected) entry = entry | inverted;
+    elements.push_back(std::move(entry));
+  }
+
+  const auto position =
+      std::format(" {}/{} ({} selected) ", m_selected + 1, m_plan.size(),
+                  m_selections.count());
+  return vbox({vbox(std::move(elements)) | yframe | flex | reflect(m_box),
+               hbox({filler(), text(position) | dim})});
+}
+
+bool PlanListView::on_event(const Event& event) {
+  if (m_plan.empty()) return false;
+  const size_t last = m_plan.size() - 1;
+  const size_t page = visible_rows();
+
+  if (event == Event::ArrowUp) {
+    if (m_selected == 0) return false;
+    m_selected--;
+  } else if (event == Event::ArrowDown) {
+    if (m_selected == last) return false;
+    m_selected++;
+  } else if (event == Event::PageUp) {
+    m_selected -= std::min(m_selected, page);
+  } else if (event == Event::PageDown) {
+    m_selected = std::min(last, m_selected + page);
+  } else if (event == Event::Home) {
+    m_selected = 0;
+  } else if (event == Event::End) {
+    m_selected = last;
+  } else if (event == Event::Character(' ')) {
+    m_selections.flip(m_selected);
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ftxui/component/component.hpp>
+#include <ftxui/dom/elements.hpp>
+#include <string>
+#include <vector>
+
+#include "SelectionSet.hpp"
+#include "types.hpp"
+
+// A scrolling list of plan entries that only builds elements for the rows
+// that fit in its box (as measured on the previous frame), plus a small
+// margin. Row text is formatted on demand from the plan itself, so the cost
+// of a frame does not depend on the size of the plan.
+class PlanListView {
+ public:
+  PlanListView(const std::vector<Action>& plan, SelectionSet& selections);
+
+  ftxui::Element render();
+  // Handles navigation and Space; returns whether the event was used.
+  bool on_event(const ftxui::Event& event);
+  // Moves the cursor back to the top, e.g. after a new scan.
+  void reset();
+  size_t cursor() const { return m_selected; }
+  void set_cursor(size_t index) { m_selected = index; }
+
+ private:
+  std::string format_row(size_t index) const;
+  size_t visible_rows() const;
+
+  const std::vector<Action>& m_plan;
+  SelectionSet& m_selections;
+  size_t m_selected = 0;
+  size_t m_first_visible = 0;
+  ftxui::Box m_box;
+};
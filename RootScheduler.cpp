@@ -0,0 +1,75 @@
+#include "RootScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+
+#include "StreamHash.hpp"
+#include "WorkerPool.hpp"
+#include "utils.hpp"
+
+RootScheduler::RootScheduler(unsigned concurrent)
+    : m_concurrent(std::max(1u, concurrent)) {}
+
+RootShare RootScheduler::share(size_t roots) const {
+  const WorkerPool& pool = WorkerPool::shared();
+  const unsigned turns =
+      static_cast<unsigned>(std::clamp<size_t>(roots, 1, m_concurrent));
+  return {std::max(1u, pool.workers(PoolLane::Io) / turns),
+          std::max(1u, pool.workers(PoolLane::Cpu) / turns)};
+}
+
+std::vector<RootReport> RootScheduler::run(size_t roots, const Job& job,
+                                           std::stop_token stoken) const {
+  using Clock = std::chrono::steady_clock;
+  std::vector<RootReport> reports(roots);
+  if (roots == 0) return reports;
+
+  const RootShare root_share = share(roots);
+  const Clock::time_point start = Clock::now();
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d);
+  };
+  // Each turn is a slot that takes the next root when its current one is
+  // done. The slots drive their roots' scans themselves, so they run on the
+  // I/O lane.
+  std::atomic<size_t> next = 0;
+  WorkerPool::shared().run_parallel(
+      PoolLane::Io,
+      static_cast<unsigned>(std::min<size_t>(roots, m_concurrent)),
+      [&](unsigned) {
+        for (size_t i; !stoken.stop_requested() &&
+                       (i = next.fetch_add(1)) < roots;) {
+          const Clock::time_point began = Clock::now();
+          RootReport report = job(i, root_share);
+          report.ran = true;
+          report.waited = ms(began - start);
+          report.elapsed = ms(Clock::now() - began);
+          reports[i] = report;
+        }
+      });
+  return reports;
+}
+
+std::string root_key(const std::filesystem::path& target) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  fs::path path = fs::weakly_canonical(fs::absolute(target), ec);
+  if (ec) path = fs::absolute(target).lexically_normal();
+  if (!path.has_filename() && path.has_relative_path()) {
+    path = path.parent_path();
+  }
+  const std::string text = safe_path_to_string(path);
+  return std::format(
+      "{:016x}",
+      StreamHash64::hash({reinterpret_cast<const unsigned char*>(text.data()),
+                          text.size()}));
+}
+
+std::filesystem::path root_file(const std::filesystem::path& name,
+                                const std::filesystem::path& target) {
+  std::filesystem::path file = name;
+  file.replace_extension(std::format(".{}{}", root_key(target),
+                                     safe_path_to_string(name.extension())));
+  return file;
+}
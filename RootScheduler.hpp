@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+// The workers of the shared pool a root may use while it runs, to be passed
+// on as the max_workers of its scan, moves or undo.
+struct RootShare {
+  unsigned io_workers = 1;
+  unsigned cpu_workers = 1;
+};
+
+// What a root's job did. The counts come from the job, the times from the
+// scheduler.
+struct RootReport {
+  bool ran = false;
+  size_t planned = 0;
+  size_t performed = 0;
+  size_t failed = 0;
+  // From the start of the run until the root got its turn, and its job's
+  // duration.
+  std::chrono::milliseconds waited{0};
+  std::chrono::milliseconds elapsed{0};
+};
+
+// Runs one job per root of a multi-root run on the shared pool. At most
+// `concurrent` roots run at once, taken in list order as earlier ones
+// finish, and each gets an equal share of both pool lanes. A root with a
+// huge tree thus holds one turn and its share for as long as it takes, while
+// the other roots pass it in the remaining turns.
+class RootScheduler {
+ public:
+  using Job = std::function<RootReport(size_t root, const RootShare& share)>;
+
+  explicit RootScheduler(unsigned concurrent);
+
+  // Returns a report per root, in root order. Once `stoken` is triggered no
+  // further roots are started; the others are reported as not run.
+  std::vector<RootReport> run(size_t roots, const Job& job,
+                              std::stop_token stoken = {}) const;
+
+  RootShare share(size_t roots) const;
+
+ private:
+  unsigned m_concurrent;
+};
+
+// Keeps a root's journal and state files apart from the other roots': a hash
+// of its canonical path, so that every spelling of one folder ("b", "b/",
+// a symlink to it) gets the same key.
+std::string root_key(const std::filesystem::path& target);
+// The root's own version of a state file: "organizer_journal.json" becomes
+// "organizer_journal.<key>.json".
+std::filesystem::path root_file(const std::filesystem::path& name,
+                                const std::filesystem::path& target);
@@ -1,86 +1,466 @@
 #include "RuleEngine.hpp"
 
+#include <algorithm>
 #include <atomic>
-#include <execution>
+#include <iterator>
 #include <exiv2/exiv2.hpp>
 #include <mutex>
 #include <stdexcept>
 
+#include "BoundedQueue.hpp"
+#include "ContentSniffer.hpp"
+#include "Deduplicator.hpp"
+#include "ExifCache.hpp"
+#include "ExifReader.hpp"
 #include "IOManager.hpp"
+#include "ScanIndex.hpp"
+#include "WorkerPool.hpp"
 #include "utils.hpp"
 
 namespace {
 std::mutex g_exiv2_mutex;
 }
 
-RuleEngine::RuleEngine(const Config& config) : m_config(config) {}
+RuleEngine::RuleEngine(const Config& config, RuleEngineOptions options)
+    : m_program(RuleProgram::compile(config)),
+      m_scan_index_path(std::move(options.scan_index_path)),
+      m_walk_options(std::move(options.walk)),
+      m_dedupe_options(options.dedupe),
+      m_max_cpu_workers(options.max_cpu_workers) {
+  if (options.exif_cache_path && m_program.has_exif_rules()) {
+    m_exif_cache = ExifCache::open(*options.exif_cache_path);
+  }
+}
+
+RuleEngine::~RuleEngine() = default;
+
+struct RuleEngine::IndexContext {
+  const ScanIndex* previous = nullptr;
+  std::atomic<size_t> reused = 0;
+};
+
+struct RuleEngine::IndexHit {
+  // Set only when the entry is recorded in the current index.
+  std::optional<FileIdentity> identity;
+  // The entry's record in the previous index, if it is unchanged.
+  const ScanIndexEntry* cached = nullptr;
+};
+
+namespace {
+void log_analysis_result(size_t actions, bool cancelled) {
+  if (cancelled) {
+    IOManager::log(std::format(
+        "Analysis cancelled. {} actions found before stop.", actions));
+  } else {
+    IOManager::log(
+        std::format("Analysis complete. Found {} actions.", actions));
+  }
+}
+
+// Listed entries of one depth, passed from one scan stage to the next.
+struct ScanBatch {
+  std::vector<WalkEntry> entries;
+  unsigned depth = 0;
+};
+
+// Batches waiting between two stages. Bounds the memory of a walk that runs
+// ahead of classification.
+constexpr size_t kQueuedBatches = 64;
+
+// What a stage produced for one batch.
+struct PlanChunk {
+  std::vector<Action> actions;
+  std::vector<ScanIndexEntry> records;
+  PlanChunk* next = nullptr;
+};
+
+// A lock-free stack of chunks, so that no stage waits for another to store
+// its results.
+class PlanChunks {
+ public:
+  ~PlanChunks() { take(); }
+
+  void push(std::unique_ptr<PlanChunk> chunk) {
+    PlanChunk* node = chunk.release();
+    node->next = m_head.load(std::memory_order_relaxed);
+    while (!m_head.compare_exchange_weak(node->next, node,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+    }
+  }
+
+  std::vector<std::unique_ptr<PlanChunk>> take() {
+    std::vector<std::unique_ptr<PlanChunk>> chunks;
+    PlanChunk* node = m_head.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+      chunks.emplace_back(node);
+      node = node->next;
+    }
+    return chunks;
+  }
+
+ private:
+  std::atomic<PlanChunk*> m_head = nullptr;
+};
+
+// Queues `batch` for the next stage. While the queue is full, the caller
+// runs that stage on the oldest batch itself rather than wait for a worker
+// that may not be running.
+template <typename Stage>
+void hand_on(BoundedQueue<ScanBatch>& queue, ScanBatch batch,
+             const Stage& stage) {
+  while (!queue.try_push(batch)) {
+    if (auto oldest = queue.try_pop()) stage(std::move(*oldest));
+  }
+}
+
+// Ends the input of a stage and runs it on what is left, in case none of
+// its workers got to start.
+template <typename Stage>
+void finish_stage(BoundedQueue<ScanBatch>& queue, const Stage& stage) {
+  queue.close();
+  while (auto batch = queue.try_pop()) stage(std::move(*batch));
+}
+
+// Closes the stage queues when a scan unwinds, so that its waiting workers
+// return and can be joined.
+struct CloseOnExit {
+  BoundedQueue<ScanBatch>& first;
+  BoundedQueue<ScanBatch>& second;
+  ~CloseOnExit() {
+    first.close();
+    second.close();
+  }
+};
+}  // namespace
 
 std::vector<Action> RuleEngine::generate_plan(
-    const fs::path& targetDir, std::optional<std::stop_token> stoken) const {
-  IOManager::log("Scanning directory for items to process...");
+    const fs::path& targetDir, std::optional<std::stop_token> stop,
+    const PlanSink& on_batch, ScanProgress* progress) const {
+  const bool deep = m_walk_options.max_depth > 0;
+  IOManager::log(deep ? "Deep-scanning directory tree for items to process..."
+                      : "Scanning directory for items to process...");
+  const std::stop_token stoken = stop.value_or(std::stop_token{});
 
-  std::vector<fs::path> paths_to_scan;
-  try {
-    for (const auto& entry : fs::directory_iterator(
-             targetDir, fs::directory_options::skip_permission_denied)) {
-      paths_to_scan.push_back(entry.path());
+  // The scan index holds top-level entries only.
+  std::optional<ScanIndex> previous_index;
+  std::optional<ScanIndex> current_index;
+  IndexContext index;
+  if (m_scan_index_path) {
+    previous_index = ScanIndex::load(*m_scan_index_path, targetDir,
+                                     m_program.fingerprint());
+    current_index.emplace(targetDir, m_program.fingerprint());
+    index.previous = &*previous_index;
+  }
+
+  PlanChunks chunks;
+  auto emit = [&](std::vector<Action> actions,
+                  std::vector<ScanIndexEntry> records) {
+    if (actions.empty() && records.empty()) return;
+    if (on_batch && !actions.empty()) on_batch(actions);
+    chunks.push(std::make_unique<PlanChunk>(
+        PlanChunk{std::move(actions), std::move(records), nullptr}));
+  };
+
+  auto count = [progress](std::atomic<size_t> ScanProgress::*counter,
+                          size_t n) {
+    if (progress) (progress->*counter) += n;
+  };
+
+  BoundedQueue<ScanBatch> to_classify(kQueuedBatches);
+  BoundedQueue<ScanBatch> to_inspect(kQueuedBatches);
+
+  // Third stage, on I/O workers: entries whose classification reads the
+  // disk, such as images with EXIF rules, files of unknown type and folders.
+  auto inspect = [&](ScanBatch batch) {
+    if (stoken.stop_requested()) return;
+    IndexContext* top_level = batch.depth == 0 ? &index : nullptr;
+    // The index is consulted first, so that unchanged files are not read
+    // again just to be sniffed.
+    std::vector<IndexHit> hits;
+    hits.reserve(batch.entries.size());
+    std::vector<WalkEntry*> unknown;
+    for (auto& entry : batch.entries) {
+      hits.push_back(look_up(entry, top_level));
+      if (!hits.back().cached) unknown.push_back(&entry);
     }
-  } catch (const fs::filesystem_error& e) {
-    IOManager::log(std::format(
-        "Error during initial directory scan of '{}': {}. Aborting.",
-        safe_path_to_string(targetDir), e.what()));
+    if (m_program.sniff_content()) sniff_batch(unknown);
+    std::vector<Action> actions;
+    std::vector<ScanIndexEntry> records;
+    for (size_t i = 0; i < batch.entries.size(); ++i) {
+      if (stoken.stop_requested()) break;
+      if (auto action = plan_entry(batch.entries[i], targetDir, hits[i],
+                                   current_index ? &records : nullptr)) {
+        actions.push_back(std::move(*action));
+      }
+    }
+    count(&ScanProgress::classified, batch.entries.size());
+    emit(std::move(actions), std::move(records));
+  };
+
+  // Second stage, on CPU workers: plans what the listed type and extension
+  // decide, and hands the rest on.
+  auto classify = [&](ScanBatch batch) {
+    if (stoken.stop_requested()) return;
+    std::vector<Action> actions;
+    ScanBatch pending{{}, batch.depth};
+    for (auto& entry : batch.entries) {
+      if (auto category = quick_category(entry)) {
+        if (auto action = make_action(entry.path, targetDir, *category)) {
+          actions.push_back(std::move(*action));
+        }
+      } else {
+        pending.entries.push_back(std::move(entry));
+      }
+    }
+    count(&ScanProgress::classified,
+          batch.entries.size() - pending.entries.size());
+    emit(std::move(actions), {});
+    if (!pending.entries.empty()) {
+      hand_on(to_inspect, std::move(pending), inspect);
+    }
+  };
+
+  // First stage, the walk: listed batches go on to classification, except
+  // for the folders the walk may enter, which the visitor decides on.
+  auto prepare = [&](std::vector<WalkEntry>& batch, unsigned depth) {
+    count(&ScanProgress::listed, batch.size());
+    ScanBatch listed{{}, depth};
+    std::vector<WalkEntry> enterable;
+    for (auto& entry : batch) {
+      const bool can_descend = depth < m_walk_options.max_depth &&
+                               entry.type == EntryType::Directory;
+      (can_descend ? enterable : listed.entries).push_back(std::move(entry));
+    }
+    batch = std::move(enterable);
+    if (!listed.entries.empty()) {
+      hand_on(to_classify, std::move(listed), classify);
+    }
+  };
+
+  auto visit = [&](const WalkEntry& entry, unsigned depth, bool can_descend) {
+    if (!can_descend) return false;
+    count(&ScanProgress::classified, 1);
+    // A folder matching a folder rule still moves as a whole; any other
+    // folder is entered. Category folders hold earlier results.
+    const fs::path& p = entry.path;
+    if (depth == 0 &&
+        m_program.is_category_dir(safe_path_to_string(p.filename()))) {
+      return false;
+    }
+    auto classification = classify_path(entry);
+    if (!classification) return false;
+    if (classification->category.empty()) return true;
+    if (auto action = make_action(p, targetDir, classification->category)) {
+      std::vector<Action> actions;
+      actions.push_back(std::move(*action));
+      emit(std::move(actions), {});
+    }
+    return false;
+  };
+
+  WorkerPool& pool = WorkerPool::shared();
+  std::optional<TreeWalker::Stats> stats;
+  {
+    // Inspectors get at most half of the I/O lane; the walk needs the rest.
+    const unsigned inspectors_count =
+        std::max(1u, std::min(m_walk_options.max_workers,
+                              pool.workers(PoolLane::Io) / 2));
+    WorkerPool::Helpers inspectors(pool, PoolLane::Io, inspectors_count,
+                                   [&](unsigned) {
+                                     while (auto batch = to_inspect.pop()) {
+                                       inspect(std::move(*batch));
+                                     }
+                                   });
+    const unsigned classifiers_count =
+        m_max_cpu_workers ? std::min(m_max_cpu_workers,
+                                     pool.workers(PoolLane::Cpu))
+                          : pool.workers(PoolLane::Cpu);
+    WorkerPool::Helpers classifiers(pool, PoolLane::Cpu, classifiers_count,
+                                    [&](unsigned) {
+                                      while (auto batch = to_classify.pop()) {
+                                        classify(std::move(*batch));
+                                      }
+                                    });
+    CloseOnExit close_queues{to_classify, to_inspect};
+
+    stats = TreeWalker(m_walk_options).walk(targetDir, visit, stoken, prepare);
+    if (progress) progress->listing_done = true;
+    finish_stage(to_classify, classify);
+    classifiers.join();
+    finish_stage(to_inspect, inspect);
+    inspectors.join();
+  }
+  if (!stats) {
+    IOManager::log(LogLevel::Error,
+                   std::format("Initial directory scan of '{}' failed. "
+                               "Aborting.",
+                               safe_path_to_string(targetDir)));
     return {};
   }
 
+  std::vector<Action> result_plan;
+  for (auto& chunk : chunks.take()) {
+    std::ranges::move(chunk->actions, std::back_inserter(result_plan));
+    if (current_index) {
+      for (auto& record : chunk->records) {
+        current_index->record(std::move(record));
+      }
+    }
+  }
+  // Stages finish in any order.
+  std::ranges::sort(result_plan, {}, &Action::from);
+
+  const bool cancelled = stoken.stop_requested();
+  if (!cancelled) deduplicate(result_plan, stop);
   IOManager::log(
-      std::format("Found {} items. Analyzing...", paths_to_scan.size()));
+      std::format("Analyzed {} items in {} directories, {} excluded.",
+                  stats->entries, stats->directories, stats->excluded));
+  if (previous_index) {
+    IOManager::log(std::format("Reused {} entries from the scan index.",
+                               index.reused.load()));
+  }
+  log_analysis_result(result_plan.size(), cancelled);
 
-  std::vector<Action> result_plan;
-  std::mutex result_mutex;
+  if (current_index && !cancelled) {
+    current_index->save(*m_scan_index_path);
+  }
 
-  const size_t chunk_size = 128;
-  for (size_t i = 0; i < paths_to_scan.size(); i += chunk_size) {
-    if (stoken && stoken->stop_requested()) {
-      IOManager::log("Scan cancelled by user.");
-      break;
-    }
+  if (m_exif_cache) {
+    const auto exif_stats = m_exif_cache->stats();
+    IOManager::log(std::format(
+        "EXIF cache: {} hits, {} cached without date, {} misses, {} "
+        "evictions.",
+        exif_stats.hits, exif_stats.negative_hits, exif_stats.misses,
+        exif_stats.evictions));
+  }
 
-    auto first = paths_to_scan.begin() + i;
-    auto last =
-        paths_to_scan.begin() + std::min(i + chunk_size, paths_to_scan.size());
+  return result_plan;
+}
 
-    std::vector<Action> chunk_plan;
-    std::mutex chunk_mutex;
+std::vector<Action> RuleEngine::generate_plan_for_paths(
+    const std::vector<fs::path>& paths, const fs::path& targetDir,
+    std::optional<std::stop_token> stoken) const {
+  IOManager::log(std::format("Analyzing {} changed items...", paths.size()));
+  return plan_paths(paths, targetDir, stoken);
+}
 
-    std::for_each(std::execution::par, first, last, [&](const fs::path& p) {
-      if (auto action = generate_action_for_path(p, targetDir)) {
-        std::scoped_lock lock(chunk_mutex);
-        chunk_plan.push_back(*action);
+std::vector<Action> RuleEngine::plan_paths(
+    const std::vector<fs::path>& paths_to_scan, const fs::path& targetDir,
+    const std::optional<std::stop_token>& stoken) const {
+  // Each worker slot plans into its own vector.
+  WorkerPool& pool = WorkerPool::shared();
+  const unsigned width = pool.workers(PoolLane::Cpu) + 1;
+  std::vector<std::vector<Action>> planned(width);
+  std::atomic<size_t> next = 0;
+  pool.run_parallel(PoolLane::Cpu, width, [&](unsigned slot) {
+    for (size_t i; !(stoken && stoken->stop_requested()) &&
+                   (i = next.fetch_add(1)) < paths_to_scan.size();) {
+      const WalkEntry entry{paths_to_scan[i], EntryType::Unknown, {}};
+      if (auto action = plan_entry(entry, targetDir, {}, nullptr)) {
+        planned[slot].push_back(std::move(*action));
       }
-    });
-
-    if (!chunk_plan.empty()) {
-      std::scoped_lock lock(result_mutex);
-      result_plan.insert(result_plan.end(),
-                         std::make_move_iterator(chunk_plan.begin()),
-                         std::make_move_iterator(chunk_plan.end()));
     }
+  });
+
+  std::vector<Action> result_plan;
+  for (auto& actions : planned) {
+    std::ranges::move(actions, std::back_inserter(result_plan));
   }
+  std::ranges::sort(result_plan, {}, &Action::from);
 
-  if (stoken && stoken->stop_requested()) {
-    IOManager::log(
-        std::format("Analysis cancelled. {} actions found before stop.",
-                    result_plan.size()));
+  const bool cancelled = stoken && stoken->stop_requested();
+  if (cancelled) IOManager::log("Scan cancelled by user.");
+  if (!cancelled) deduplicate(result_plan, stoken);
+  log_analysis_result(result_plan.size(), cancelled);
+  return result_plan;
+}
+
+void RuleEngine::deduplicate(std::vector<Action>& plan,
+                             const std::optional<std::stop_token>& stoken)
+    const {
+  if (m_dedupe_options.policy == DedupePolicy::Off || plan.empty()) return;
+  IOManager::log("Checking planned files for duplicates...");
+  Deduplicator(m_dedupe_options)
+      .process(plan, stoken.value_or(std::stop_token{}));
+}
+
+RuleEngine::IndexHit RuleEngine::look_up(const WalkEntry& entry,
+                                         IndexContext* index) const {
+  IndexHit hit;
+  if (!index || !index->previous) return hit;
+  hit.identity = FileIdentity::of(entry.path);
+  if (hit.identity) {
+    hit.cached = index->previous->lookup(entry.path, *hit.identity);
+    if (hit.cached) index->reused++;
+  }
+  return hit;
+}
+
+std::optional<Action> RuleEngine::plan_entry(
+    const WalkEntry& entry, const fs::path& targetDir, const IndexHit& hit,
+    std::vector<ScanIndexEntry>* records) const {
+  const fs::path& p = entry.path;
+  std::optional<FileIdentity> identity = hit.identity;
+  std::optional<ScanIndexEntry> index_entry;
+  Category category;
+  if (hit.cached) index_entry = *hit.cached;
+
+  if (!index_entry) {
+    auto classification = classify_path(entry);
+    if (!classification) return std::nullopt;
+    category = classification->category;
+    index_entry = ScanIndexEntry{identity.value_or(FileIdentity{}),
+                                 safe_path_to_string(p.filename()),
+                                 category.name(),
+                                 std::move(classification->unwrapped_child),
+                                 {}};
+    if (identity && !index_entry->unwrapped_child.empty()) {
+      auto child = FileIdentity::of(p / index_entry->unwrapped_child);
+      if (child) {
+        index_entry->child_identity = *child;
+      } else {
+        identity.reset();  // Cannot be validated later; do not record.
+      }
+    }
   } else {
-    IOManager::log(std::format("Analysis complete. Found {} actions.",
-                               result_plan.size()));
+    category = Category::intern(index_entry->category);
   }
 
-  return result_plan;
+  auto action = make_action(p, targetDir, category);
+  if (identity && records) {
+    records->push_back(std::move(*index_entry));
+  }
+  return action;
 }
 
-std::optional<std::string> RuleEngine::get_exif_date(
-    const fs::path& path) const {
+std::optional<Category> RuleEngine::quick_category(
+    const WalkEntry& entry) const {
+  const std::string filename = safe_path_to_string(entry.path.filename());
+  if (entry.type == EntryType::Directory) {
+    if (m_program.is_category_dir(filename)) return Category{};
+    return std::nullopt;
+  }
+  if (entry.type != EntryType::Regular) return std::nullopt;
+  const std::string_view ext = extension_of(filename);
+  if (m_program.has_exif_rules() && m_program.is_image_extension(ext)) {
+    return std::nullopt;
+  }
+  if (auto id = m_program.category_for_extension(ext)) {
+    return m_program.category(*id);
+  }
+  if (m_program.sniff_content()) return std::nullopt;
+  return m_program.default_category();
+}
+
+namespace {
+std::optional<std::string> read_exif_date(const fs::path& path) {
+  // The native reader needs no lock; Exiv2 is only used for formats it cannot
+  // parse itself.
+  auto native = ExifReader::read_date_time_original(path);
+  if (native.status == ExifReader::Status::Found) return std::move(native.date);
+  if (native.status == ExifReader::Status::NotFound) return std::nullopt;
+
   std::scoped_lock lock(g_exiv2_mutex);
 
   try {
@@ -99,194 +479,151 @@ std::optional<std::string> RuleEngine::get_exif_date(
       }
     }
   } catch (const Exiv2::Error& e) {
-    IOManager::log(std::format("Non-critical Exiv2 error reading '{}': {}",
+    IOManager::log(LogLevel::Warning,
+                   std::format("Non-critical Exiv2 error reading '{}': {}",
                                safe_path_to_string(path), e.what()));
   } catch (const std::exception& e) {
     IOManager::log(
+        LogLevel::Warning,
         std::format("Non-critical standard exception reading '{}': {}",
                     safe_path_to_string(path), e.what()));
   }
   return std::nullopt;
 }
+}  // namespace
 
-std::optional<Action> RuleEngine::generate_action_for_path(
-    const fs::path& path, const fs::path& targetDir) const {
-  try {
-    const std::string defaultCategory = "Other";
-    std::string categoryName;
-    fs::path path_to_analyze = path;
+std::optional<std::string> RuleEngine::get_exif_date(
+    const fs::path& path) const {
+  std::optional<FileIdentity> identity;
+  if (m_exif_cache) {
+    identity = FileIdentity::of(path);
+    if (identity) {
+      std::string date;
+      switch (m_exif_cache->lookup(*identity, date)) {
+        case ExifCache::Lookup::HasDate:
+          return date;
+        case ExifCache::Lookup::NoDate:
+          return std::nullopt;
+        case ExifCache::Lookup::Miss:
+          break;
+      }
+    }
+  }
 
-    if (fs::is_regular_file(path)) {
-      std::string ext = safe_path_to_string(path.extension());
-      std::string ext_lower = string_to_lower_ascii(ext);
+  auto date = read_exif_date(path);
+  if (identity) m_exif_cache->store(*identity, date);
+  return date;
+}
 
-      static const std::vector<std::string> image_extensions = {
-          ".jpg", ".jpeg", ".png", ".webp", ".tiff",
-          ".raw", ".cr2",  ".nef", ".arw",  ".dng"};
+std::optional<Action> RuleEngine::make_action(const fs::path& path,
+                                              const fs::path& targetDir,
+                                              Category category) {
+  if (category.empty()) return std::nullopt;
+  fs::path destPath = targetDir / category.name() / path.filename();
+  if (destPath == path) return std::nullopt;
+  return Action{path, destPath, category, ActionType::MOVE};
+}
 
-      bool is_image = false;
-      for (const auto& img_ext : image_extensions) {
-        if (ext_lower == img_ext) {
-          is_image = true;
-          break;
-        }
-      }
+void RuleEngine::sniff_batch(std::span<WalkEntry* const> entries) const {
+  std::vector<fs::path> paths;
+  std::vector<WalkEntry*> targets;
+  for (WalkEntry* entry : entries) {
+    if (entry->type != EntryType::Regular) continue;
+    const std::string filename = safe_path_to_string(entry->path.filename());
+    if (m_program.category_for_extension(extension_of(filename))) continue;
+    paths.push_back(entry->path);
+    targets.push_back(entry);
+  }
+  if (paths.empty()) return;
+  const auto extensions = ContentSniffer::sniff_batch(paths);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    targets[i]->sniffed_extension = extensions[i];
+  }
+}
 
-      std::optional<std::string> exif_date;
-      if (is_image) {
-        exif_date = get_exif_date(path);
-      }
+std::optional<RuleEngine::Classification> RuleEngine::classify_path(
+    const WalkEntry& entry) const {
+  const fs::path& path = entry.path;
+  EntryType type = entry.type;
+  try {
+    Category category;
+    std::string unwrapped_child;
+    fs::path path_to_analyze = path;
 
-      if (exif_date) {
-        for (const auto& rule : m_config.rules) {
-          for (const auto& cond : rule.conditions) {
-            if (cond.type == "exif_date_matches") {
-              if (cond.values.empty()) continue;
-              bool match = true;
-              std::string_view pattern = cond.values[0];
-              if (pattern.length() == 10 && exif_date->length() == 10) {
-                for (int i = 0; i < 10; ++i) {
-                  if (pattern[i] != '*' && pattern[i] != (*exif_date)[i]) {
-                    match = false;
-                    break;
-                  }
-                }
-              } else {
-                match = false;
-              }
-
-              if (match) {
-                categoryName = rule.category;
-                std::string year = exif_date->substr(0, 4);
-                size_t pos = categoryName.find("{exif_year}");
-                if (pos != std::string::npos)
-                  categoryName.replace(pos, 11, year);
-                break;
-              }
-            }
+    if (type == EntryType::Unknown || type == EntryType::Symlink) {
+      type = entry_type_of(path);
+    }
+
+    if (type == EntryType::Regular) {
+      const std::string filename = safe_path_to_string(path.filename());
+      const std::string_view ext = extension_of(filename);
+
+      if (m_program.has_exif_rules() && m_program.is_image_extension(ext)) {
+        if (auto exif_date = get_exif_date(path)) {
+          if (auto exif_category = m_program.match_exif(*exif_date)) {
+            category = *exif_category;
           }
-          if (!categoryName.empty()) break;
         }
       }
 
-      if (categoryName.empty()) {
-        if (auto it = m_config.categories.find(ext_lower);
-            it != m_config.categories.end()) {
-          categoryName = it->second;
-        } else {
-          categoryName = defaultCategory;
-        }
-      }
-    } else if (fs::is_directory(path)) {
-      bool isCategoryDir = false;
-      for (const auto& pair : m_config.categories) {
-        if (path.filename() == pair.second) {
-          isCategoryDir = true;
-          break;
-        }
-      }
-      if (isCategoryDir || path.filename() == defaultCategory)
-        return std::nullopt;
-      fs::directory_iterator it_check(path_to_analyze);
-      if (it_check != fs::directory_iterator{}) {
-        const auto& first_entry = *it_check;
-        ++it_check;
-        if (it_check == fs::directory_iterator{} &&
-            first_entry.is_directory()) {
-          path_to_analyze = first_entry.path();
+      if (category.empty()) {
+        auto id = m_program.category_for_extension(ext);
+        if (!id && m_program.sniff_content()) {
+          const std::string_view sniffed =
+              entry.sniffed_extension ? *entry.sniffed_extension
+                                      : ContentSniffer::sniff(path);
+          if (!sniffed.empty()) {
+            id = m_program.category_for_extension(sniffed);
+          }
         }
+        category = id ? m_program.category(*id) : m_program.default_category();
       }
-      std::vector<std::string> filenames, subdir_names;
-      std::unordered_map<std::string, int> category_counts;
-      for (const auto& entry : fs::directory_iterator(path_to_analyze)) {
-        if (entry.is_directory())
-          subdir_names.push_back(safe_path_to_string(entry.path().filename()));
-        else if (entry.is_regular_file()) {
-          filenames.push_back(safe_path_to_string(entry.path().filename()));
-          const std::string ext = string_to_lower_ascii(
-              safe_path_to_string(entry.path().extension()));
-          if (auto it_cat = m_config.categories.find(ext);
-              it_cat != m_config.categories.end())
-            category_counts[it_cat->second]++;
+    } else if (type == EntryType::Directory) {
+      if (m_program.is_category_dir(safe_path_to_string(path.filename())))
+        return Classification{};
+      auto list = [](const fs::path& dir) {
+        std::error_code ec;
+        auto entries = read_directory(dir, ec);
+        if (ec) throw fs::filesystem_error("cannot list directory", dir, ec);
+        return entries;
+      };
+      auto resolved_type = [&](const DirEntry& entry) {
+        if (entry.type != EntryType::Unknown &&
+            entry.type != EntryType::Symlink) {
+          return entry.type;
         }
+        return entry_type_of(path_to_analyze / entry.name);
+      };
+
+      // One listing serves both the unwrap check and the features.
+      std::vector<DirEntry> entries = list(path);
+      if (entries.size() == 1 &&
+          resolved_type(entries.front()) == EntryType::Directory) {
+        path_to_analyze = path / entries.front().name;
+        unwrapped_child = entry_name_utf8(entries.front());
+        entries = list(path_to_analyze);
       }
-      for (const auto& rule : m_config.rules) {
-        bool all_conditions_met = true;
-        for (const auto& cond : rule.conditions) {
-          bool condition_met = false;
-          if (cond.type == "contains_filename_pattern") {
-            for (const auto& p : cond.values)
-              for (const auto& f : filenames)
-                if (string_to_lower_ascii(f) == string_to_lower_ascii(p)) {
-                  condition_met = true;
-                  break;
-                }
-          } else if (cond.type == "contains_filename") {
-            for (const auto& f_find : cond.values)
-              for (const auto& f : filenames)
-                if (f == f_find) {
-                  condition_met = true;
-                  break;
-                }
-          } else if (cond.type == "contains_subdirectory_named") {
-            for (const auto& s_find : cond.values)
-              for (const auto& s : subdir_names)
-                if (string_to_lower_ascii(s) == string_to_lower_ascii(s_find)) {
-                  condition_met = true;
-                  break;
-                }
-          } else if (cond.type == "has_no_subdirectories") {
-            condition_met = subdir_names.empty();
-          } else if (cond.type == "file_category_percentage") {
-            int total = 0;
-            int category_total = 0;
-            for (const auto& pair : category_counts) total += pair.second;
-            for (const auto& cat_name : cond.values)
-              if (category_counts.count(cat_name))
-                category_total += category_counts.at(cat_name);
-            if (total > 0 &&
-                (static_cast<double>(category_total) / total >= cond.threshold))
-              condition_met = true;
-          } else if (cond.type == "subfolder_matches_archive") {
-            for (const auto& subdir_name : subdir_names) {
-              std::string lower_subdir_name =
-                  string_to_lower_ascii(subdir_name);
-              for (const auto& filename : filenames) {
-                std::string lower_filename = string_to_lower_ascii(filename);
-                if (lower_filename == lower_subdir_name + ".zip" ||
-                    lower_filename == lower_subdir_name + ".rar" ||
-                    lower_filename == lower_subdir_name + ".7z") {
-                  condition_met = true;
-                  break;
-                }
-              }
-              if (condition_met) break;
-            }
-          }
-          if (!condition_met) {
-            all_conditions_met = false;
-            break;
-          }
-        }
-        if (all_conditions_met) {
-          categoryName = rule.category;
-          break;
+      DirectoryFeatures features = m_program.begin_directory();
+      for (const auto& entry : entries) {
+        const EntryType entry_type = resolved_type(entry);
+        if (entry_type == EntryType::Directory) {
+          m_program.add_subdirectory(entry_name_utf8(entry), features);
+        } else if (entry_type == EntryType::Regular) {
+          m_program.add_file(entry_name_utf8(entry), features);
         }
       }
+      category = m_program.match_directory(features);
     }
 
-    if (!categoryName.empty()) {
-      fs::path destPath = targetDir / categoryName / path.filename();
-      if (destPath != path) {
-        return Action{path, destPath, categoryName};
-      }
-    }
+    return Classification{category, std::move(unwrapped_child)};
   } catch (const fs::filesystem_error& e) {
     IOManager::log(
+        LogLevel::Warning,
         std::format("Warning: Filesystem error processing '{}': {}. Skipping.",
                     safe_path_to_string(e.path1()), e.what()));
   } catch (...) {
     IOManager::log(
+        LogLevel::Warning,
         std::format("Warning: A critical low-level error occurred while "
                     "processing '{}'. Skipping.",
                     safe_path_to_string(path)));
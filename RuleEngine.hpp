@@ -1,22 +1,129 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <span>
 #include <stop_token>
 #include <vector>
 
+#include "Deduplicator.hpp"
+#include "RuleProgram.hpp"
+#include "TreeWalker.hpp"
 #include "types.hpp"
 
+class ExifCache;
+class ScanIndex;
+struct ScanIndexEntry;
+
+struct RuleEngineOptions {
+  // Classifications are persisted here and reused for unchanged entries.
+  std::optional<fs::path> scan_index_path;
+  // EXIF capture dates are cached here, keyed by file identity.
+  std::optional<fs::path> exif_cache_path;
+  // How generate_plan walks the target. With a max_depth above 0, folders
+  // that match no folder rule are entered and their files planned one by one
+  // (a recursive deep scan).
+  TreeWalkOptions walk;
+  // Planned files that duplicate another file are resolved per this policy.
+  DedupeOptions dedupe;
+  // Upper bound on the shared pool's CPU lane workers classifying for one
+  // scan; 0 for the whole lane.
+  unsigned max_cpu_workers = 0;
+
+  // The on-disk state files used by the application, kept next to
+  // organizer_journal.json.
+  static RuleEngineOptions persistent() {
+    RuleEngineOptions options;
+    options.scan_index_path = "organizer_scan_index.bin";
+    options.exif_cache_path = "organizer_exif_cache.bin";
+    return options;
+  }
+};
+
+// Live counters of a running scan, updated by its workers and safe to read
+// from any thread.
+struct ScanProgress {
+  // Entries found by the walk so far.
+  std::atomic<size_t> listed = 0;
+  // Entries whose classification is done.
+  std::atomic<size_t> classified = 0;
+  // Set once the walk is over, so that `listed` is the total.
+  std::atomic<bool> listing_done = false;
+
+  void reset() {
+    listed = 0;
+    classified = 0;
+    listing_done = false;
+  }
+};
+
 class RuleEngine {
  public:
-  explicit RuleEngine(const Config& config);
+  explicit RuleEngine(const Config& config, RuleEngineOptions options = {});
+  ~RuleEngine();
 
+  // Receives planned moves in batches while a scan runs, concurrently from
+  // the scan's workers. The moves are streamed as found; the plan returned
+  // at the end is sorted and deduplicated.
+  using PlanSink = std::function<void(std::span<const Action> batch)>;
+
+  // Plans the entries of `targetDir`, or of its whole tree in a deep scan.
+  // Entries flow through bounded stages as the walk lists them: CPU workers
+  // plan what the listed type and extension decide, and I/O workers inspect
+  // the rest (EXIF dates, file contents, folder listings). The plan is
+  // sorted by source.
   std::vector<Action> generate_plan(
       const fs::path& targetDir,
+      std::optional<std::stop_token> stoken = std::nullopt,
+      const PlanSink& on_batch = {}, ScanProgress* progress = nullptr) const;
+
+  // Plans only the given top-level entries of `targetDir`, e.g. the ones
+  // reported by a filesystem watcher. The scan index is not consulted.
+  std::vector<Action> generate_plan_for_paths(
+      const std::vector<fs::path>& paths, const fs::path& targetDir,
       std::optional<std::stop_token> stoken = std::nullopt) const;
 
  private:
-  std::optional<Action> generate_action_for_path(
-      const fs::path& path, const fs::path& targetDir) const;
+  struct Classification {
+    Category category;  // Empty if the entry should be left in place.
+    std::string unwrapped_child;
+  };
+
+  struct IndexContext;
+  struct IndexHit;
+
+  std::vector<Action> plan_paths(
+      const std::vector<fs::path>& paths_to_scan, const fs::path& targetDir,
+      const std::optional<std::stop_token>& stoken) const;
+  // Looks a top-level entry up in the previous scan index, if `index` is
+  // given.
+  IndexHit look_up(const WalkEntry& entry, IndexContext* index) const;
+  // Plans one entry, reusing its classification from `hit` if the index
+  // knew it and appending what should be recorded for it to `records`.
+  std::optional<Action> plan_entry(const WalkEntry& entry,
+                                   const fs::path& targetDir,
+                                   const IndexHit& hit,
+                                   std::vector<ScanIndexEntry>* records) const;
+  // Classifies an entry by its listed type and extension alone. Returns
+  // std::nullopt if that takes its metadata or contents.
+  std::optional<Category> quick_category(const WalkEntry& entry) const;
+  // Uses the entry's listed type, resolving only Unknown and Symlink.
+  std::optional<Classification> classify_path(const WalkEntry& entry) const;
+  // Rewrites the moves of duplicate files per the dedupe policy.
+  void deduplicate(std::vector<Action>& plan,
+                   const std::optional<std::stop_token>& stoken) const;
+  // Sniffs the given files of a walk batch whose extension has no category.
+  void sniff_batch(std::span<WalkEntry* const> entries) const;
+  static std::optional<Action> make_action(const fs::path& path,
+                                           const fs::path& targetDir,
+                                           Category category);
   std::optional<std::string> get_exif_date(const fs::path& path) const;
 
-  const Config& m_config;
+  const RuleProgram m_program;
+  const std::optional<fs::path> m_scan_index_path;
+  const TreeWalkOptions m_walk_options;
+  const DedupeOptions m_dedupe_options;
+  const unsigned m_max_cpu_workers;
+  std::unique_ptr<ExifCache> m_exif_cache;
 };
\ No newline at end of file
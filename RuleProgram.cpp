@@ -0,0 +1,233 @@
+#include "RuleProgram.hpp"
+
+#include <array>
+#include <map>
+
+#include "DirectoryReader.hpp"
+#include "IOManager.hpp"
+#include "utils.hpp"
+
+namespace {
+const std::string kDefaultCategory = "Other";
+
+constexpr std::array<std::string_view, 10> kImageExtensions = {
+    ".jpg", ".jpeg", ".png", ".webp", ".tiff",
+    ".raw", ".cr2",  ".nef", ".arw",  ".dng"};
+
+constexpr std::array<std::string_view, 3> kArchiveExtensions = {".zip", ".rar",
+                                                                ".7z"};
+
+}  // namespace
+
+RuleOp rule_op_from_string(std::string_view type) {
+  if (type == "contains_filename_pattern")
+    return RuleOp::ContainsFilenamePattern;
+  if (type == "contains_filename") return RuleOp::ContainsFilename;
+  if (type == "contains_subdirectory_named")
+    return RuleOp::ContainsSubdirectoryNamed;
+  if (type == "has_no_subdirectories") return RuleOp::HasNoSubdirectories;
+  if (type == "file_category_percentage")
+    return RuleOp::FileCategoryPercentage;
+  if (type == "subfolder_matches_archive")
+    return RuleOp::SubfolderMatchesArchive;
+  if (type == "exif_date_matches") return RuleOp::ExifDateMatches;
+  return RuleOp::Unknown;
+}
+
+RuleProgram RuleProgram::compile(const Config& config) {
+  RuleProgram program;
+
+  json canonical;
+  canonical["categories"] = std::map<std::string, std::string>(
+      config.categories.begin(), config.categories.end());
+  canonical["rules"] = config.rules;
+  // Left out when off, so that existing scan indexes stay valid.
+  if (config.sniff_content) canonical["sniff_content"] = true;
+  program.m_fingerprint = fnv1a_64(canonical.dump());
+  program.m_sniff_content = config.sniff_content;
+
+  std::unordered_map<std::string, CategoryId> ids;
+  auto intern = [&](const std::string& name) {
+    auto [it, inserted] =
+        ids.try_emplace(name, static_cast<CategoryId>(ids.size()));
+    if (inserted) program.m_categories.push_back(Category::intern(name));
+    return it->second;
+  };
+
+  for (const auto& [ext, category] : config.categories) {
+    program.m_extension_to_category.insert(ext, intern(category));
+    program.m_category_dirs.insert(category);
+  }
+  program.m_extension_to_category.build();
+  program.m_category_dirs.insert(kDefaultCategory);
+  program.m_default_category = Category::intern(kDefaultCategory);
+
+  for (auto ext : kImageExtensions) program.m_image_extensions.emplace(ext);
+
+  for (const auto& rule : config.rules) {
+    CompiledRule compiled{Category::intern(rule.category), {}};
+    bool usable_for_directories = true;
+
+    for (const auto& cond : rule.conditions) {
+      const RuleOp op = rule_op_from_string(cond.type);
+
+      if (op == RuleOp::ExifDateMatches) {
+        // Only the first value is used as the pattern, and it must be a full
+        // "YYYY:MM:DD" mask to ever match.
+        if (!cond.values.empty() && cond.values[0].length() == 10) {
+          const size_t year_pos = rule.category.find("{exif_year}");
+          program.m_exif_rules.push_back(
+              {cond.values[0], rule.category, year_pos,
+               year_pos == std::string::npos ? Category::intern(rule.category)
+                                             : Category()});
+        }
+        usable_for_directories = false;
+        continue;
+      }
+      if (op == RuleOp::Unknown) {
+        IOManager::log(
+            LogLevel::Warning,
+            std::format("Warning: Unknown condition type '{}' in rule for "
+                        "'{}'. The rule will never match.",
+                        cond.type, rule.category));
+        usable_for_directories = false;
+        continue;
+      }
+
+      CompiledCondition compiled_cond;
+      compiled_cond.op = op;
+      compiled_cond.threshold = cond.threshold;
+      if (op == RuleOp::FileCategoryPercentage) {
+        for (const auto& name : cond.values) {
+          if (auto it = ids.find(name); it != ids.end())
+            compiled_cond.categories.push_back(it->second);
+        }
+      } else if (op == RuleOp::ContainsFilenamePattern ||
+                 op == RuleOp::ContainsFilename ||
+                 op == RuleOp::ContainsSubdirectoryNamed) {
+        compiled_cond.name_condition = program.m_name_condition_count++;
+        const NameTarget target = op == RuleOp::ContainsSubdirectoryNamed
+                                      ? NameTarget::Subdirectory
+                                      : NameTarget::File;
+        for (const auto& value : cond.values) {
+          program.m_names.add(target, value, op == RuleOp::ContainsFilename,
+                              compiled_cond.name_condition);
+        }
+      } else if (op == RuleOp::SubfolderMatchesArchive) {
+        program.m_keeps_names = true;
+      }
+      compiled.conditions.push_back(std::move(compiled_cond));
+    }
+
+    // A rule holding an EXIF or unknown condition can never be satisfied by
+    // a directory, so it is left out of the directory program entirely.
+    if (usable_for_directories) {
+      program.m_directory_rules.push_back(std::move(compiled));
+    }
+  }
+
+  program.m_names.build();
+  return program;
+}
+
+DirectoryFeatures RuleProgram::begin_directory() const {
+  DirectoryFeatures features;
+  features.name_matches.resize(m_name_condition_count);
+  features.category_counts.resize(m_categories.size());
+  return features;
+}
+
+void RuleProgram::add_file(std::string_view name,
+                           DirectoryFeatures& features) const {
+  m_names.match(NameTarget::File, name, features.name_matches);
+  if (auto id = category_for_extension(extension_of(name))) {
+    features.category_counts[*id]++;
+    features.categorized_files++;
+  }
+  if (m_keeps_names) features.filenames.emplace_back(name);
+}
+
+void RuleProgram::add_subdirectory(std::string_view name,
+                                   DirectoryFeatures& features) const {
+  m_names.match(NameTarget::Subdirectory, name, features.name_matches);
+  features.subdir_count++;
+  if (m_keeps_names) features.subdirs.emplace_back(name);
+}
+
+std::optional<Category> RuleProgram::match_exif(
+    std::string_view date) const {
+  if (date.length() != 10) return std::nullopt;
+
+  for (const auto& rule : m_exif_rules) {
+    bool match = true;
+    for (size_t i = 0; i < 10; ++i) {
+      if (rule.pattern[i] != '*' && rule.pattern[i] != date[i]) {
+        match = false;
+        break;
+      }
+    }
+    if (!match) continue;
+
+    if (rule.year_pos == std::string::npos) return rule.fixed;
+    std::string category = rule.category;
+    category.replace(rule.year_pos, 11, date.substr(0, 4));
+    return Category::intern(category);
+  }
+  return std::nullopt;
+}
+
+Category RuleProgram::match_directory(
+    const DirectoryFeatures& features) const {
+  for (const auto& rule : m_directory_rules) {
+    bool all_conditions_met = true;
+    for (const auto& cond : rule.conditions) {
+      if (!evaluate(cond, features)) {
+        all_conditions_met = false;
+        break;
+      }
+    }
+    if (all_conditions_met) return rule.category;
+  }
+  return {};
+}
+
+bool RuleProgram::evaluate(const CompiledCondition& cond,
+                           const DirectoryFeatures& features) const {
+  switch (cond.op) {
+    case RuleOp::ContainsFilenamePattern:
+    case RuleOp::ContainsFilename:
+    case RuleOp::ContainsSubdirectoryNamed:
+      return features.name_matches.test(cond.name_condition);
+    case RuleOp::HasNoSubdirectories:
+      return features.subdir_count == 0;
+    case RuleOp::FileCategoryPercentage: {
+      if (features.categorized_files == 0) return false;
+      int category_total = 0;
+      for (CategoryId id : cond.categories)
+        category_total += features.category_counts[id];
+      return static_cast<double>(category_total) /
+                 features.categorized_files >=
+             cond.threshold;
+    }
+    case RuleOp::SubfolderMatchesArchive: {
+      if (features.subdirs.empty()) return false;
+      const std::unordered_set<std::string_view, AsciiCase::Hash,
+                               AsciiCase::Equal>
+          subdirs(features.subdirs.begin(), features.subdirs.end());
+      for (std::string_view filename : features.filenames) {
+        for (auto archive_ext : kArchiveExtensions) {
+          if (AsciiCase::ends_with(filename, archive_ext) &&
+              subdirs.contains(
+                  filename.substr(0, filename.size() - archive_ext.size()))) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+    case RuleOp::ExifDateMatches:
+    case RuleOp::Unknown:
+      break;
+  }
+  return false;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AsciiCase.hpp"
+#include "Category.hpp"
+#include "ExtensionTable.hpp"
+#include "NameMatcher.hpp"
+#include "types.hpp"
+
+// Opcodes for the condition types accepted in config.json.
+enum class RuleOp : std::uint8_t {
+  ContainsFilenamePattern,
+  ContainsFilename,
+  ContainsSubdirectoryNamed,
+  HasNoSubdirectories,
+  FileCategoryPercentage,
+  SubfolderMatchesArchive,
+  ExifDateMatches,
+  Unknown,
+};
+
+RuleOp rule_op_from_string(std::string_view type);
+
+struct CompiledCondition {
+  RuleOp op = RuleOp::Unknown;
+  // For the name ops: the id set in DirectoryFeatures::name_matches when
+  // one of the condition's values matches an entry.
+  std::uint32_t name_condition = 0;
+  std::vector<CategoryId> categories;
+  double threshold = 0.0;
+};
+
+struct CompiledRule {
+  Category category;
+  std::vector<CompiledCondition> conditions;
+};
+
+struct CompiledExifRule {
+  std::string pattern;  // Always 10 characters, '*' is a wildcard.
+  std::string category;
+  size_t year_pos = std::string::npos;  // Position of "{exif_year}".
+  Category fixed;  // The interned category if it has no "{exif_year}".
+};
+
+// Facts gathered from a single pass over a directory's entries, made by
+// RuleProgram::begin_directory and filled by add_file and add_subdirectory.
+struct DirectoryFeatures {
+  ConditionBits name_matches;
+  // Names are kept only if a rule pairs files with subfolders.
+  std::vector<std::string> filenames;
+  std::vector<std::string> subdirs;
+  size_t subdir_count = 0;
+  std::vector<int> category_counts;  // Indexed by CategoryId.
+  int categorized_files = 0;
+};
+
+// An immutable, pre-processed form of a Config. Condition types are resolved
+// to opcodes, and the names of all rules are matched by one NameMatcher while
+// a directory is read, so that evaluating its rules is a series of bit tests
+// and never compares type strings or individual values.
+class RuleProgram {
+ public:
+  static RuleProgram compile(const Config& config);
+
+  // Extensions are matched ignoring ASCII case.
+  std::optional<CategoryId> category_for_extension(std::string_view ext) const {
+    return m_extension_to_category.find(ext);
+  }
+  Category category(CategoryId id) const { return m_categories[id]; }
+  size_t category_count() const { return m_categories.size(); }
+  // Where files with no category go.
+  Category default_category() const { return m_default_category; }
+
+  bool is_image_extension(std::string_view ext) const {
+    return m_image_extensions.contains(ext);
+  }
+  bool is_category_dir(const std::string& name) const {
+    return m_category_dirs.contains(name);
+  }
+  bool has_exif_rules() const { return !m_exif_rules.empty(); }
+  bool sniff_content() const { return m_sniff_content; }
+  // Stable hash of the configuration this program was compiled from.
+  std::uint64_t fingerprint() const { return m_fingerprint; }
+
+  // Returns the category for an image with the given "YYYY:MM:DD" date.
+  std::optional<Category> match_exif(std::string_view date) const;
+
+  DirectoryFeatures begin_directory() const;
+  void add_file(std::string_view name, DirectoryFeatures& features) const;
+  void add_subdirectory(std::string_view name,
+                        DirectoryFeatures& features) const;
+  // Returns the category of the first directory rule whose conditions all
+  // hold, or the empty category.
+  Category match_directory(const DirectoryFeatures& features) const;
+
+ private:
+  bool evaluate(const CompiledCondition& cond,
+                const DirectoryFeatures& features) const;
+
+  std::uint64_t m_fingerprint = 0;
+  bool m_sniff_content = false;
+  std::vector<Category> m_categories;  // Indexed by CategoryId.
+  Category m_default_category;
+  ExtensionTable m_extension_to_category;
+  std::unordered_set<std::string> m_category_dirs;
+  AsciiCase::Set m_image_extensions;
+  std::vector<CompiledExifRule> m_exif_rules;
+  std::vector<CompiledRule> m_directory_rules;
+  NameMatcher m_names;
+  std::uint32_t m_name_condition_count = 0;
+  bool m_keeps_names = false;
+};
@@ -0,0 +1,172 @@
+#include "ScanIndex.hpp"
+
+#include <array>
+#include <fstream>
+
+#include "IOManager.hpp"
+#include "utils.hpp"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace {
+constexpr std::array<char, 8> kMagic = {'O', 'R', 'G', 'S', 'I', 'D', 'X', '1'};
+// Guards against absurd lengths in a corrupt file.
+constexpr std::uint32_t kMaxStringLength = 1 << 16;
+
+template <typename T>
+void write_pod(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_string(std::ofstream& out, std::string_view s) {
+  write_pod(out, static_cast<std::uint32_t>(s.size()));
+  out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+void write_identity(std::ofstream& out, const FileIdentity& id) {
+  write_pod(out, id.dev);
+  write_pod(out, id.ino);
+  write_pod(out, id.size);
+  write_pod(out, id.mtime_ns);
+  write_pod(out, id.ctime_ns);
+}
+
+template <typename T>
+bool read_pod(std::ifstream& in, T& value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool read_string(std::ifstream& in, std::string& s) {
+  std::uint32_t length = 0;
+  if (!read_pod(in, length) || length > kMaxStringLength) return false;
+  s.resize(length);
+  return static_cast<bool>(in.read(s.data(), length));
+}
+
+bool read_identity(std::ifstream& in, FileIdentity& id) {
+  return read_pod(in, id.dev) && read_pod(in, id.ino) &&
+         read_pod(in, id.size) && read_pod(in, id.mtime_ns) &&
+         read_pod(in, id.ctime_ns);
+}
+}  // namespace
+
+std::optional<FileIdentity> FileIdentity::of(const fs::path& path) {
+#ifdef _WIN32
+  (void)path;
+  return std::nullopt;
+#else
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0) return std::nullopt;
+  return FileIdentity{
+      static_cast<std::uint64_t>(st.st_dev),
+      static_cast<std::uint64_t>(st.st_ino),
+      static_cast<std::uint64_t>(st.st_size),
+      static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+          st.st_mtim.tv_nsec,
+      static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1'000'000'000 +
+          st.st_ctim.tv_nsec};
+#endif
+}
+
+ScanIndex::ScanIndex(fs::path targetDir, std::uint64_t config_fingerprint)
+    : m_targetDir(std::move(targetDir)),
+      m_config_fingerprint(config_fingerprint) {}
+
+ScanIndex ScanIndex::load(const fs::path& indexPath, const fs::path& targetDir,
+                          std::uint64_t config_fingerprint) {
+  ScanIndex index(targetDir, config_fingerprint);
+
+  std::ifstream in(indexPath, std::ios::binary);
+  if (!in) return index;
+
+  std::array<char, 8> magic{};
+  std::uint64_t fingerprint = 0;
+  std::string stored_target;
+  std::uint64_t count = 0;
+  if (!in.read(magic.data(), magic.size()) || magic != kMagic ||
+      !read_pod(in, fingerprint) || !read_string(in, stored_target) ||
+      !read_pod(in, count)) {
+    IOManager::log("Scan index is unreadable. Performing a full scan.");
+    return index;
+  }
+  if (fingerprint != config_fingerprint ||
+      stored_target != safe_path_to_string(targetDir)) {
+    IOManager::log(
+        "Scan index belongs to another target or configuration. Performing "
+        "a full scan.");
+    return index;
+  }
+
+  for (std::uint64_t i = 0; i < count; ++i) {
+    ScanIndexEntry entry;
+    if (!read_identity(in, entry.identity) || !read_string(in, entry.name) ||
+        !read_string(in, entry.category) ||
+        !read_string(in, entry.unwrapped_child) ||
+        !read_identity(in, entry.child_identity)) {
+      IOManager::log("Scan index is truncated. Performing a full scan.");
+      index.m_entries.clear();
+      return index;
+    }
+    index.record(std::move(entry));
+  }
+  return index;
+}
+
+bool ScanIndex::save(const fs::path& indexPath) const {
+  // Write to a sibling file and rename it into place so that a crash never
+  // leaves a half-written index behind.
+  fs::path tmp_path = indexPath;
+  tmp_path += ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(kMagic.data(), kMagic.size());
+    write_pod(out, m_config_fingerprint);
+    write_string(out, safe_path_to_string(m_targetDir));
+    write_pod(out, static_cast<std::uint64_t>(m_entries.size()));
+    for (const auto& [key, entry] : m_entries) {
+      write_identity(out, entry.identity);
+      write_string(out, entry.name);
+      write_string(out, entry.category);
+      write_string(out, entry.unwrapped_child);
+      write_identity(out, entry.child_identity);
+    }
+    if (!out.flush()) return false;
+  }
+  std::error_code ec;
+  fs::rename(tmp_path, indexPath, ec);
+  if (ec) {
+    IOManager::log(LogLevel::Warning,
+                   std::format("Warning: Could not save scan index '{}': {}",
+                               safe_path_to_string(indexPath), ec.message()));
+    return false;
+  }
+  return true;
+}
+
+const ScanIndexEntry* ScanIndex::lookup(const fs::path& path,
+                                       const FileIdentity& identity) const {
+  auto it = m_entries.find({identity.dev, identity.ino});
+  if (it == m_entries.end()) return nullptr;
+
+  const ScanIndexEntry& entry = it->second;
+  if (entry.identity != identity ||
+      entry.name != safe_path_to_string(path.filename())) {
+    return nullptr;
+  }
+  // An unchanged directory still has the same single child, but that child's
+  // own contents may have changed since it was analyzed.
+  if (!entry.unwrapped_child.empty()) {
+    auto child = FileIdentity::of(path / entry.unwrapped_child);
+    if (!child || *child != entry.child_identity) return nullptr;
+  }
+  return &entry;
+}
+
+void ScanIndex::record(ScanIndexEntry entry) {
+  IdentityKey key{entry.identity.dev, entry.identity.ino};
+  m_entries.insert_or_assign(key, std::move(entry));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "types.hpp"
+
+// The identity of a filesystem entry as seen by stat(). Any change to the
+// entry's contents, name or metadata changes at least one of these fields.
+struct FileIdentity {
+  std::uint64_t dev = 0;
+  std::uint64_t ino = 0;
+  std::uint64_t size = 0;
+  std::int64_t mtime_ns = 0;
+  std::int64_t ctime_ns = 0;
+
+  bool operator==(const FileIdentity&) const = default;
+
+  // Returns std::nullopt if the entry cannot be stat'ed, or on platforms
+  // without stable inode numbers.
+  static std::optional<FileIdentity> of(const fs::path& path);
+};
+
+struct ScanIndexEntry {
+  FileIdentity identity;
+  std::string name;
+  std::string category;  // Empty if the entry produced no action.
+  // For a directory that was unwrapped to its single subdirectory, the name
+  // and identity of that subdirectory, which was the one actually analyzed.
+  std::string unwrapped_child;
+  FileIdentity child_identity;
+};
+
+// A persistent record of the classification of every top-level entry of a
+// target directory. Entries whose identity is unchanged since the previous
+// scan can reuse their stored category instead of being re-analyzed.
+// Not thread-safe; callers serialize access to record().
+class ScanIndex {
+ public:
+  ScanIndex(fs::path targetDir, std::uint64_t config_fingerprint);
+
+  // Loads an index file. Returns an empty index if the file is missing,
+  // corrupt, or was written for another target or configuration.
+  static ScanIndex load(const fs::path& indexPath, const fs::path& targetDir,
+                        std::uint64_t config_fingerprint);
+  bool save(const fs::path& indexPath) const;
+
+  // Returns the stored entry if `path` is unchanged since it was recorded.
+  const ScanIndexEntry* lookup(const fs::path& path,
+                               const FileIdentity& identity) const;
+  void record(ScanIndexEntry entry);
+
+  size_t size() const { return m_entries.size(); }
+
+ private:
+  struct IdentityKey {
+    std::uint64_t dev;
+    std::uint64_t ino;
+    bool operator==(const IdentityKey&) const = default;
+  };
+  struct IdentityKeyHash {
+    size_t operator()(const IdentityKey& k) const noexcept {
+      return std::hash<std::uint64_t>{}(k.ino * 0x9E3779B97F4A7C15ull ^ k.dev);
+    }
+  };
+
+  fs::path m_targetDir;
+  std::uint64_t m_config_fingerprint;
+  std::unordered_map<IdentityKey, ScanIndexEntry, IdentityKeyHash> m_entries;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One selection bit per plan entry, packed 64 to a word.
+class SelectionSet {
+ public:
+  void assign(size_t size, bool selected) {
+    m_size = size;
+    m_words.assign((size + 63) / 64, selected ? ~std::uint64_t{0} : 0);
+    m_count = selected ? size : 0;
+    clear_tail();
+  }
+
+  // Adds `count` entries after the existing ones, which keep their bits.
+  void append(size_t count, bool selected) {
+    const size_t begin = m_size;
+    m_size += count;
+    m_words.resize((m_size + 63) / 64, 0);
+    if (!selected) return;
+    m_count += count;
+    for (size_t i = begin; i < m_size;) {
+      const size_t bit = i % 64;
+      const size_t n = std::min<size_t>(64 - bit, m_size - i);
+      const std::uint64_t ones =
+          n == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+      m_words[i / 64] |= ones << bit;
+      i += n;
+    }
+  }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  bool test(size_t i) const { return (m_words[i / 64] >> (i % 64)) & 1; }
+  void flip(size_t i) {
+    test(i) ? --m_count : ++m_count;
+    m_words[i / 64] ^= std::uint64_t{1} << (i % 64);
+  }
+  void set_all(bool selected) { assign(m_size, selected); }
+
+  size_t count() const { return m_count; }
+
+  // Calls `f(index)` for each selected entry, in increasing order.
+  template <typename F>
+  void for_each_selected(F&& f) const {
+    for (size_t w = 0; w < m_words.size(); ++w) {
+      for (std::uint64_t word = m_words[w]; word != 0; word &= word - 1) {
+        f(w * 64 + static_cast<size_t>(std::countr_zero(word)));
+      }
+    }
+  }
+
+ private:
+  // Keeps the bits past m_size zero, so that for_each_selected stops there.
+  void clear_tail() {
+    if (m_size % 64 != 0) {
+      m_words.back() &= (std::uint64_t{1} << (m_size % 64)) - 1;
+    }
+  }
+
+  std::vector<std::uint64_t> m_words;
+  size_t m_size = 0;
+  size_t m_count = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Incremental XXH64. Data can be fed in pieces of any size; the digest is the
+// same as hashing the concatenation in one call. Used to compare file
+// contents, not for security.
+class StreamHash64 {
+ public:
+  explicit StreamHash64(std::uint64_t seed = 0) { reset(seed); }
+
+  void reset(std::uint64_t seed = 0) {
+    m_seed = seed;
+    m_acc[0] = seed + kPrime1 + kPrime2;
+    m_acc[1] = seed + kPrime2;
+    m_acc[2] = seed;
+    m_acc[3] = seed - kPrime1;
+    m_total = 0;
+    m_buffered = 0;
+  }
+
+  void update(std::span<const unsigned char> data) {
+    const unsigned char* p = data.data();
+    size_t size = data.size();
+    m_total += size;
+
+    if (m_buffered + size < kStripe) {
+      if (size) std::memcpy(m_buffer + m_buffered, p, size);
+      m_buffered += size;
+      return;
+    }
+    if (m_buffered) {
+      const size_t fill = kStripe - m_buffered;
+      std::memcpy(m_buffer + m_buffered, p, fill);
+      consume_stripe(m_buffer);
+      p += fill;
+      size -= fill;
+      m_buffered = 0;
+    }
+    for (; size >= kStripe; p += kStripe, size -= kStripe) {
+      consume_stripe(p);
+    }
+    if (size) std::memcpy(m_buffer, p, size);
+    m_buffered = size;
+  }
+
+  std::uint64_t digest() const {
+    std::uint64_t h;
+    if (m_total >= kStripe) {
+      h = std::rotl(m_acc[0], 1) + std::rotl(m_acc[1], 7) +
+          std::rotl(m_acc[2], 12) + std::rotl(m_acc[3], 18);
+      for (std::uint64_t acc : m_acc) h = merge_round(h, acc);
+    } else {
+      h = m_seed + kPrime5;
+    }
+    h += m_total;
+
+    const unsigned char* p = m_buffer;
+    size_t size = m_buffered;
+    for (; size >= 8; p += 8, size -= 8) {
+      h ^= round(0, read64(p));
+      h = std::rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (size >= 4) {
+      h ^= static_cast<std::uint64_t>(read32(p)) * kPrime1;
+      h = std::rotl(h, 23) * kPrime2 + kPrime3;
+      p += 4;
+      size -= 4;
+    }
+    for (; size > 0; ++p, --size) {
+      h ^= *p * kPrime5;
+      h = std::rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  static std::uint64_t hash(std::span<const unsigned char> data,
+                            std::uint64_t seed = 0) {
+    StreamHash64 hasher(seed);
+    hasher.update(data);
+    return hasher.digest();
+  }
+
+ private:
+  static constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+  static constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+  static constexpr std::uint64_t kPrime3 = 0x165667B19E3779F9ull;
+  static constexpr std::uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+  static constexpr std::uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+  static constexpr size_t kStripe = 32;
+
+  // The reference algorithm reads little-endian words.
+  static std::uint64_t read64(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) {
+      v = std::byteswap(v);
+    }
+    return v;
+  }
+  static std::uint32_t read32(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) {
+      v = std::byteswap(v);
+    }
+    return v;
+  }
+
+  static std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+    acc += input * kPrime2;
+    return std::rotl(acc, 31) * kPrime1;
+  }
+  static std::uint64_t merge_round(std::uint64_t h, std::uint64_t acc) {
+    h ^= round(0, acc);
+    return h * kPrime1 + kPrime4;
+  }
+
+  void consume_stripe(const unsigned char* p) {
+    for (int lane = 0; lane < 4; ++lane) {
+      m_acc[lane] = round(m_acc[lane], read64(p + 8 * lane));
+    }
+  }
+
+  std::uint64_t m_seed = 0;
+  std::uint64_t m_acc[4] = {};
+  std::uint64_t m_total = 0;
+  unsigned char m_buffer[kStripe] = {};
+  size_t m_buffered = 0;
+};
@@ -0,0 +1,243 @@
+#include "TreeWalker.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "IOManager.hpp"
+#include "WorkerPool.hpp"
+#include "utils.hpp"
+
+namespace {
+// Listed entries are handed out in batches of this size, so that even a flat
+// directory is visited by all workers while it is still being listed.
+constexpr size_t kVisitBatch = 64;
+
+struct Task {
+  fs::path directory;
+  // `directory` relative to the root, '/'-separated. Only kept when there
+  // are exclusion patterns.
+  std::string relative;
+  // Depth of the entries of `directory`.
+  unsigned depth = 0;
+  // The entries to visit; empty for a directory that is still to be listed.
+  std::vector<WalkEntry> entries;
+};
+
+struct alignas(64) Lane {
+  std::mutex mutex;
+  std::deque<Task> tasks;
+};
+
+std::string join_relative(std::string_view parent, std::string_view name) {
+  if (parent.empty()) return std::string(name);
+  std::string relative;
+  relative.reserve(parent.size() + 1 + name.size());
+  relative.append(parent).append("/").append(name);
+  return relative;
+}
+}  // namespace
+
+bool glob_match(std::string_view pattern, std::string_view text) {
+  while (!pattern.empty()) {
+    if (pattern.starts_with("**")) {
+      pattern.remove_prefix(2);
+      // "**/" also matches when no directory is crossed at all.
+      if (pattern.starts_with('/') && glob_match(pattern.substr(1), text)) {
+        return true;
+      }
+      for (size_t i = 0; i <= text.size(); ++i) {
+        if (glob_match(pattern, text.substr(i))) return true;
+      }
+      return false;
+    }
+    if (pattern.front() == '*') {
+      pattern.remove_prefix(1);
+      for (size_t i = 0;; ++i) {
+        if (glob_match(pattern, text.substr(i))) return true;
+        if (i == text.size() || text[i] == '/') return false;
+      }
+    }
+    if (text.empty()) return false;
+    if (pattern.front() == '?' ? text.front() == '/'
+                               : pattern.front() != text.front()) {
+      return false;
+    }
+    pattern.remove_prefix(1);
+    text.remove_prefix(1);
+  }
+  return text.empty();
+}
+
+TreeWalker::TreeWalker(TreeWalkOptions options)
+    : m_options(std::move(options)) {}
+
+bool TreeWalker::is_excluded(std::string_view name,
+                             std::string_view relative) const {
+  return std::ranges::any_of(m_options.exclude, [&](const std::string& glob) {
+    return glob_match(glob, glob.contains('/') ? relative : name);
+  });
+}
+
+std::optional<TreeWalker::Stats> TreeWalker::walk(
+    const fs::path& root, const Visitor& visit, std::stop_token stoken,
+    const Prepare& prepare) const {
+  const size_t worker_count = std::max(1u, m_options.max_workers);
+  const bool track_relative = !m_options.exclude.empty();
+  auto lanes = std::make_unique<Lane[]>(worker_count);
+
+  // Tasks queued or running; the walk is over when it drops to zero.
+  std::atomic<size_t> outstanding = 1;
+  // Bumped whenever work is queued or the walk ends. Idle workers wait on it.
+  std::atomic<std::uint64_t> epoch = 0;
+  std::atomic<unsigned> idle = 0;
+  std::atomic<bool> root_failed = false;
+  std::atomic<size_t> directories = 0, entries = 0, excluded = 0;
+
+  auto wake = [&](bool all) {
+    epoch.fetch_add(1);
+    if (all || idle.load() > 0) epoch.notify_all();
+  };
+  std::stop_callback on_stop(stoken, [&] { wake(true); });
+
+  lanes[0].tasks.push_back(Task{root, {}, 0, {}});
+
+  auto push = [&](size_t lane, Task task) {
+    outstanding.fetch_add(1);
+    {
+      std::scoped_lock lock(lanes[lane].mutex);
+      lanes[lane].tasks.push_back(std::move(task));
+    }
+    wake(false);
+  };
+
+  auto take = [&](size_t self) -> std::optional<Task> {
+    {
+      Lane& own = lanes[self];
+      std::scoped_lock lock(own.mutex);
+      if (!own.tasks.empty()) {
+        Task task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return task;
+      }
+    }
+    for (size_t k = 1; k < worker_count; ++k) {
+      Lane& victim = lanes[(self + k) % worker_count];
+      std::scoped_lock lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        Task task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return task;
+      }
+    }
+    return std::nullopt;
+  };
+
+  auto list_directory = [&](size_t self, Task& task) {
+    const bool is_root = task.depth == 0;
+    DirectoryReader reader(task.directory);
+    std::vector<DirEntry> listed;
+    std::vector<WalkEntry> batch;
+    bool listed_any = false;
+    while (reader.next(listed)) {
+      listed_any = true;
+      for (auto& entry : listed) {
+        if (stoken.stop_requested()) return;
+        if (track_relative) {
+          const auto& name = entry_name_utf8(entry);
+          if (is_excluded(name, join_relative(task.relative, name))) {
+            excluded++;
+            continue;
+          }
+        }
+        batch.push_back({task.directory / entry.name, entry.type, {}});
+        if (batch.size() == kVisitBatch) {
+          push(self, Task{task.directory, task.relative, task.depth,
+                          std::move(batch)});
+          batch.clear();
+        }
+      }
+    }
+    if (reader.error()) {
+      if (is_root && !listed_any) root_failed = true;
+      IOManager::log(is_root ? LogLevel::Error : LogLevel::Warning,
+                     std::format("Error scanning directory '{}': {}",
+                                 safe_path_to_string(task.directory),
+                                 reader.error().message()));
+    }
+    if (listed_any || !reader.error()) directories++;
+    if (!batch.empty()) {
+      push(self, Task{task.directory, task.relative, task.depth,
+                      std::move(batch)});
+    }
+  };
+
+  auto visit_entries = [&](size_t self, Task& task) {
+    entries += task.entries.size();
+    if (prepare) prepare(task.entries, task.depth);
+    for (const auto& entry : task.entries) {
+      if (stoken.stop_requested()) return;
+      // Symlinked directories are never entered, so the walk cannot loop.
+      const bool can_descend = task.depth < m_options.max_depth &&
+                               entry.type == EntryType::Directory;
+      bool descend = false;
+      try {
+        descend = visit(entry, task.depth, can_descend);
+      } catch (const std::exception& e) {
+        IOManager::log(LogLevel::Warning,
+                       std::format("Error visiting '{}': {}. Skipping.",
+                                   safe_path_to_string(entry.path),
+                                   e.what()));
+      }
+      if (descend && can_descend) {
+        std::string relative;
+        if (track_relative) {
+          relative = join_relative(
+              task.relative, safe_path_to_string(entry.path.filename()));
+        }
+        push(self, Task{entry.path, std::move(relative), task.depth + 1, {}});
+      }
+    }
+  };
+
+  auto worker = [&](size_t self) {
+    while (!stoken.stop_requested() && outstanding.load() > 0) {
+      const std::uint64_t seen = epoch.load();
+      std::optional<Task> task = take(self);
+      if (!task) {
+        idle++;
+        epoch.wait(seen);
+        idle--;
+        continue;
+      }
+      // A task that throws is skipped: it must still count as done, or the
+      // other workers would wait for it forever.
+      try {
+        if (task->entries.empty()) {
+          list_directory(self, *task);
+        } else {
+          visit_entries(self, *task);
+        }
+      } catch (const std::exception& e) {
+        IOManager::log(LogLevel::Warning,
+                       std::format("Error scanning '{}': {}. Skipping.",
+                                   safe_path_to_string(task->directory),
+                                   e.what()));
+      } catch (...) {
+        IOManager::log(LogLevel::Warning,
+                       std::format("Error scanning '{}'. Skipping.",
+                                   safe_path_to_string(task->directory)));
+      }
+      if (outstanding.fetch_sub(1) == 1) wake(true);
+    }
+  };
+
+  WorkerPool::shared().run_parallel(
+      PoolLane::Io, static_cast<unsigned>(worker_count),
+      [&](unsigned slot) { worker(slot); });
+
+  if (root_failed) return std::nullopt;
+  return Stats{directories.load(), entries.load(), excluded.load()};
+}
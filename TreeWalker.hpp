@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "DirectoryReader.hpp"
+#include "types.hpp"
+
+struct TreeWalkOptions {
+  static constexpr unsigned kUnlimitedDepth =
+      std::numeric_limits<unsigned>::max();
+
+  // Directory levels below the root that are entered. 0 lists only the root.
+  unsigned max_depth = 0;
+  // Entries matching one of these globs are neither visited nor entered. A
+  // pattern containing '/' is matched against the path relative to the root,
+  // any other pattern against the entry's name.
+  std::vector<std::string> exclude;
+  // Upper bound on the I/O lane workers of the shared pool used by one walk.
+  unsigned max_workers = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// An entry found by the walk. The type comes from the directory listing, so
+// no entry is stat'ed just to be visited.
+struct WalkEntry {
+  fs::path path;
+  EntryType type = EntryType::Unknown;
+  // The extension implied by the entry's contents, once it was sniffed; empty
+  // if no signature matched.
+  std::optional<std::string_view> sniffed_extension;
+};
+
+// Matches `text` against a glob. '*' and '?' do not match '/'; '**' does.
+bool glob_match(std::string_view pattern, std::string_view text);
+
+// Walks a directory tree in parallel. Each worker owns a deque of pending
+// work, either a directory to list or a batch of listed entries to visit. It
+// takes work from the back of its own deque and steals from the front of the
+// others' when it runs dry, so a single huge subtree is shared out among all
+// workers instead of serializing the walk. The workers are borrowed from
+// the shared pool's I/O lane.
+class TreeWalker {
+ public:
+  struct Stats {
+    size_t directories = 0;
+    size_t entries = 0;
+    size_t excluded = 0;
+  };
+
+  // Called concurrently for every entry that is not excluded, with its depth
+  // (0 for children of the root). `can_descend` is true for a directory that
+  // is not a symlink and lies above the depth limit; returning true enters it.
+  using Visitor = std::function<bool(const WalkEntry& entry, unsigned depth,
+                                     bool can_descend)>;
+  // Called with each batch of entries before they are visited, on the same
+  // worker. It may take entries out of the batch, e.g. to hand them to
+  // another stage; only the entries left are visited.
+  using Prepare =
+      std::function<void(std::vector<WalkEntry>& batch, unsigned depth)>;
+
+  explicit TreeWalker(TreeWalkOptions options = {});
+
+  // Returns once every reachable entry was visited or `stoken` is triggered.
+  // Returns std::nullopt if the root itself cannot be listed.
+  std::optional<Stats> walk(const fs::path& root, const Visitor& visit,
+                            std::stop_token stoken = {},
+                            const Prepare& prepare = {}) const;
+
+ private:
+  bool is_excluded(std::string_view name, std::string_view relative) const;
+
+  TreeWalkOptions m_options;
+};
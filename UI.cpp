@@ -1,23 +1,27 @@
 #include "UI.hpp"
 
 #include <algorithm>
-#include <execution>
 #include <ftxui/component/component.hpp>
 #include <ftxui/dom/elements.hpp>
 #include <future>
+#include <iterator>
 #include <mutex>
+#include <set>
+#include <thread>
 #include <utility>
 
 #include "IOManager.hpp"
+#include "WorkerPool.hpp"
 #include "utils.hpp"
 
 using namespace ftxui;
 
-UI::UI(const Config& config, const fs::path& targetDir)
+UI::UI(const Config& config, const fs::path& targetDir,
+       RuleEngineOptions engine_options)
     : m_screen(ScreenInteractive::Fullscreen()),
       m_config(config),
       m_targetDir(targetDir),
-      m_engine(m_config),
+      m_engine(m_config, std::move(engine_options)),
       m_status_text("Ready. Press 'Scan' to begin."),
       m_scan_button_label("  Scan  "),
       m_apply_button_label(" Apply Selected (Enter) ") {
@@ -26,40 +30,24 @@ UI::UI(const Config& config, const fs::path& targetDir)
   try {
     m_plan_component =
         Renderer([&] {
-          if (m_plan_entries.empty()) {
+          if (m_plan.empty()) {
             return text(m_status_text) | center;
           }
-          Elements elements;
-          for (size_t i = 0; i < m_plan_entries.size(); ++i) {
-            Element entry = text((m_plan_selections[i] ? "[X] " : "[ ] ") +
-                                 m_plan_entries[i]);
-            if ((int)i == m_selected_action) {
-              entry = entry | inverted | focus;
-            }
-            elements.push_back(entry);
-          }
-          return vbox(elements) | vscroll_indicator | frame;
+          return m_plan_view.render();
         }) |
         CatchEvent([&](Event event) {
-          if (m_is_operation_in_progress) {
+          // Rows streamed by a running scan can already be selected.
+          if (m_is_operation_in_progress && !m_scan_active) {
             return false;
           }
           if (event.is_mouse()) return false;
-          if (event == Event::ArrowUp && m_selected_action > 0) {
-            m_selected_action--;
-          } else if (event == Event::ArrowDown &&
-                     m_selected_action < (int)m_plan_entries.size() - 1) {
-            m_selected_action++;
-          } else if (event == Event::Character(' ') &&
-                     !m_plan_selections.empty()) {
-            m_plan_selections[m_selected_action] =
-                !m_plan_selections[m_selected_action];
-          } else if (event == Event::Return && !m_plan.empty()) {
+          if (m_plan_view.on_event(event)) return true;
+          if (event == Event::Return && !m_plan.empty() &&
+              !m_is_operation_in_progress) {
             execute_plan();
-          } else {
-            return false;
+            return true;
           }
-          return true;
+          return false;
         });
 
     m_log_component = Renderer([&] {
@@ -74,8 +62,10 @@ UI::UI(const Config& config, const fs::path& targetDir)
     });
 
   } catch (const std::exception& e) {
-    IOManager::log(std::format(
-        "CRITICAL: Failed to initialize UI components: {}", e.what()));
+    IOManager::log(
+        LogLevel::Error,
+        std::format("CRITICAL: Failed to initialize UI components: {}",
+                    e.what()));
     throw;
   }
 }
@@ -91,21 +81,20 @@ void UI::AddLogMessage(std::string_view message) {
   m_screen.Post(Event::Custom);
 }
 
-void UI::cleanup_finished_threads() {
-  std::erase_if(m_worker_threads,
-                [](const std::jthread& t) { return !t.joinable(); });
+void UI::cleanup_finished_tasks() {
+  std::erase_if(m_tasks, [](const std::future<void>& task) {
+    return task.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  });
 }
 
 void UI::update_ui_from_plan() {
-  m_plan_entries.clear();
-  m_plan_selections.clear();
-  m_selected_action = 0;
-  for (const auto& action : m_plan) {
-    m_plan_entries.push_back(std::format(
-        "Move '{}' to '{}'", safe_path_to_string(action.from.filename()),
-        safe_path_to_string(action.to.parent_path())));
-    m_plan_selections.push_back(true);
-  }
+  m_plan_selections.assign(m_plan.size(), true);
+  m_plan_view.reset();
+  show_plan_status();
+}
+
+void UI::show_plan_status() {
   if (m_plan.empty()) {
     m_status_text = "Scan complete. No actions proposed.";
   } else {
@@ -116,76 +105,170 @@ void UI::update_ui_from_plan() {
   }
 }
 
-void UI::execute_plan() {
+void UI::start_scan() {
   if (m_is_operation_in_progress) return;
+  m_is_operation_in_progress = true;
+  m_scan_active = true;
+  m_scan_running = true;
+  cleanup_finished_tasks();
+  m_plan.clear();
+  update_ui_from_plan();
+  m_status_text = "Scanning... Results appear as they are found.";
+  m_scan_progress.reset();
+  m_scan_started = std::chrono::steady_clock::now();
+
+  WorkerPool& pool = WorkerPool::shared();
+  m_tasks.push_back(pool.async(PoolLane::Io, [self = shared_from_this(),
+                                              stoken = m_stop.get_token()] {
+    std::optional<std::vector<Action>> plan;
+    try {
+      IOManager::log("Starting scan...");
+      plan = self->m_engine.generate_plan(
+          self->m_targetDir, stoken,
+          [&self](std::span<const Action> batch) {
+            self->stream_batch(batch);
+          },
+          &self->m_scan_progress);
+      if (stoken.stop_requested()) {
+        IOManager::log("Scan was cancelled, UI will not be updated.");
+      } else {
+        IOManager::log(
+            std::format("Scan completed. Found {} actions.", plan->size()));
+      }
+    } catch (const std::exception& e) {
+      IOManager::log(LogLevel::Error,
+                     std::format("ERROR during scan: {}", e.what()));
+      plan.reset();
+    } catch (...) {
+      IOManager::log(LogLevel::Error, "ERROR during scan: Unknown exception");
+      plan.reset();
+    }
+    self->m_scan_running = false;
+    self->m_screen.Post([self, plan = std::move(plan),
+                         cancelled = stoken.stop_requested()]() mutable {
+      self->finish_scan(std::move(plan), cancelled);
+    });
+  }));
+
+  // Redraws the progress gauge while the scan runs, also when no batch
+  // arrives for a while.
+  m_tasks.push_back(pool.async(PoolLane::Io, [self = shared_from_this(),
+                                              stoken = m_stop.get_token()] {
+    while (self->m_scan_running && !stoken.stop_requested()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      self->m_screen.Post(Event::Custom);
+    }
+  }));
+}
 
-  std::vector<Action> actions_to_execute;
+void UI::stream_batch(std::span<const Action> batch) {
+  bool first = false;
+  {
+    std::scoped_lock lock(m_streamed_mutex);
+    first = m_streamed.empty();
+    m_streamed.insert(m_streamed.end(), batch.begin(), batch.end());
+  }
+  // One merge is queued at a time; it takes whatever arrived until it runs.
+  if (first) {
+    m_screen.Post([self = shared_from_this()] { self->merge_streamed(); });
+  }
+}
+
+void UI::merge_streamed() {
+  std::vector<Action> streamed;
+  {
+    std::scoped_lock lock(m_streamed_mutex);
+    streamed.swap(m_streamed);
+  }
+  if (!m_scan_active) return;
+  m_plan_selections.append(streamed.size(), true);
+  std::ranges::move(streamed, std::back_inserter(m_plan));
+}
+
+void UI::finish_scan(std::optional<std::vector<Action>> plan,
+                     bool cancelled) {
+  merge_streamed();
+  m_scan_active = false;
+  m_is_operation_in_progress = false;
+  if (!plan || cancelled) {
+    m_plan.clear();
+    update_ui_from_plan();
+    m_status_text = cancelled ? "Scan cancelled. Ready."
+                              : "Scan failed. See the log for details.";
+    return;
+  }
+
+  // Choices made while the scan ran carry over to the final plan, which is
+  // sorted and may have duplicates resolved.
+  std::set<fs::path> deselected;
   for (size_t i = 0; i < m_plan.size(); ++i) {
-    if (m_plan_selections[i]) {
-      actions_to_execute.push_back(m_plan[i]);
+    if (!m_plan_selections.test(i)) deselected.insert(m_plan[i].from);
+  }
+  std::optional<fs::path> cursor_path;
+  if (m_plan_view.cursor() < m_plan.size()) {
+    cursor_path = m_plan[m_plan_view.cursor()].from;
+  }
+
+  m_plan = std::move(*plan);
+  update_ui_from_plan();
+  if (!deselected.empty()) {
+    for (size_t i = 0; i < m_plan.size(); ++i) {
+      if (deselected.contains(m_plan[i].from)) m_plan_selections.flip(i);
     }
   }
+  if (cursor_path) {
+    const auto it = std::ranges::lower_bound(m_plan, *cursor_path, {},
+                                             &Action::from);
+    if (it != m_plan.end()) m_plan_view.set_cursor(it - m_plan.begin());
+  }
+}
+
+Element UI::render_scan_progress() const {
+  const size_t listed = m_scan_progress.listed.load();
+  const size_t classified = std::min(listed, m_scan_progress.classified.load());
+  const bool listing_done = m_scan_progress.listing_done.load();
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - m_scan_started)
+                             .count();
+  const double rate = seconds > 0 ? classified / seconds : 0;
+  // The total is only known once the walk is over.
+  std::string eta = "estimating";
+  if (listing_done && rate > 0) {
+    eta = std::format("{:.0f}s", (listed - classified) / rate);
+  }
+  const float ratio =
+      listed == 0 ? 0.0f : static_cast<float>(classified) / listed;
+  return hbox({text(std::format(" Scanning: {} of {}{} classified, {:.0f}/s, "
+                                "ETA {} ",
+                                classified, listed, listing_done ? "" : "+",
+                                rate, eta)),
+               gauge(ratio) | flex});
+}
+
+void UI::execute_plan() {
+  if (m_is_operation_in_progress) return;
+
+  std::vector<Action> actions_to_execute;
+  actions_to_execute.reserve(m_plan_selections.count());
+  m_plan_selections.for_each_selected(
+      [&](size_t i) { actions_to_execute.push_back(m_plan[i]); });
 
   if (actions_to_execute.empty()) {
     m_status_text = "Nothing selected to apply.";
     return;
   }
 
-  cleanup_finished_threads();
+  cleanup_finished_tasks();
   IOManager::log("Executing plan...");
   m_status_text = "Execution in progress...";
   m_is_operation_in_progress = true;
 
-  m_worker_threads.emplace_back([self = shared_from_this(),
-                                 actions = std::move(actions_to_execute)](
-                                    const std::stop_token& stoken) {
+  m_tasks.push_back(WorkerPool::shared().async(
+      PoolLane::Io, [self = shared_from_this(),
+                     actions = std::move(actions_to_execute),
+                     stoken = m_stop.get_token()] {
     try {
-      std::mutex journal_mutex;
-      std::vector<JournalEntry> final_journal;
-      final_journal.reserve(actions.size());
-
-      // Sequential I/O loop to avoid thrashing
-      for (const auto& action : actions) {
-        if (stoken.stop_requested()) {
-          IOManager::log("Execution cancelled by user.");
-          break;
-        }
-
-        fs::path from_path = action.from;
-        fs::path to_path = action.to;
-        fs::path parent_dir = to_path.parent_path();
-
-        try {
-          if (!fs::exists(parent_dir)) {
-            std::error_code ec;
-            fs::create_directories(parent_dir, ec);
-            if (ec) {
-              IOManager::log(
-                  std::format("[DIR] Failed to create directory '{}': {}",
-                              safe_path_to_string(parent_dir), ec.message()));
-              continue;
-            }
-            IOManager::log(std::format("[DIR] Creating directory: '{}'",
-                                       safe_path_to_string(parent_dir)));
-          }
-
-          fs::path final_to_path = generate_unique_path(to_path);
-
-          IOManager::log(std::format("Moving '{}' -> '{}'",
-                                     safe_path_to_string(from_path),
-                                     safe_path_to_string(final_to_path)));
-          fs::rename(from_path, final_to_path);
-
-          std::scoped_lock lock(journal_mutex);
-          final_journal.push_back({ActionType::MOVE, from_path, final_to_path});
-
-        } catch (const fs::filesystem_error& e) {
-          IOManager::log(std::format("ERROR moving file {}: {}",
-                                     safe_path_to_string(from_path), e.what()));
-        }
-      }
-
-      IOManager::save_journal("organizer_journal.json", final_journal);
+      IOManager::apply_plan(actions, "organizer_journal.json", stoken);
       IOManager::log("Execution complete.");
 
       self->m_screen.Post([self] {
@@ -195,17 +278,19 @@ void UI::execute_plan() {
       });
     } catch (const std::exception& e) {
       IOManager::log(
+          LogLevel::Error,
           std::format("CRITICAL ERROR in execute_plan: {}", e.what()));
       self->m_screen.Post([self, error_msg = std::string(e.what())] {
         self->m_status_text = "Execution failed: " + error_msg;
       });
     } catch (...) {
-      IOManager::log("CRITICAL ERROR in execute_plan: Unknown exception");
+      IOManager::log(LogLevel::Error,
+                     "CRITICAL ERROR in execute_plan: Unknown exception");
       self->m_screen.Post(
           [self] { self->m_status_text = "Execution failed: Unknown error"; });
     }
     self->m_is_operation_in_progress = false;
-  });
+  }));
 }
 
 void UI::run() {
@@ -216,67 +301,11 @@ void UI::run() {
     m_scan_button_label = "  Scan  ";
     m_apply_button_label = " Apply Selected (Enter) ";
 
-    auto scan_button = Button(&m_scan_button_label, [this] {
-      if (m_is_operation_in_progress) {
-        return;
-      }
-      m_is_operation_in_progress = true;
-      cleanup_finished_threads();
-      m_status_text = "Scanning in background... Please wait.";
-
-      m_worker_threads.emplace_back([self = shared_from_this()](
-                                        const std::stop_token& stoken) {
-        try {
-          IOManager::log("Starting scan...");
-          std::vector<Action> plan_result =
-              self->m_engine.generate_plan(self->m_targetDir, stoken);
-
-          if (stoken.stop_requested()) {
-            IOManager::log("Scan was cancelled, UI will not be updated.");
-            self->m_screen.Post(
-                [self] { self->m_status_text = "Scan cancelled. Ready."; });
-            self->m_is_operation_in_progress = false;
-            return;
-          }
-
-          IOManager::log(std::format("Scan completed. Found {} actions.",
-                                     plan_result.size()));
-
-          self->m_screen.Post([self,
-                               plan_result = std::move(plan_result)]() mutable {
-            try {
-              IOManager::log("Updating UI with scan results...");
-
-              self->m_plan = std::move(plan_result);
-              self->update_ui_from_plan();
-
-              IOManager::log("UI updated successfully.");
-            } catch (const std::exception& e) {
-              IOManager::log(std::format("ERROR updating UI: {}", e.what()));
-              self->m_status_text =
-                  "Error updating UI: " + std::string(e.what());
-            }
-          });
-
-        } catch (const std::exception& e) {
-          IOManager::log(std::format("ERROR during scan: {}", e.what()));
-          self->m_screen.Post([self, error_msg = std::string(e.what())] {
-            self->m_status_text = "Scan failed: " + error_msg;
-          });
-        } catch (...) {
-          IOManager::log("ERROR during scan: Unknown exception");
-          self->m_screen.Post(
-              [self] { self->m_status_text = "Scan failed: Unknown error"; });
-        }
-        self->m_is_operation_in_progress = false;
-      });
-    });
+    auto scan_button = Button(&m_scan_button_label, [this] { start_scan(); });
 
     auto quit_button = Button("  Quit  ", [this] {
-      IOManager::log("Quit requested. Stopping worker threads...");
-      for (auto& t : m_worker_threads) {
-        t.request_stop();
-      }
+      IOManager::log("Quit requested. Stopping background tasks...");
+      m_stop.request_stop();
       m_screen.Exit();
     });
 
@@ -317,7 +346,9 @@ void UI::run() {
                color(Color::White) | bgcolor(Color::Blue),
            top_menu->Render(), separator(), m_plan_component->Render() | flex,
            separator(),
-           hbox({text(" " + m_status_text), filler(), apply_button_element})});
+           hbox({m_scan_active ? render_scan_progress() | flex
+                               : text(" " + m_status_text),
+                 filler(), apply_button_element})});
 
       auto log_pane =
           vbox({text("Log Output") | bold, m_log_component->Render() | flex});
@@ -329,20 +360,21 @@ void UI::run() {
 
     IOManager::log("Starting UI event loop...");
     m_screen.Loop(final_renderer);
-    IOManager::log("UI event loop exited. Waiting for threads to join...");
+    IOManager::log("UI event loop exited. Waiting for tasks to finish...");
 
-    cleanup_finished_threads();
-    m_worker_threads.clear();
+    for (auto& task : m_tasks) task.wait();
+    m_tasks.clear();
 
-    IOManager::log("All threads joined. Exiting.");
+    IOManager::log("All tasks finished. Exiting.");
     IOManager::set_log_handler(nullptr);
 
   } catch (const std::exception& e) {
     IOManager::log(
+        LogLevel::Error,
         std::format("CRITICAL: Exception in UI::run(): {}", e.what()));
     throw;
   } catch (...) {
-    IOManager::log("CRITICAL: Unknown exception in UI::run()");
+    IOManager::log(LogLevel::Error, "CRITICAL: Unknown exception in UI::run()");
     throw;
   }
 }
\ No newline at end of file
@@ -1,27 +1,42 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <stop_token>
 #include <string>
-#include <thread>
 #include <vector>
 
+#include "PlanListView.hpp"
 #include "RuleEngine.hpp"
+#include "SelectionSet.hpp"
 
 class UI : public std::enable_shared_from_this<UI> {
  public:
-  UI(const Config& config, const fs::path& targetDir);
+  UI(const Config& config, const fs::path& targetDir,
+     RuleEngineOptions engine_options = RuleEngineOptions::persistent());
   void run();
 
  private:
+  void start_scan();
+  // Called by the scan's workers with each batch of planned moves.
+  void stream_batch(std::span<const Action> batch);
+  // The following run on the UI thread.
+  void merge_streamed();
+  void finish_scan(std::optional<std::vector<Action>> plan, bool cancelled);
+  ftxui::Element render_scan_progress() const;
+
   void execute_plan();
   void update_ui_from_plan();
-  void cleanup_finished_threads();
+  void show_plan_status();
+  void cleanup_finished_tasks();
 
   void AddLogMessage(std::string_view message);
   std::mutex m_log_mutex;
@@ -33,13 +48,23 @@ class UI : public std::enable_shared_from_this<UI> {
   RuleEngine m_engine;
 
   std::vector<Action> m_plan;
-  std::vector<std::string> m_plan_entries;
-  std::vector<bool> m_plan_selections;
+  SelectionSet m_plan_selections;
+  PlanListView m_plan_view{m_plan, m_plan_selections};
   std::string m_status_text;
-  int m_selected_action = 0;
-  std::vector<std::jthread> m_worker_threads;
+  // Scans and applies run on the shared worker pool; Quit stops them.
+  std::stop_source m_stop;
+  std::vector<std::future<void>> m_tasks;
   std::atomic<bool> m_is_operation_in_progress = false;
 
+  // While a scan runs, its moves are appended to m_plan as they are found
+  // and can already be selected; the final plan replaces them at the end.
+  bool m_scan_active = false;  // UI thread only.
+  std::atomic<bool> m_scan_running = false;
+  ScanProgress m_scan_progress;
+  std::chrono::steady_clock::time_point m_scan_started;
+  std::mutex m_streamed_mutex;
+  std::vector<Action> m_streamed;  // Not yet merged into m_plan.
+
   std::string m_scan_button_label;
   std::string m_apply_button_label;
 
@@ -0,0 +1,276 @@
+#include "UndoEngine.hpp"
+
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "CrossDevice.hpp"
+#include "IOManager.hpp"
+#include "Journal.hpp"
+#include "WorkerPool.hpp"
+#include "utils.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <stdio.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+struct PendingUndo {
+  JournalEntry entry;
+  std::uint64_t offset = 0;
+  size_t length = 0;
+  unsigned level = 0;
+  bool ok = false;
+};
+
+// Moves `to` back to `from` unless something else has taken `from` since.
+std::error_code rename_back(const fs::path& to, const fs::path& from) {
+#ifdef __linux__
+  if (::renameat2(AT_FDCWD, to.c_str(), AT_FDCWD, from.c_str(),
+                  RENAME_NOREPLACE) == 0) {
+    return {};
+  }
+  if (errno != EINVAL && errno != ENOSYS) {
+    return {errno, std::generic_category()};
+  }
+#endif
+  std::error_code ec;
+  if (fs::exists(from, ec)) return std::make_error_code(std::errc::file_exists);
+  fs::rename(to, from, ec);
+  return ec;
+}
+
+// Recreates a deleted duplicate from the copy that was kept, with the kept
+// copy's permissions, owner and timestamps.
+std::error_code restore_copy(const fs::path& kept, const fs::path& from) {
+  MoveMethod method = MoveMethod::Buffered;
+  return CrossDevice::copy(kept, from, method);
+}
+
+// Gives a hard-linked duplicate its own copy of the contents again.
+std::error_code split_link(const fs::path& path) {
+  const fs::path tmp =
+      path.parent_path() / fs::path(path.filename()).concat(".undo.tmp");
+  std::error_code ec;
+  fs::copy_file(path, tmp, fs::copy_options::overwrite_existing, ec);
+  if (!ec) fs::rename(tmp, path, ec);
+  if (ec) {
+    std::error_code ignored;
+    fs::remove(tmp, ignored);
+  }
+  return ec;
+}
+
+// Parent directories of undo targets known to exist, shared by all workers
+// so that each is checked or created once per run.
+class ParentCache {
+ public:
+  std::error_code ensure(const fs::path& dir) {
+    if (dir.empty()) return {};
+    const std::string key = safe_path_to_string(dir);
+    {
+      std::scoped_lock lock(m_mutex);
+      if (m_known.contains(key)) return {};
+    }
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return ec;
+    std::scoped_lock lock(m_mutex);
+    m_known.insert(key);
+    return {};
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::unordered_set<std::string> m_known;
+};
+
+// Copies the byte ranges of the entries that were kept into a new journal.
+bool rewrite_journal(
+    const fs::path& journalPath,
+    std::vector<std::pair<std::uint64_t, size_t>>& kept) {
+  std::error_code ec;
+  if (kept.empty()) {
+    fs::remove(journalPath, ec);
+    return !ec;
+  }
+
+  std::sort(kept.begin(), kept.end());
+  const fs::path tmp = fs::path(journalPath).concat(".tmp");
+  {
+    std::ifstream in(journalPath, std::ios::binary);
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    std::string line;
+    for (const auto& [offset, length] : kept) {
+      line.resize(length);
+      in.seekg(static_cast<std::streamoff>(offset));
+      if (!in.read(line.data(), static_cast<std::streamsize>(length))) {
+        return false;
+      }
+      out << line << '\n';
+    }
+    if (!out.flush()) return false;
+  }
+  return Journal::replace(tmp, journalPath);
+}
+}  // namespace
+
+bool UndoFilter::matches(const JournalEntry& entry) const {
+  const std::chrono::system_clock::time_point when{
+      std::chrono::milliseconds(entry.time_ms)};
+  // Entries from journals without timestamps only match unbounded ranges.
+  if (since && (entry.time_ms == 0 || when < *since)) return false;
+  if (until && (entry.time_ms == 0 || when > *until)) return false;
+  if (!categories.empty() &&
+      std::find(categories.begin(), categories.end(), entry.category) ==
+          categories.end()) {
+    return false;
+  }
+  return true;
+}
+
+UndoEngine::UndoEngine(UndoOptions options) : m_options(options) {}
+
+UndoResult UndoEngine::run(const fs::path& journalPath,
+                           const UndoFilter& filter,
+                           std::stop_token stoken) const {
+  UndoResult result;
+  // Journals from older versions are a single array; convert them first.
+  if (Journal::is_legacy(journalPath)) Journal::recover(journalPath);
+
+  Journal::ReverseReader reader(journalPath);
+  if (!reader.ok()) {
+    IOManager::log(LogLevel::Error,
+                   std::format("ERROR: cannot read journal '{}'",
+                               safe_path_to_string(journalPath)));
+    return result;
+  }
+
+  // Byte ranges of the lines that stay in the journal.
+  std::vector<std::pair<std::uint64_t, size_t>> kept;
+  ParentCache parents;
+  std::vector<PendingUndo> batch;
+  bool exhausted = false;
+
+  while (!exhausted && !stoken.stop_requested()) {
+    batch.clear();
+    while (batch.size() < std::max<size_t>(1, m_options.batch_size)) {
+      auto line = reader.previous();
+      if (!line) {
+        exhausted = true;
+        break;
+      }
+      JournalEntry entry;
+      try {
+        entry = json::parse(line->text).get<JournalEntry>();
+      } catch (const json::exception&) {
+        // Undo only ever removes the records it reverted.
+        IOManager::log(
+            LogLevel::Warning,
+            std::format("Keeping unreadable journal record at byte {}",
+                        line->offset));
+        kept.emplace_back(line->offset, line->text.size());
+        continue;
+      }
+      if (!filter.matches(entry)) {
+        result.skipped++;
+        kept.emplace_back(line->offset, line->text.size());
+        continue;
+      }
+      batch.push_back(
+          {std::move(entry), line->offset, line->text.size(), 0, false});
+    }
+
+    // A move depends on every newer move that touched one of its paths.
+    std::unordered_map<std::string, unsigned> last_level;
+    unsigned max_level = 0;
+    for (auto& pending : batch) {
+      const std::string from = safe_path_to_string(pending.entry.from);
+      const std::string to = safe_path_to_string(pending.entry.to);
+      unsigned& from_level = last_level[from];
+      unsigned& to_level = last_level[to];
+      pending.level = std::max(from_level, to_level) + 1;
+      from_level = to_level = pending.level;
+      max_level = std::max(max_level, pending.level);
+    }
+
+    std::vector<std::vector<PendingUndo*>> levels(max_level);
+    for (auto& pending : batch) levels[pending.level - 1].push_back(&pending);
+
+    for (auto& level : levels) {
+      if (stoken.stop_requested()) break;
+      WorkerPool::shared().for_each_index(
+          PoolLane::Io, level.size(),
+          [&](size_t i) {
+            PendingUndo* pending = level[i];
+            const JournalEntry& entry = pending->entry;
+            if (stoken.stop_requested()) return;
+            std::error_code ec;
+            switch (entry.action) {
+              case ActionType::MOVE:
+                IOManager::log(std::format("Undoing move: '{}' -> '{}'",
+                                           safe_path_to_string(entry.to),
+                                           safe_path_to_string(entry.from)));
+                ec = parents.ensure(entry.from.parent_path());
+                if (!ec) ec = rename_back(entry.to, entry.from);
+                if (ec == std::errc::cross_device_link) {
+                  MoveMethod method = MoveMethod::Rename;
+                  ec = CrossDevice::move(entry.to, entry.from, method);
+                }
+                break;
+              case ActionType::REMOVE:
+                IOManager::log(std::format("Restoring duplicate: '{}' -> '{}'",
+                                           safe_path_to_string(entry.to),
+                                           safe_path_to_string(entry.from)));
+                ec = parents.ensure(entry.from.parent_path());
+                if (!ec) ec = restore_copy(entry.to, entry.from);
+                break;
+              case ActionType::HARDLINK:
+                IOManager::log(std::format("Unlinking duplicate: '{}'",
+                                           safe_path_to_string(entry.from)));
+                ec = split_link(entry.from);
+                break;
+              case ActionType::REFLINK:
+                // A clone already has storage of its own.
+                break;
+            }
+            if (ec) {
+              IOManager::log(LogLevel::Error,
+                             std::format("   Error undoing move: {}",
+                                         ec.message()));
+              return;
+            }
+            pending->ok = true;
+          },
+          stoken, m_options.max_workers);
+    }
+
+    for (const auto& pending : batch) {
+      if (pending.ok) {
+        result.undone++;
+      } else {
+        // Failed and cancelled entries stay undoable.
+        if (!stoken.stop_requested()) result.failed++;
+        kept.emplace_back(pending.offset, pending.length);
+      }
+    }
+  }
+
+  // Whatever was not read yet because of cancellation stays as well.
+  if (!exhausted) {
+    while (auto line = reader.previous()) {
+      kept.emplace_back(line->offset, line->text.size());
+    }
+  }
+
+  if (!rewrite_journal(journalPath, kept)) {
+    IOManager::log(LogLevel::Error,
+                   std::format("ERROR: could not update journal '{}'",
+                               safe_path_to_string(journalPath)));
+  }
+  return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+// Selects which journal entries an undo reverts. An empty filter selects
+// everything.
+struct UndoFilter {
+  std::optional<std::chrono::system_clock::time_point> since;
+  std::optional<std::chrono::system_clock::time_point> until;
+  // Category names, as in config.json. Empty means all categories.
+  std::vector<std::string> categories;
+
+  bool matches(const JournalEntry& entry) const;
+  bool empty() const { return !since && !until && categories.empty(); }
+};
+
+struct UndoOptions {
+  // Entries read from the journal per step. Bounds memory for huge journals.
+  size_t batch_size = 4096;
+  // Upper bound on the shared pool's I/O lane workers used by one run.
+  unsigned max_workers = std::max(1u, std::thread::hardware_concurrency());
+};
+
+struct UndoResult {
+  size_t undone = 0;
+  size_t failed = 0;
+  // Entries not selected by the filter; they stay in the journal.
+  size_t skipped = 0;
+};
+
+// Reverts journaled moves, newest first. The journal is streamed backwards
+// in batches. Within a batch, moves are levelled by the paths they touch:
+// moves sharing a path are reverted in reverse journal order, and moves on
+// the same level run in parallel. Moves between filesystems are copied back.
+// A deleted duplicate is restored by copying the kept file back, and a
+// hard-linked one gets its own copy again. Entries that were not reverted
+// are kept in the journal; it is removed once nothing is left.
+class UndoEngine {
+ public:
+  explicit UndoEngine(UndoOptions options = {});
+
+  UndoResult run(const fs::path& journalPath, const UndoFilter& filter = {},
+                 std::stop_token stoken = {}) const;
+
+ private:
+  UndoOptions m_options;
+};
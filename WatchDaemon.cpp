@@ -0,0 +1,339 @@
+#include "WatchDaemon.hpp"
+
+#include <array>
+#include <cstring>
+
+#include "AsciiCase.hpp"
+#include "IOManager.hpp"
+#include "utils.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Names browsers and download managers use while a transfer is in progress.
+// These are renamed to their final name on completion, which is reported as
+// a separate event.
+bool is_partial_download(const fs::path& path) {
+  static const AsciiCase::Set partial_extensions = {
+      ".part", ".crdownload", ".download", ".partial", ".tmp", ".opdownload"};
+  return partial_extensions.contains(safe_path_to_string(path.extension()));
+}
+
+#ifdef __linux__
+sigset_t stop_signals() {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  return signals;
+}
+
+class UniqueFd {
+ public:
+  explicit UniqueFd(int fd = -1) : m_fd(fd) {}
+  UniqueFd(const UniqueFd&) = delete;
+  UniqueFd& operator=(const UniqueFd&) = delete;
+  ~UniqueFd() {
+    if (m_fd >= 0) ::close(m_fd);
+  }
+  int get() const { return m_fd; }
+  explicit operator bool() const { return m_fd >= 0; }
+
+ private:
+  int m_fd;
+};
+
+// Opens a fanotify group reporting directory entry names for the target.
+int open_fanotify(const fs::path& targetDir) {
+#ifdef FAN_REPORT_DFID_NAME
+  int fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK |
+                             FAN_REPORT_DFID_NAME,
+                         O_RDONLY);
+  if (fd < 0) return -1;
+  const std::uint64_t mask = FAN_CLOSE_WRITE | FAN_CREATE | FAN_MOVED_TO |
+                             FAN_ONDIR | FAN_EVENT_ON_CHILD |
+                             FAN_DELETE_SELF | FAN_MOVE_SELF;
+  if (fanotify_mark(fd, FAN_MARK_ADD, mask, AT_FDCWD, targetDir.c_str()) !=
+      0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+#else
+  (void)targetDir;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+int open_inotify(const fs::path& targetDir) {
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) return -1;
+  const std::uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO |
+                             IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+  if (inotify_add_watch(fd, targetDir.c_str(), mask) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+struct ReadResult {
+  bool overflow = false;
+  bool target_gone = false;
+};
+
+ReadResult drain_inotify(int fd, std::unordered_set<std::string>& pending) {
+  ReadResult result;
+  alignas(inotify_event) std::array<char, 64 * 1024> buffer;
+  for (;;) {
+    const ssize_t len = ::read(fd, buffer.data(), buffer.size());
+    if (len <= 0) break;
+    for (const char* ptr = buffer.data(); ptr < buffer.data() + len;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+      if (event->mask & IN_Q_OVERFLOW) result.overflow = true;
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+        result.target_gone = true;
+      if (event->len > 0) pending.emplace(event->name);
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
+  return result;
+}
+
+ReadResult drain_fanotify(int fd, std::unordered_set<std::string>& pending) {
+  ReadResult result;
+#ifdef FAN_REPORT_DFID_NAME
+  alignas(fanotify_event_metadata) std::array<char, 64 * 1024> buffer;
+  for (;;) {
+    ssize_t len = ::read(fd, buffer.data(), buffer.size());
+    if (len <= 0) break;
+    auto* meta = reinterpret_cast<fanotify_event_metadata*>(buffer.data());
+    for (; FAN_EVENT_OK(meta, len); meta = FAN_EVENT_NEXT(meta, len)) {
+      if (meta->vers != FANOTIFY_METADATA_VERSION) {
+        result.overflow = true;
+        return result;
+      }
+      if (meta->mask & FAN_Q_OVERFLOW) result.overflow = true;
+      if (meta->mask & (FAN_DELETE_SELF | FAN_MOVE_SELF))
+        result.target_gone = true;
+      if (meta->fd >= 0) ::close(meta->fd);
+
+      const char* info_ptr = reinterpret_cast<const char*>(meta + 1);
+      const char* info_end = reinterpret_cast<const char*>(meta) +
+                             meta->event_len;
+      while (info_ptr < info_end) {
+        const auto* info =
+            reinterpret_cast<const fanotify_event_info_fid*>(info_ptr);
+        if (info->hdr.len == 0) break;
+        if (info->hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) {
+          const auto* handle =
+              reinterpret_cast<const file_handle*>(info->handle);
+          const char* name =
+              reinterpret_cast<const char*>(handle->f_handle) +
+              handle->handle_bytes;
+          if (std::strcmp(name, ".") != 0) pending.emplace(name);
+        }
+        info_ptr += info->hdr.len;
+      }
+    }
+  }
+#else
+  (void)fd;
+  (void)pending;
+#endif
+  return result;
+}
+#endif  // __linux__
+}  // namespace
+
+WatchDaemon::WatchDaemon(const RuleEngine& engine, fs::path targetDir,
+                         WatchOptions options)
+    : m_engine(engine),
+      m_targetDir(std::move(targetDir)),
+      m_options(std::move(options)) {}
+
+void WatchDaemon::block_stop_signals() {
+#ifdef __linux__
+  const sigset_t signals = stop_signals();
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+}
+
+bool WatchDaemon::run(std::stop_token stoken) {
+#ifndef __linux__
+  (void)stoken;
+  IOManager::log("Watch mode is only supported on Linux.");
+  return false;
+#else
+  bool using_fanotify = false;
+  int raw_watch_fd = -1;
+  if (m_options.use_fanotify) {
+    raw_watch_fd = open_fanotify(m_targetDir);
+    if (raw_watch_fd >= 0) {
+      using_fanotify = true;
+    } else {
+      IOManager::log(
+          std::format("fanotify unavailable ({}). Falling back to inotify.",
+                      std::strerror(errno)));
+    }
+  }
+  if (raw_watch_fd < 0) {
+    raw_watch_fd = open_inotify(m_targetDir);
+  }
+  if (raw_watch_fd < 0) {
+    IOManager::log(LogLevel::Error,
+                   std::format("CRITICAL: Could not watch '{}': {}",
+                               safe_path_to_string(m_targetDir),
+                               std::strerror(errno)));
+    return false;
+  }
+  UniqueFd watch_fd(raw_watch_fd);
+
+  // SIGINT/SIGTERM are consumed through a signalfd so that shutdown happens
+  // on this thread, between batches, rather than inside a signal handler.
+  // They are blocked process-wide by block_stop_signals().
+  const sigset_t signals = stop_signals();
+  UniqueFd signal_fd(signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC));
+
+  UniqueFd stop_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+  std::stop_callback wake_on_stop(stoken, [&stop_fd] {
+    const std::uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(stop_fd.get(), &one, sizeof(one));
+  });
+
+  IOManager::log(std::format(
+      "Watching '{}' with {} (debounce {} ms).",
+      safe_path_to_string(m_targetDir), using_fanotify ? "fanotify" : "inotify",
+      m_options.debounce.count()));
+
+  if (m_options.initial_scan) process_full_scan(stoken);
+
+  std::unordered_set<std::string> pending;
+  bool rescan_needed = false;
+  Clock::time_point first_event{};
+  Clock::time_point last_event{};
+  bool running = true;
+
+  while (running && !stoken.stop_requested()) {
+    int timeout_ms = -1;
+    if (!pending.empty() || rescan_needed) {
+      const auto deadline = std::min(last_event + m_options.debounce,
+                                     first_event + m_options.max_batch_delay);
+      timeout_ms = static_cast<int>(std::max<std::int64_t>(
+          0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                 deadline - Clock::now())
+                 .count()));
+    }
+
+    std::array<pollfd, 3> fds = {
+        pollfd{watch_fd.get(), POLLIN, 0}, pollfd{stop_fd.get(), POLLIN, 0},
+        pollfd{signal_fd.get(), POLLIN, 0}};
+    const int ready = ::poll(fds.data(), fds.size(), timeout_ms);
+    if (ready < 0) {
+      if (errno == EINTR) continue;
+      IOManager::log(
+          LogLevel::Error,
+          std::format("ERROR: poll failed: {}", std::strerror(errno)));
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) break;
+    if (fds[2].revents & POLLIN) {
+      // Consume it, so it is not left pending for the rest of the process.
+      signalfd_siginfo info{};
+      [[maybe_unused]] auto consumed =
+          ::read(signal_fd.get(), &info, sizeof(info));
+      IOManager::log(
+          std::format("{} received. Stopping watch.",
+                      info.ssi_signo == SIGINT ? "SIGINT" : "SIGTERM"));
+      break;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      const bool was_idle = pending.empty() && !rescan_needed;
+      const ReadResult result = using_fanotify
+                                    ? drain_fanotify(watch_fd.get(), pending)
+                                    : drain_inotify(watch_fd.get(), pending);
+      if (result.target_gone) {
+        IOManager::log(LogLevel::Error,
+                       "CRITICAL: Target directory was removed or moved.");
+        running = false;
+        continue;
+      }
+      if (result.overflow) {
+        IOManager::log("Event queue overflowed. A full rescan will follow.");
+        rescan_needed = true;
+      }
+      last_event = Clock::now();
+      if (was_idle) first_event = last_event;
+      continue;
+    }
+
+    if (rescan_needed) {
+      pending.clear();
+      rescan_needed = false;
+      process_full_scan(stoken);
+    } else if (!pending.empty()) {
+      process_batch(pending, stoken);
+      if (!pending.empty()) {
+        // Entries that were still being written were put back.
+        first_event = last_event = Clock::now();
+      }
+    }
+  }
+
+  IOManager::log("Watch stopped.");
+  return running;
+#endif
+}
+
+void WatchDaemon::process_batch(std::unordered_set<std::string>& pending,
+                                const std::stop_token& stoken) {
+  std::vector<fs::path> paths;
+  std::unordered_set<std::string> still_active;
+  const auto now = fs::file_time_type::clock::now();
+
+  for (const auto& name : pending) {
+    fs::path path = m_targetDir / name;
+    std::error_code ec;
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec || is_partial_download(path)) continue;
+    // Something may still be writing to it, or filling a new directory.
+    if (now - mtime < m_options.debounce) {
+      still_active.insert(name);
+      continue;
+    }
+    paths.push_back(std::move(path));
+  }
+  pending = std::move(still_active);
+
+  if (paths.empty()) return;
+  apply(m_engine.generate_plan_for_paths(paths, m_targetDir, stoken), stoken);
+}
+
+void WatchDaemon::process_full_scan(const std::stop_token& stoken) {
+  apply(m_engine.generate_plan(m_targetDir, stoken), stoken);
+}
+
+void WatchDaemon::apply(const std::vector<Action>& plan,
+                        const std::stop_token& stoken) {
+  if (plan.empty() || stoken.stop_requested()) return;
+
+  // Moves are appended to the journal as they land, so undo reverts
+  // everything the daemon has moved, across batches and restarts.
+  IOManager::apply_plan(plan, m_options.journal_path, stoken);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <stop_token>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "RuleEngine.hpp"
+
+struct WatchOptions {
+  // Quiet period after the last event before a batch is planned.
+  std::chrono::milliseconds debounce{2000};
+  // Upper bound on how long a batch may be deferred by a steady event stream.
+  std::chrono::milliseconds max_batch_delay{30000};
+  // Use fanotify instead of inotify. Requires CAP_SYS_ADMIN and Linux 5.9+;
+  // falls back to inotify if unavailable.
+  bool use_fanotify = false;
+  // Plan and apply everything already in the target before watching.
+  bool initial_scan = true;
+  fs::path journal_path = "organizer_journal.json";
+};
+
+// Headless mode that watches the target directory for new entries and
+// organizes them as they settle. Events are coalesced into batches, and only
+// the affected entries are classified. Linux only.
+class WatchDaemon {
+ public:
+  WatchDaemon(const RuleEngine& engine, fs::path targetDir,
+              WatchOptions options);
+
+  // Blocks SIGINT/SIGTERM in the calling thread and every thread it creates
+  // afterwards, so that run() receives them through a signalfd. Must be
+  // called before any other thread is started, or the kernel may deliver
+  // them to a thread that still has the default action.
+  static void block_stop_signals();
+
+  // Blocks until `stoken` is triggered or SIGINT/SIGTERM is received.
+  // Returns false if the watch could not be established.
+  bool run(std::stop_token stoken = {});
+
+ private:
+  void process_batch(std::unordered_set<std::string>& pending,
+                     const std::stop_token& stoken);
+  void process_full_scan(const std::stop_token& stoken);
+  void apply(const std::vector<Action>& plan, const std::stop_token& stoken);
+
+  const RuleEngine& m_engine;
+  const fs::path m_targetDir;
+  const WatchOptions m_options;
+};
@@ -0,0 +1,264 @@
+#include "WorkerPool.hpp"
+
+#include <deque>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <utility>
+
+#include "IOManager.hpp"
+
+struct alignas(64) WorkerPool::Worker {
+  std::mutex mutex;
+  std::deque<Task> tasks;
+};
+
+struct WorkerPool::Lane {
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::jthread> threads;
+  // Bumped whenever a task is queued or the pool stops. Idle workers wait
+  // on it.
+  std::atomic<std::uint64_t> epoch = 0;
+  std::atomic<unsigned> idle = 0;
+  // Round-robin target for tasks submitted from outside the lane.
+  std::atomic<size_t> next = 0;
+  std::atomic<size_t> queued = 0, peak_queued = 0, running = 0, completed = 0,
+                      stolen = 0;
+
+  void wake(bool all) {
+    epoch.fetch_add(1);
+    if (all) {
+      epoch.notify_all();
+    } else if (idle.load() > 0) {
+      epoch.notify_one();
+    }
+  }
+};
+
+namespace {
+// The pool and lane the current thread works for, if any.
+thread_local const WorkerPool* t_pool = nullptr;
+thread_local PoolLane t_lane = PoolLane::Cpu;
+thread_local size_t t_worker = 0;
+
+std::mutex g_shared_mutex;
+WorkerPoolOptions g_shared_options;
+bool g_shared_created = false;
+}  // namespace
+
+WorkerPool::WorkerPool(WorkerPoolOptions options)
+    : m_cpu(std::make_unique<Lane>()), m_io(std::make_unique<Lane>()) {
+  for (PoolLane id : {PoolLane::Cpu, PoolLane::Io}) {
+    Lane& l = lane(id);
+    const unsigned count = std::max(
+        1u, id == PoolLane::Cpu ? options.cpu_workers : options.io_workers);
+    for (unsigned i = 0; i < count; ++i) {
+      l.workers.push_back(std::make_unique<Worker>());
+    }
+    l.threads.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+      l.threads.emplace_back([this, id, i] { worker_loop(id, i); });
+    }
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  m_stopping = true;
+  // Workers only exit once their lane's deques are empty.
+  for (Lane* l : {m_cpu.get(), m_io.get()}) l->wake(true);
+  for (Lane* l : {m_cpu.get(), m_io.get()}) l->threads.clear();
+}
+
+WorkerPool& WorkerPool::shared() {
+  // Never destroyed, so that tasks still running at exit do not outlive the
+  // pool during static destruction.
+  static WorkerPool* pool = [] {
+    std::scoped_lock lock(g_shared_mutex);
+    g_shared_created = true;
+    return new WorkerPool(g_shared_options);
+  }();
+  return *pool;
+}
+
+void WorkerPool::configure(WorkerPoolOptions options) {
+  std::scoped_lock lock(g_shared_mutex);
+  if (g_shared_created) {
+    IOManager::log(LogLevel::Warning,
+                   "Worker pool already running; new size ignored.");
+    return;
+  }
+  g_shared_options = options;
+}
+
+WorkerPool::Lane& WorkerPool::lane(PoolLane id) const {
+  return id == PoolLane::Cpu ? *m_cpu : *m_io;
+}
+
+unsigned WorkerPool::workers(PoolLane id) const {
+  return static_cast<unsigned>(lane(id).workers.size());
+}
+
+void WorkerPool::submit(PoolLane id, Task task) {
+  Lane& l = lane(id);
+  const size_t target = t_pool == this && t_lane == id
+                            ? t_worker
+                            : l.next.fetch_add(1) % l.workers.size();
+  {
+    Worker& worker = *l.workers[target];
+    std::scoped_lock lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  const size_t depth = l.queued.fetch_add(1) + 1;
+  size_t peak = l.peak_queued.load();
+  while (depth > peak && !l.peak_queued.compare_exchange_weak(peak, depth)) {
+  }
+  l.wake(false);
+}
+
+std::future<void> WorkerPool::async(PoolLane id, Task task) {
+  std::packaged_task<void()> packaged(std::move(task));
+  auto future = packaged.get_future();
+  submit(id, std::move(packaged));
+  return future;
+}
+
+std::optional<WorkerPool::Task> WorkerPool::take(Lane& l, size_t self) {
+  {
+    Worker& own = *l.workers[self];
+    std::scoped_lock lock(own.mutex);
+    if (!own.tasks.empty()) {
+      Task task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return task;
+    }
+  }
+  const size_t count = l.workers.size();
+  for (size_t k = 1; k < count; ++k) {
+    Worker& victim = *l.workers[(self + k) % count];
+    std::scoped_lock lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      Task task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      l.stolen++;
+      return task;
+    }
+  }
+  return std::nullopt;
+}
+
+void WorkerPool::worker_loop(PoolLane id, size_t self) {
+  t_pool = this;
+  t_lane = id;
+  t_worker = self;
+  Lane& l = lane(id);
+  for (;;) {
+    const std::uint64_t seen = l.epoch.load();
+    std::optional<Task> task = take(l, self);
+    if (!task) {
+      if (m_stopping) return;
+      l.idle++;
+      l.epoch.wait(seen);
+      l.idle--;
+      continue;
+    }
+    l.queued--;
+    l.running++;
+    try {
+      (*task)();
+    } catch (const std::exception& e) {
+      IOManager::log(LogLevel::Error,
+                     std::format("Unhandled error in worker task: {}",
+                                 e.what()));
+    } catch (...) {
+      IOManager::log(LogLevel::Error, "Unhandled error in worker task.");
+    }
+    l.running--;
+    l.completed++;
+  }
+}
+
+// Shared between Helpers and its tasks, which keep it alive, since a task
+// may be dequeued after the owner returned.
+struct WorkerPool::Helpers::State {
+  static constexpr std::uint32_t kClosed = 1u << 31;
+
+  // Helpers inside the body, plus kClosed once the owner stops waiting for
+  // new ones.
+  std::atomic<std::uint32_t> state = 0;
+  std::atomic<unsigned> next_slot = 1;
+  std::function<void(unsigned)> body;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  bool joined = false;
+
+  void leave() {
+    state.fetch_sub(1);
+    state.notify_all();
+  }
+};
+
+WorkerPool::Helpers::Helpers(WorkerPool& pool, PoolLane lane, unsigned count,
+                             std::function<void(unsigned)> body)
+    : m_state(std::make_shared<State>()) {
+  m_state->body = std::move(body);
+  for (unsigned i = 0; i < count; ++i) {
+    pool.submit(lane, [state = m_state] {
+      if (state->state.fetch_add(1) & State::kClosed) {
+        state->leave();
+        return;
+      }
+      try {
+        state->body(state->next_slot.fetch_add(1));
+      } catch (...) {
+        std::scoped_lock lock(state->error_mutex);
+        if (!state->error) state->error = std::current_exception();
+      }
+      state->leave();
+    });
+  }
+}
+
+WorkerPool::Helpers::~Helpers() { wait(); }
+
+void WorkerPool::Helpers::wait() {
+  if (m_state->joined) return;
+  m_state->joined = true;
+  std::uint32_t state =
+      m_state->state.fetch_or(State::kClosed) | State::kClosed;
+  while (state != State::kClosed) {
+    m_state->state.wait(state);
+    state = m_state->state.load();
+  }
+}
+
+void WorkerPool::Helpers::join() {
+  wait();
+  std::scoped_lock lock(m_state->error_mutex);
+  if (auto error = std::exchange(m_state->error, nullptr)) {
+    std::rethrow_exception(error);
+  }
+}
+
+void WorkerPool::run_parallel(PoolLane id, unsigned width,
+                              const std::function<void(unsigned)>& body) {
+  width = std::min(width, workers(id) + 1);
+  if (width <= 1) {
+    body(0);
+    return;
+  }
+  Helpers helpers(*this, id, width - 1, body);
+  body(0);
+  helpers.join();
+}
+
+WorkerPoolStats WorkerPool::stats() const {
+  auto snapshot = [](const Lane& l) {
+    return WorkerPoolStats::Lane{static_cast<unsigned>(l.workers.size()),
+                                 l.queued.load(),
+                                 l.peak_queued.load(),
+                                 l.running.load(),
+                                 l.completed.load(),
+                                 l.stolen.load()};
+  };
+  return {snapshot(*m_cpu), snapshot(*m_io)};
+}
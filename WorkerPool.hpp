@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// CPU-bound work (classification, rule matching) and blocking filesystem work
+// (listing, reading, renaming) get separate workers, so that a slow disk
+// cannot occupy every core's thread and the other way around.
+enum class PoolLane : std::uint8_t { Cpu, Io };
+
+struct WorkerPoolOptions {
+  unsigned cpu_workers = std::max(1u, std::thread::hardware_concurrency());
+  // I/O workers mostly wait, so there are more of them than cores.
+  unsigned io_workers = std::max(4u, 2 * std::thread::hardware_concurrency());
+};
+
+struct WorkerPoolStats {
+  struct Lane {
+    unsigned workers = 0;
+    size_t queued = 0;
+    size_t peak_queued = 0;
+    size_t running = 0;
+    size_t completed = 0;
+    // Tasks a worker took from another worker's deque.
+    size_t stolen = 0;
+  };
+  Lane cpu;
+  Lane io;
+};
+
+// A persistent pool of worker threads, one lane per PoolLane. Each worker
+// owns a deque of tasks: it takes from the back of its own deque and steals
+// from the front of the others' in its lane when it runs dry. Tasks
+// submitted from a worker go to that worker's deque, so nested work stays
+// local until another worker is idle.
+//
+// Cancellation is cooperative: tasks check the stop tokens they were given.
+// The pool itself never abandons a task; its destructor finishes every
+// queued task before joining the workers.
+class WorkerPool {
+ public:
+  using Task = std::move_only_function<void()>;
+
+  explicit WorkerPool(WorkerPoolOptions options = {});
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // The pool the whole organizer submits to, created on first use and kept
+  // until the process exits.
+  static WorkerPool& shared();
+  // Sizes the shared pool. Only has an effect before its first use.
+  static void configure(WorkerPoolOptions options);
+
+  void submit(PoolLane lane, Task task);
+  // Like submit(); the future reports completion or the task's exception.
+  std::future<void> async(PoolLane lane, Task task);
+
+  // Runs `body(slot)` for slots 1 to `count` on lane workers while the owner
+  // does other work. Helpers take the first free workers and are never
+  // waited for: join() returns once every helper that started has returned,
+  // and the others are skipped. Joined on destruction.
+  class Helpers {
+   public:
+    Helpers(WorkerPool& pool, PoolLane lane, unsigned count,
+            std::function<void(unsigned slot)> body);
+    ~Helpers();
+    Helpers(const Helpers&) = delete;
+    Helpers& operator=(const Helpers&) = delete;
+
+    // Rethrows the first exception thrown by a helper.
+    void join();
+
+   private:
+    struct State;
+    void wait();
+
+    std::shared_ptr<State> m_state;
+  };
+
+  // Calls `body(slot)` on up to `width` threads at once: the caller as slot
+  // 0 and lane workers as they become free as slots 1 and up. Returns when
+  // the caller's call and every helper that started have returned. Helpers
+  // that have not started by then are skipped, so the slots must share their
+  // work, e.g. by claiming items from a common counter, and never wait for a
+  // slot that may not run. Rethrows the first exception thrown by a slot.
+  void run_parallel(PoolLane lane, unsigned width,
+                    const std::function<void(unsigned slot)>& body);
+
+  // Calls `fn(i)` for every i in [0, count) on up to `width` threads (0: the
+  // lane's workers plus the caller). Once `stoken` is triggered no further
+  // indices are handed out.
+  template <typename F>
+  void for_each_index(PoolLane lane, size_t count, F&& fn,
+                      std::stop_token stoken = {}, unsigned width = 0) {
+    if (count == 0) return;
+    if (width == 0) width = workers(lane) + 1;
+    std::atomic<size_t> next = 0;
+    run_parallel(lane, static_cast<unsigned>(std::min<size_t>(width, count)),
+                 [&](unsigned) {
+                   for (size_t i; !stoken.stop_requested() &&
+                                  (i = next.fetch_add(1)) < count;) {
+                     fn(i);
+                   }
+                 });
+  }
+
+  unsigned workers(PoolLane lane) const;
+  WorkerPoolStats stats() const;
+
+ private:
+  struct Worker;
+  struct Lane;
+
+  Lane& lane(PoolLane lane) const;
+  void worker_loop(PoolLane lane, size_t self);
+  std::optional<Task> take(Lane& lane, size_t self);
+
+  std::unique_ptr<Lane> m_cpu;
+  std::unique_ptr<Lane> m_io;
+  std::atomic<bool> m_stopping = false;
+};
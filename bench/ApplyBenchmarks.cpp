@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <format>
+#include <fstream>
+
+#include "Journal.hpp"
+#include "UndoEngine.hpp"
+
+namespace {
+const fs::path& journal_dir() {
+  static const fs::path dir = [] {
+    fs::path path = fs::temp_directory_path() / "organizer_bench" / "journal";
+    fs::create_directories(path);
+    return path;
+  }();
+  return dir;
+}
+
+JournalEntry make_entry(const fs::path& from_dir, const fs::path& to_dir,
+                        int64_t i) {
+  const std::string name = std::format("file_{:07}.pdf", i);
+  return {ActionType::MOVE, from_dir / name, to_dir / name, "Documents",
+          1700000000000 + i};
+}
+
+// Appending one entry per completed move, as apply_plan does.
+void BM_JournalAppend(benchmark::State& state) {
+  const fs::path path = journal_dir() / "append.jsonl";
+  const fs::path from = "/downloads";
+  const fs::path to = "/downloads/Documents";
+  for (auto _ : state) {
+    state.PauseTiming();
+    fs::remove(path);
+    state.ResumeTiming();
+    auto writer = Journal::Writer::open(path);
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      writer->append(make_entry(from, to, i));
+    }
+    writer.reset();  // Includes the final sync.
+  }
+  fs::remove(path);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_JournalAppend)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Reverting N real moves. Setting up a run means creating N files, so the
+// largest size is 100k rather than 1M.
+void BM_Undo(benchmark::State& state) {
+  const fs::path root = journal_dir() / "undo";
+  const fs::path from = root / "downloads";
+  const fs::path to = from / "Documents";
+  const fs::path path = root / "journal.jsonl";
+  for (auto _ : state) {
+    state.PauseTiming();
+    fs::remove_all(root);
+    fs::create_directories(to);
+    {
+      auto writer = Journal::Writer::open(path);
+      for (int64_t i = 0; i < state.range(0); ++i) {
+        const JournalEntry entry = make_entry(from, to, i);
+        std::ofstream(entry.to) << "moved";
+        writer->append(entry);
+      }
+    }
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(UndoEngine().run(path));
+  }
+  fs::remove_all(root);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Undo)
+    ->RangeMultiplier(10)
+    ->Range(1000, 100000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->Iterations(3);
+}  // namespace
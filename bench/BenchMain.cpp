@@ -0,0 +1,14 @@
+#include <benchmark/benchmark.h>
+
+#include "IOManager.hpp"
+
+int main(int argc, char** argv) {
+  // Per-move log lines would otherwise dominate the measurements.
+  IOManager::set_log_level(LogLevel::Warning);
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  IOManager::flush_log();
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+#include "ExifReader.hpp"
+#include "IOManager.hpp"
+#include "NameIndex.hpp"
+#include "RuleEngine.hpp"
+#include "SyntheticTree.hpp"
+#include "utils.hpp"
+
+namespace {
+const fs::path& bench_dir() {
+  static const fs::path dir = fs::temp_directory_path() / "organizer_bench";
+  return dir;
+}
+
+const Config& bench_config() {
+  static const Config config =
+      *IOManager::load_config(write_benchmark_config(bench_dir()));
+  return config;
+}
+
+const char* kind_name(SyntheticEntryKind kind) {
+  switch (kind) {
+    case SyntheticEntryKind::File:
+      return "file";
+    case SyntheticEntryKind::ExifImage:
+      return "exif_image";
+    case SyntheticEntryKind::ProjectFolder:
+      return "project_folder";
+    case SyntheticEntryKind::WrappedFolder:
+      return "wrapped_folder";
+  }
+  return "unknown";
+}
+
+// Entry counts from 1k to 1M; trees are generated once and reused.
+void tree_sizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+}
+
+// Full scan without any persistent state.
+void BM_GeneratePlan(benchmark::State& state) {
+  const auto& tree = cached_synthetic_tree(static_cast<size_t>(state.range(0)));
+  RuleEngine engine(bench_config());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(engine.generate_plan(tree.root));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GeneratePlan)->Apply(tree_sizes)->UseRealTime();
+
+// Rescan of an unchanged tree, served by the scan index and EXIF cache.
+void BM_GeneratePlanWarm(benchmark::State& state) {
+  const auto& tree = cached_synthetic_tree(static_cast<size_t>(state.range(0)));
+  const fs::path state_dir = bench_dir() / std::format("state_{}",
+                                                       state.range(0));
+  fs::create_directories(state_dir);
+  RuleEngineOptions options;
+  options.scan_index_path = state_dir / "scan_index.bin";
+  options.exif_cache_path = state_dir / "exif_cache.bin";
+  RuleEngine engine(bench_config(), options);
+  engine.generate_plan(tree.root);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(engine.generate_plan(tree.root));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GeneratePlanWarm)->Apply(tree_sizes)->UseRealTime();
+
+// Planning of a single top-level entry of each kind, which is the work done
+// per entry by classify_path and plan_entry.
+void BM_PlanEntry(benchmark::State& state, SyntheticEntryKind kind,
+                  bool exif_cache) {
+  const auto& tree = cached_synthetic_tree(1000);
+  auto sample = std::ranges::find_if(
+      tree.samples, [kind](const auto& entry) { return entry.first == kind; });
+  if (sample == tree.samples.end()) {
+    state.SkipWithError("the tree has no entry of this kind");
+    return;
+  }
+  RuleEngineOptions options;
+  if (exif_cache) options.exif_cache_path = bench_dir() / "entry_exif.bin";
+  RuleEngine engine(bench_config(), options);
+  const std::vector<fs::path> paths = {sample->second};
+  state.SetLabel(kind_name(kind));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(engine.generate_plan_for_paths(paths, tree.root));
+  }
+}
+BENCHMARK_CAPTURE(BM_PlanEntry, file, SyntheticEntryKind::File, false);
+BENCHMARK_CAPTURE(BM_PlanEntry, exif_image, SyntheticEntryKind::ExifImage,
+                  false);
+BENCHMARK_CAPTURE(BM_PlanEntry, exif_image_cached,
+                  SyntheticEntryKind::ExifImage, true);
+BENCHMARK_CAPTURE(BM_PlanEntry, project_folder,
+                  SyntheticEntryKind::ProjectFolder, false);
+BENCHMARK_CAPTURE(BM_PlanEntry, wrapped_folder,
+                  SyntheticEntryKind::WrappedFolder, false);
+
+// The EXIF lookup behind get_exif_date, without any cache.
+void BM_ReadExifDate(benchmark::State& state) {
+  const fs::path path = bench_dir() / "exif_date.jpg";
+  fs::create_directories(bench_dir());
+  const std::string bytes = make_exif_jpeg("2021:07:04 09:30:00");
+  std::ofstream(path, std::ios::binary)
+      .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ExifReader::read_date_time_original(path));
+  }
+}
+BENCHMARK(BM_ReadExifDate);
+
+// Fills a directory with "report.pdf", "report (1).pdf", ... so that the
+// next free name is `collisions` probes away.
+fs::path make_collisions(int64_t collisions) {
+  const fs::path dir = bench_dir() / std::format("collisions_{}", collisions);
+  if (fs::exists(dir / std::format("report ({}).pdf", collisions - 1))) {
+    return dir;
+  }
+  fs::create_directories(dir);
+  std::ofstream(dir / "report.pdf");
+  for (int64_t i = 1; i < collisions; ++i) {
+    std::ofstream(dir / std::format("report ({}).pdf", i));
+  }
+  return dir;
+}
+
+// The fs::exists probe loop that picked destination names before
+// DirectoryNameIndex, kept here as the reference the index is measured
+// against.
+fs::path generate_unique_path(const fs::path& target_path) {
+  if (!fs::exists(target_path)) {
+    return target_path;
+  }
+
+  const fs::path parent_dir = target_path.parent_path();
+  const std::string stem_str = safe_path_to_string(target_path.stem());
+  const fs::path ext = target_path.extension();
+
+  int counter = 1;
+  fs::path new_path;
+  do {
+    const std::string new_filename_str =
+        std::format("{} ({}){}", stem_str, counter++, safe_path_to_string(ext));
+    new_path = parent_dir / path_from_utf8(new_filename_str);
+  } while (fs::exists(new_path));
+
+  return new_path;
+}
+
+void BM_GenerateUniquePath(benchmark::State& state) {
+  const fs::path dir = make_collisions(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(generate_unique_path(dir / "report.pdf"));
+  }
+}
+BENCHMARK(BM_GenerateUniquePath)->RangeMultiplier(10)->Range(10, 10000);
+
+// The same lookup as done by MoveExecutor, including building the index.
+void BM_NameIndexClaim(benchmark::State& state) {
+  const fs::path dir = make_collisions(state.range(0));
+  for (auto _ : state) {
+    DirectoryNameIndex names(dir);
+    benchmark::DoNotOptimize(names.claim("report.pdf"));
+  }
+}
+BENCHMARK(BM_NameIndexClaim)->RangeMultiplier(10)->Range(10, 10000);
+
+void BM_LoadConfig(benchmark::State& state) {
+  const fs::path path = write_benchmark_config(
+      bench_dir(), static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(IOManager::load_config(path));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadConfig)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMillisecond);
+}  // namespace
@@ -0,0 +1,227 @@
+#include "SyntheticTree.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "utils.hpp"
+
+namespace {
+void write_file(const fs::path& path, std::string_view contents) {
+  std::ofstream(path, std::ios::binary)
+      .write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+// A stamp describing the spec, so that a stale tree is never reused.
+std::string spec_stamp(const SyntheticTreeSpec& spec) {
+  std::string stamp = std::format(
+      "v1 {} {} {} {} {} {}", spec.entries, spec.project_folder_ratio,
+      spec.wrapped_folder_ratio, spec.exif_image_ratio, spec.project_depth,
+      spec.seed);
+  for (const auto& [ext, weight] : spec.extension_mix) {
+    stamp += std::format(" {}:{}", ext, weight);
+  }
+  return stamp;
+}
+}  // namespace
+
+std::string make_exif_jpeg(const std::string& date) {
+  std::string tiff;
+  auto u16 = [&](std::uint16_t v) {
+    tiff.push_back(static_cast<char>(v & 0xFF));
+    tiff.push_back(static_cast<char>(v >> 8));
+  };
+  auto u32 = [&](std::uint32_t v) {
+    u16(static_cast<std::uint16_t>(v & 0xFFFF));
+    u16(static_cast<std::uint16_t>(v >> 16));
+  };
+  // Little-endian TIFF: IFD0 points to an Exif IFD holding DateTimeOriginal.
+  tiff += "II";
+  u16(42);
+  u32(8);
+  u16(1);
+  u16(0x8769);
+  u16(4);
+  u32(1);
+  u32(26);
+  u32(0);
+  u16(1);
+  u16(0x9003);
+  u16(2);
+  u32(static_cast<std::uint32_t>(date.size() + 1));
+  u32(44);
+  u32(0);
+  tiff += date;
+  tiff.push_back('\0');
+
+  std::string jpeg = "\xFF\xD8\xFF\xE1";
+  const size_t length = 2 + 6 + tiff.size();
+  jpeg.push_back(static_cast<char>(length >> 8));
+  jpeg.push_back(static_cast<char>(length & 0xFF));
+  jpeg.append("Exif\0\0", 6);
+  jpeg += tiff;
+  jpeg += "\xFF\xDA\x00\x02\xFF\xD9";
+  return jpeg;
+}
+
+SyntheticTree make_synthetic_tree(const fs::path& root,
+                                  const SyntheticTreeSpec& spec) {
+  SyntheticTree tree{root, {}};
+  const fs::path stamp_path = root / ".synthetic_tree";
+  const std::string stamp = spec_stamp(spec);
+
+  std::mt19937 rng(spec.seed);
+  std::uniform_real_distribution<double> kind_dist(0.0, 1.0);
+  std::vector<unsigned> weights;
+  for (const auto& entry : spec.extension_mix) weights.push_back(entry.second);
+  std::discrete_distribution<size_t> ext_dist(weights.begin(), weights.end());
+  std::uniform_int_distribution<int> year_dist(2005, 2024);
+
+  bool reuse = false;
+  {
+    std::ifstream in(stamp_path);
+    std::string existing;
+    reuse = std::getline(in, existing) && existing == stamp;
+  }
+  if (!reuse) {
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+  }
+
+  for (size_t i = 0; i < spec.entries; ++i) {
+    const double roll = kind_dist(rng);
+    double edge = spec.project_folder_ratio;
+    SyntheticEntryKind kind = SyntheticEntryKind::File;
+    if (roll < edge) {
+      kind = SyntheticEntryKind::ProjectFolder;
+    } else if (roll < (edge += spec.wrapped_folder_ratio)) {
+      kind = SyntheticEntryKind::WrappedFolder;
+    } else if (roll < (edge += spec.exif_image_ratio)) {
+      kind = SyntheticEntryKind::ExifImage;
+    }
+    // Drawn for every entry, so that the sequence does not depend on `kind`.
+    const std::string& ext = spec.extension_mix[ext_dist(rng)].first;
+    const int year = year_dist(rng);
+
+    fs::path path;
+    switch (kind) {
+      case SyntheticEntryKind::File:
+        path = root / std::format("file_{:07}{}", i, ext);
+        if (!reuse) write_file(path, "synthetic");
+        break;
+      case SyntheticEntryKind::ExifImage:
+        path = root / std::format("IMG_{:07}.jpg", i);
+        if (!reuse) {
+          write_file(path, make_exif_jpeg(std::format("{}:06:15 12:00:00",
+                                                      year)));
+        }
+        break;
+      case SyntheticEntryKind::ProjectFolder: {
+        path = root / std::format("project_{:07}", i);
+        if (!reuse) {
+          fs::path dir = path;
+          for (unsigned d = 0; d < spec.project_depth; ++d) {
+            fs::create_directories(dir);
+            write_file(dir / std::format("module_{}.js", d), "export {};");
+            dir /= "src";
+          }
+          write_file(path / "package.json", "{}");
+        }
+        break;
+      }
+      case SyntheticEntryKind::WrappedFolder:
+        path = root / std::format("download_{:07}", i);
+        if (!reuse) {
+          fs::create_directories(path / "inner");
+          for (int f = 0; f < 4; ++f) {
+            write_file(path / "inner" / std::format("page_{}.pdf", f), "pdf");
+          }
+        }
+        break;
+    }
+
+    const bool have_sample =
+        std::ranges::any_of(tree.samples, [kind](const auto& sample) {
+          return sample.first == kind;
+        });
+    if (!have_sample) tree.samples.emplace_back(kind, path);
+  }
+
+  if (!reuse) std::ofstream(stamp_path) << stamp << '\n';
+  return tree;
+}
+
+const SyntheticTree& cached_synthetic_tree(size_t entries) {
+  static std::map<size_t, SyntheticTree> trees;
+  auto it = trees.find(entries);
+  if (it == trees.end()) {
+    SyntheticTreeSpec spec;
+    spec.entries = entries;
+    const fs::path root = fs::temp_directory_path() / "organizer_bench" /
+                          std::format("tree_{}", entries);
+    it = trees.emplace(entries, make_synthetic_tree(root, spec)).first;
+  }
+  return it->second;
+}
+
+fs::path write_benchmark_config(const fs::path& directory,
+                                size_t extra_extensions) {
+  json categories = {
+      {"Images", {".jpg", ".jpeg", ".png", ".gif", ".bmp", ".svg", ".webp"}},
+      {"Documents",
+       {".pdf", ".doc", ".docx", ".xls", ".xlsx", ".ppt", ".pptx", ".txt",
+        ".md"}},
+      {"Archives", {".zip", ".rar", ".7z", ".tar", ".gz"}},
+      {"Disk Images", {".iso", ".img", ".vhd", ".vmdk"}},
+      {"Audio", {".mp3", ".wav", ".flac", ".ogg"}},
+      {"Video", {".mp4", ".mkv", ".avi", ".mov", ".webm"}},
+      {"Executables", {".exe", ".msi", ".dmg", ".deb", ".msix", ".dll"}},
+      {"Fonts", {".ttf", ".otf", ".woff", ".woff2"}},
+      {"Projects", {".html", ".css", ".js", ".ts", ".json", ".py", ".cpp"}}};
+  json extra = json::array();
+  for (size_t i = 0; i < extra_extensions; ++i) {
+    extra.push_back(std::format(".x{}", i));
+  }
+  if (!extra.empty()) categories["Generated"] = extra;
+
+  json rules = json::array({
+      {{"category", "Photos/{exif_year}"},
+       {"priority", 0},
+       {"conditions",
+        {{{"type", "exif_date_matches"}, {"values", {"****:**:**"}}}}}},
+      {{"category", "Executables"},
+       {"priority", 1},
+       {"conditions",
+        {{{"type", "contains_filename_pattern"},
+          {"values", {"setup.exe", "install.exe"}}}}}},
+      {{"category", "Projects"},
+       {"priority", 2},
+       {"conditions",
+        {{{"type", "contains_filename"},
+          {"values", {"package.json", "Makefile", "index.html"}}}}}},
+      {{"category", "Projects"},
+       {"priority", 3},
+       {"conditions",
+        {{{"type", "file_category_percentage"},
+          {"values", {"Projects"}},
+          {"threshold", 0.5}}}}},
+      {{"category", "Images"},
+       {"priority", 4},
+       {"conditions",
+        {{{"type", "has_no_subdirectories"}},
+         {{"type", "file_category_percentage"},
+          {"values", {"Images"}},
+          {"threshold", 0.8}}}}},
+  });
+
+  fs::create_directories(directory);
+  const fs::path path =
+      directory / std::format("config_{}.json", extra_extensions);
+  std::ofstream(path) << json{{"categories", categories}, {"rules", rules}}
+                                 .dump(2);
+  return path;
+}
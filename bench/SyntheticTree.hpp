@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+// Shape of a generated Downloads folder. The same spec always produces the
+// same tree.
+struct SyntheticTreeSpec {
+  // Top-level entries (files and folders) in the tree.
+  size_t entries = 1000;
+  // Extensions of plain files, with relative weights.
+  std::vector<std::pair<std::string, unsigned>> extension_mix = {
+      {".pdf", 12}, {".jpg", 10}, {".png", 6},  {".zip", 8}, {".mp4", 4},
+      {".mp3", 4},  {".docx", 6}, {".exe", 3},  {".iso", 1}, {".txt", 6},
+      {".json", 2}, {".ttf", 1},  {".xyz", 2},  {"", 1}};
+  // Fractions of entries that are not plain files.
+  double project_folder_ratio = 0.02;  // Source trees with a package.json.
+  double wrapped_folder_ratio = 0.01;  // A folder holding only one folder.
+  double exif_image_ratio = 0.05;      // JPEGs with a DateTimeOriginal.
+  // Nesting depth of the files inside project folders.
+  unsigned project_depth = 3;
+  std::uint32_t seed = 1;
+};
+
+enum class SyntheticEntryKind { File, ExifImage, ProjectFolder, WrappedFolder };
+
+struct SyntheticTree {
+  fs::path root;
+  // One example path per entry kind, for per-entry benchmarks.
+  std::vector<std::pair<SyntheticEntryKind, fs::path>> samples;
+};
+
+// Creates the tree under `root`. An existing tree made from the same spec is
+// reused, since large trees take far longer to write than to scan.
+SyntheticTree make_synthetic_tree(const fs::path& root,
+                                  const SyntheticTreeSpec& spec);
+
+// A tree of `entries` top-level entries under the system temp directory.
+const SyntheticTree& cached_synthetic_tree(size_t entries);
+
+// Writes a config.json like the shipped one, plus an EXIF rule and
+// `extra_extensions` made-up extensions, and returns its path.
+fs::path write_benchmark_config(const fs::path& directory,
+                                size_t extra_extensions = 0);
+
+// Bytes of a minimal JPEG whose EXIF DateTimeOriginal is `date`.
+std::string make_exif_jpeg(const std::string& date);
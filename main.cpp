@@ -1,16 +1,48 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
 #include <exception>
 #include <exiv2/exiv2.hpp>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <print>
+#include <sstream>
 #include <vector>
 
+#include "CrossDevice.hpp"
+#include "Deduplicator.hpp"
 #include "IOManager.hpp"
+#include "RootScheduler.hpp"
 #include "UI.hpp"
+#include "WatchDaemon.hpp"
+#include "WorkerPool.hpp"
 #include "types.hpp"
+#include "utils.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
+// Process exit codes, for scripts and schedulers.
+enum ExitCode : int {
+  kExitOk = 0,
+  // Startup failed (configuration, target folder) or an exception escaped.
+  kExitError = 1,
+  kExitUsage = 2,
+  // The run completed, but some moves could not be performed or undone.
+  kExitPartial = 3,
+};
+
+constexpr const char* kJournalPath = "organizer_journal.json";
+
 void pause_console() {
 #ifdef _WIN32
   std::println("Press any key to exit...");
@@ -21,114 +53,526 @@ void pause_console() {
 #endif
 }
 
-int main(int argc, char* argv[]) {
-  Exiv2::XmpParser::initialize();
+bool stdin_is_terminal() {
+#ifdef _WIN32
+  return ::_isatty(::_fileno(stdin));
+#else
+  return ::isatty(STDIN_FILENO);
+#endif
+}
 
-  try {
-    IOManager::initialize_logger();
-    IOManager::log("--- Organizer v2.0 Started ---");
+enum class Mode { Interactive, Watch, Undo, DryRun, Apply };
+
+struct CommandLine {
+  Mode mode = Mode::Interactive;
+  std::optional<fs::path> config_path;
+  std::optional<fs::path> target_dir;
+  WatchOptions watch_options;
+  UndoFilter undo_filter;
+  TreeWalkOptions walk_options;
+  DedupeOptions dedupe_options;
+  WorkerPoolOptions pool_options;
+  CrossDevice::Options copy_options;
+  // A multi-root run organizes every folder listed in this file instead of
+  // one target.
+  std::optional<fs::path> roots_path;
+  unsigned parallel_roots = 4;
+
+  // Only the TUI may wait for the user; every other mode must be safe to
+  // run from cron or a script.
+  bool interactive() const {
+    return mode == Mode::Interactive && stdin_is_terminal();
+  }
+};
+
+// Parses "YYYY-MM-DD" or "YYYY-MM-DDTHH:MM:SS" as local time.
+std::optional<std::chrono::system_clock::time_point> parse_local_time(
+    std::string_view text) {
+  std::tm tm{};
+  std::istringstream in{std::string(text)};
+  in >> std::get_time(&tm, text.size() > 10 ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d");
+  if (in.fail()) return std::nullopt;
+  tm.tm_isdst = -1;
+  const std::time_t t = std::mktime(&tm);
+  if (t == -1) return std::nullopt;
+  return std::chrono::system_clock::from_time_t(t);
+}
+
+void log_pool_stats() {
+  const WorkerPoolStats stats = WorkerPool::shared().stats();
+  for (const auto& [name, lane] :
+       {std::pair{"CPU", stats.cpu}, std::pair{"I/O", stats.io}}) {
+    IOManager::log(std::format(
+        "{} lane: {} workers, {} tasks run, {} stolen, peak queue depth {}.",
+        name, lane.workers, lane.completed, lane.stolen, lane.peak_queued));
+  }
+}
+
+void print_usage() {
+  std::println(stderr,
+               "Usage: organizer [--config FILE] [--target DIR] [SCAN] [MODE]\n"
+               "       organizer --roots FILE [--parallel-roots N] [SCAN] "
+               "--dry-run|--apply|--undo\n"
+               "Scan options:\n"
+               "  --recursive      plan the files in subfolders one by one\n"
+               "  --max-depth N    like --recursive, down to N folder levels\n"
+               "  --exclude GLOB   skip matching entries (repeatable)\n"
+               "  --dedupe POLICY  skip|delete|hardlink|reflink duplicates\n"
+               "  --cpu-threads N  worker threads for classification\n"
+               "  --io-threads N   worker threads for disk access\n"
+               "  --verify-copies  check files moved across filesystems\n"
+               "Modes (default: interactive TUI):\n"
+               "  --dry-run    print the plan as JSON Lines and exit\n"
+               "  --apply      apply the plan without the TUI\n"
+               "  --watch [--debounce-ms N] [--fanotify] [--no-initial-scan]\n"
+               "  --undo [--category NAME]... [--since DATE] [--until DATE]");
+}
+
+// Parses the command line. Returns std::nullopt on bad input.
+std::optional<CommandLine> parse_command_line(int argc, char* argv[]) {
+  CommandLine cmd;
+  auto set_mode = [&](Mode mode) {
+    if (cmd.mode != Mode::Interactive && cmd.mode != mode) {
+      std::println(stderr, "Only one of --dry-run, --apply, --watch and "
+                           "--undo may be given.");
+      return false;
+    }
+    cmd.mode = mode;
+    return true;
+  };
 
-    fs::path exePath;
-    if (argc > 0) {
-      exePath = fs::path(argv[0]).parent_path();
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool ok = true;
+    if (arg == "--watch") {
+      ok = set_mode(Mode::Watch);
+    } else if (arg == "--undo") {
+      ok = set_mode(Mode::Undo);
+    } else if (arg == "--dry-run") {
+      ok = set_mode(Mode::DryRun);
+    } else if (arg == "--apply") {
+      ok = set_mode(Mode::Apply);
+    } else if (arg == "--config" && i + 1 < argc) {
+      cmd.config_path = argv[++i];
+    } else if (arg == "--target" && i + 1 < argc) {
+      cmd.target_dir = argv[++i];
+    } else if (arg == "--roots" && i + 1 < argc) {
+      cmd.roots_path = argv[++i];
+    } else if (arg == "--parallel-roots" && i + 1 < argc) {
+      try {
+        cmd.parallel_roots = static_cast<unsigned>(std::stoul(argv[++i]));
+      } catch (const std::exception&) {
+        cmd.parallel_roots = 0;
+      }
+      if (cmd.parallel_roots == 0) {
+        std::println(stderr, "Invalid value for --parallel-roots: {}", argv[i]);
+        return std::nullopt;
+      }
+    } else if (arg == "--recursive") {
+      cmd.walk_options.max_depth = TreeWalkOptions::kUnlimitedDepth;
+    } else if (arg == "--max-depth" && i + 1 < argc) {
+      try {
+        cmd.walk_options.max_depth =
+            static_cast<unsigned>(std::stoul(argv[++i]));
+      } catch (const std::exception&) {
+        std::println(stderr, "Invalid value for --max-depth: {}", argv[i]);
+        return std::nullopt;
+      }
+    } else if (arg == "--exclude" && i + 1 < argc) {
+      cmd.walk_options.exclude.emplace_back(argv[++i]);
+    } else if (arg == "--dedupe" && i + 1 < argc) {
+      auto policy = parse_dedupe_policy(argv[++i]);
+      if (!policy) {
+        std::println(stderr, "Invalid value for --dedupe: {}", argv[i]);
+        return std::nullopt;
+      }
+      cmd.dedupe_options.policy = *policy;
+    } else if ((arg == "--cpu-threads" || arg == "--io-threads") &&
+               i + 1 < argc) {
+      unsigned& workers = arg == "--cpu-threads"
+                              ? cmd.pool_options.cpu_workers
+                              : cmd.pool_options.io_workers;
+      try {
+        workers = static_cast<unsigned>(std::stoul(argv[++i]));
+      } catch (const std::exception&) {
+        workers = 0;
+      }
+      if (workers == 0) {
+        std::println(stderr, "Invalid value for {}: {}", arg, argv[i]);
+        return std::nullopt;
+      }
+    } else if (arg == "--verify-copies") {
+      cmd.copy_options.verify = true;
+    } else if (arg == "--fanotify") {
+      cmd.watch_options.use_fanotify = true;
+    } else if (arg == "--no-initial-scan") {
+      cmd.watch_options.initial_scan = false;
+    } else if (arg == "--debounce-ms" && i + 1 < argc) {
+      try {
+        cmd.watch_options.debounce = std::chrono::milliseconds(
+            std::stoll(argv[++i]));
+      } catch (const std::exception&) {
+        std::println(stderr, "Invalid value for --debounce-ms: {}", argv[i]);
+        return std::nullopt;
+      }
+    } else if (arg == "--category" && i + 1 < argc) {
+      cmd.undo_filter.categories.emplace_back(argv[++i]);
+    } else if ((arg == "--since" || arg == "--until") && i + 1 < argc) {
+      auto time = parse_local_time(argv[++i]);
+      if (!time) {
+        std::println(stderr, "Invalid value for {}: {}", arg, argv[i]);
+        return std::nullopt;
+      }
+      (arg == "--since" ? cmd.undo_filter.since : cmd.undo_filter.until) =
+          time;
     } else {
-      exePath = fs::current_path();
+      std::println(stderr, "Unknown argument: {}", arg);
+      ok = false;
+    }
+    if (!ok) {
+      print_usage();
+      return std::nullopt;
     }
+  }
+  if (cmd.roots_path && (cmd.target_dir || cmd.mode == Mode::Watch ||
+                         cmd.mode == Mode::Interactive)) {
+    std::println(stderr, "--roots needs one of --dry-run, --apply and --undo, "
+                         "and no --target.");
+    return std::nullopt;
+  }
+  return cmd;
+}
 
-    if (exePath.empty()) {
-      exePath = fs::current_path();
+// Reports a fatal error on stderr. Only an interactive session waits for a
+// key press, so that scheduled runs never block.
+int report_fatal(const CommandLine& cmd, std::string_view headline,
+                 std::string_view details) {
+  std::println(stderr, "\n=== {} ===", headline);
+  std::println(stderr, "{}", details);
+  std::println(stderr, "Check organizer.log for details.");
+  if (cmd.interactive()) pause_console();
+  Exiv2::XmpParser::terminate();
+  return kExitError;
+}
+
+std::optional<Config> find_config(const CommandLine& cmd, int argc,
+                                  char* argv[], std::string& error) {
+  if (cmd.config_path) {
+    auto config = IOManager::load_config(*cmd.config_path);
+    if (!config) {
+      error = std::format("Failed to load config file: {}",
+                          cmd.config_path->string());
+    } else {
+      IOManager::log(std::format("Configuration loaded successfully from: {}",
+                                 cmd.config_path->string()));
     }
+    return config;
+  }
 
-    IOManager::log(std::format("Executable directory: {}", exePath.string()));
-    IOManager::log(std::format("Current working directory: {}",
-                               fs::current_path().string()));
+  fs::path exePath;
+  if (argc > 0) {
+    exePath = fs::path(argv[0]).parent_path();
+  } else {
+    exePath = fs::current_path();
+  }
+
+  if (exePath.empty()) {
+    exePath = fs::current_path();
+  }
 
-    std::vector<fs::path> configPaths = {exePath / "config.json",
-                                         fs::current_path() / "config.json",
-                                         exePath.parent_path() / "config.json"};
+  IOManager::log(std::format("Executable directory: {}", exePath.string()));
+  IOManager::log(std::format("Current working directory: {}",
+                             fs::current_path().string()));
 
-    std::optional<Config> configOpt;
-    fs::path usedConfigPath;
+  std::vector<fs::path> configPaths = {exePath / "config.json",
+                                       fs::current_path() / "config.json",
+                                       exePath.parent_path() / "config.json"};
 
-    for (const auto& configPath : configPaths) {
+  for (const auto& configPath : configPaths) {
+    IOManager::log(std::format("Trying config path: {}", configPath.string()));
+    if (fs::exists(configPath)) {
       IOManager::log(
-          std::format("Trying config path: {}", configPath.string()));
-      if (fs::exists(configPath)) {
-        IOManager::log(
-            std::format("Found config.json at: {}", configPath.string()));
-        configOpt = IOManager::load_config(configPath);
-        if (configOpt) {
-          usedConfigPath = configPath;
-          break;
-        }
+          std::format("Found config.json at: {}", configPath.string()));
+      if (auto config = IOManager::load_config(configPath)) {
+        IOManager::log(std::format("Configuration loaded successfully from: {}",
+                                   configPath.string()));
+        return config;
       }
     }
+  }
 
-    if (!configOpt) {
-      IOManager::log("CRITICAL: Failed to load configuration from all paths.");
-      std::println(stderr, "\n=== ERROR ===");
-      std::println(stderr, "Failed to load config.json!\n");
-      std::println(stderr, "Searched in:");
-      for (const auto& path : configPaths) {
-        std::println(stderr, "  - {}", path.string());
+  IOManager::log(LogLevel::Error,
+                 "CRITICAL: Failed to load configuration from all paths.");
+  error = "Failed to load config.json!\n\nSearched in:";
+  for (const auto& path : configPaths) {
+    error += std::format("\n  - {}", path.string());
+  }
+  error += "\n\nPlease ensure config.json exists in one of these locations.";
+  return std::nullopt;
+}
+
+// Prints each action as one JSON object per line, tagged with its root in a
+// multi-root run.
+void print_plan(const std::vector<Action>& plan, const fs::path& root = {}) {
+  for (const auto& action : plan) {
+    json line{{"from", action.from},
+              {"to", action.to},
+              {"category", action.category.name()}};
+    if (action.type != ActionType::MOVE) line["action"] = action.type;
+    if (!root.empty()) line["root"] = root;
+    std::println("{}", line.dump());
+  }
+  std::fflush(stdout);
+}
+
+RuleEngineOptions engine_options(const CommandLine& cmd) {
+  RuleEngineOptions options = RuleEngineOptions::persistent();
+  options.walk = cmd.walk_options;
+  options.dedupe = cmd.dedupe_options;
+  return options;
+}
+
+int run_mode(const CommandLine& cmd, const Config& config,
+             const fs::path& targetDir) {
+  switch (cmd.mode) {
+    case Mode::Watch: {
+      IOManager::log("Starting headless watch mode...");
+      RuleEngine engine(config, engine_options(cmd));
+      WatchDaemon daemon(engine, targetDir, cmd.watch_options);
+      return daemon.run() ? kExitOk : kExitError;
+    }
+    case Mode::DryRun: {
+      RuleEngine engine(config, engine_options(cmd));
+      print_plan(engine.generate_plan(targetDir));
+      return kExitOk;
+    }
+    case Mode::Apply: {
+      RuleEngine engine(config, engine_options(cmd));
+      const auto plan = engine.generate_plan(targetDir);
+      const auto performed = IOManager::apply_plan(plan, kJournalPath);
+      std::println("Moved {} of {} entries.", performed.size(), plan.size());
+      return performed.size() == plan.size() ? kExitOk : kExitPartial;
+    }
+    case Mode::Interactive: {
+      IOManager::log("Initializing UI...");
+      auto application = std::make_shared<UI>(config, targetDir,
+                                              engine_options(cmd));
+      application->run();
+      return kExitOk;
+    }
+    case Mode::Undo:
+      break;
+  }
+  return kExitUsage;
+}
+
+RuleEngineOptions root_engine_options(const CommandLine& cmd,
+                                      const fs::path& target,
+                                      const RootShare& share) {
+  RuleEngineOptions options = engine_options(cmd);
+  options.scan_index_path = root_file(*options.scan_index_path, target);
+  options.exif_cache_path = root_file(*options.exif_cache_path, target);
+  options.walk.max_workers = share.io_workers;
+  options.dedupe.max_workers = share.io_workers;
+  options.max_cpu_workers = share.cpu_workers;
+  return options;
+}
+
+std::string describe_root(Mode mode, const RootSpec& root,
+                          const RootReport& report) {
+  const std::string timing =
+      std::format("{} ms, started after {} ms", report.elapsed.count(),
+                  report.waited.count());
+  const std::string target = safe_path_to_string(root.target);
+  switch (mode) {
+    case Mode::Undo:
+      return std::format("{}: reverted {} moves, {} failed ({}).", target,
+                         report.performed, report.failed, timing);
+    case Mode::Apply:
+      return std::format("{}: moved {} of {} entries, {} failed ({}).",
+                         target, report.performed, report.planned,
+                         report.failed, timing);
+    default:
+      return std::format("{}: planned {} entries ({}).", target,
+                         report.planned, timing);
+  }
+}
+
+// Runs the mode for every root in one process: configs are parsed once each,
+// and the roots share the worker pool through a RootScheduler.
+int run_roots(const CommandLine& cmd, const std::vector<RootSpec>& roots,
+              const std::optional<Config>& default_config) {
+  std::map<fs::path, std::optional<Config>> configs;
+  for (const RootSpec& root : roots) {
+    if (!root.config.empty() && !configs.contains(root.config)) {
+      configs[root.config] = IOManager::load_config(root.config);
+    }
+  }
+
+  std::mutex print_mutex;
+  auto run_root = [&](size_t i, const RootShare& share) {
+    const RootSpec& root = roots[i];
+    const fs::path journal = root_file(kJournalPath, root.target);
+    RootReport report;
+    if (cmd.mode == Mode::Undo) {
+      UndoOptions options;
+      options.max_workers = share.io_workers;
+      const UndoResult result =
+          IOManager::run_undo(journal, cmd.undo_filter, options);
+      report.performed = result.undone;
+      report.failed = result.failed;
+      return report;
+    }
+
+    const auto& config =
+        root.config.empty() ? default_config : configs.at(root.config);
+    if (!config || !fs::is_directory(root.target)) {
+      IOManager::log(LogLevel::Error,
+                     std::format("Skipping root '{}': {}",
+                                 safe_path_to_string(root.target),
+                                 config ? "not a folder" : "no valid config"));
+      report.failed = 1;
+      return report;
+    }
+    RuleEngine engine(*config, root_engine_options(cmd, root.target, share));
+    const auto plan = engine.generate_plan(root.target);
+    report.planned = plan.size();
+    if (cmd.mode == Mode::DryRun) {
+      std::scoped_lock lock(print_mutex);
+      print_plan(plan, root.target);
+      return report;
+    }
+    MoveExecutorOptions options;
+    options.max_workers = share.io_workers;
+    report.performed =
+        IOManager::apply_plan(plan, journal, {}, options).size();
+    report.failed = report.planned - report.performed;
+    return report;
+  };
+  // A root that throws is reported as failed; the others still run.
+  auto job = [&](size_t i, const RootShare& share) {
+    try {
+      return run_root(i, share);
+    } catch (const std::exception& e) {
+      IOManager::log(LogLevel::Error,
+                     std::format("Root '{}' failed: {}",
+                                 safe_path_to_string(roots[i].target),
+                                 e.what()));
+    } catch (...) {
+      IOManager::log(LogLevel::Error,
+                     std::format("Root '{}' failed: unknown exception",
+                                 safe_path_to_string(roots[i].target)));
+    }
+    RootReport report;
+    report.failed = 1;
+    return report;
+  };
+  const auto reports = RootScheduler(cmd.parallel_roots).run(roots.size(), job);
+
+  size_t failed = 0;
+  for (size_t i = 0; i < roots.size(); ++i) {
+    const std::string summary = describe_root(cmd.mode, roots[i], reports[i]);
+    IOManager::log(summary);
+    // A dry run's standard output is the plan alone.
+    if (cmd.mode != Mode::DryRun) std::println("{}", summary);
+    failed += reports[i].failed;
+  }
+  return failed == 0 ? kExitOk : kExitPartial;
+}
+
+int main(int argc, char* argv[]) {
+  auto cmdOpt = parse_command_line(argc, argv);
+  if (!cmdOpt) return kExitUsage;
+  const CommandLine& cmd = *cmdOpt;
+
+  // Before the logger and the worker pool start their threads, so that they
+  // inherit the mask and the daemon alone receives the signals.
+  if (cmd.mode == Mode::Watch) WatchDaemon::block_stop_signals();
+
+  Exiv2::XmpParser::initialize();
+  WorkerPool::configure(cmd.pool_options);
+  CrossDevice::configure(cmd.copy_options);
+
+  try {
+    IOManager::initialize_logger();
+    IOManager::log("--- Organizer v2.0 Started ---");
+
+    if (cmd.roots_path) {
+      const auto roots = IOManager::load_roots(*cmd.roots_path);
+      if (!roots) {
+        return report_fatal(cmd, "ERROR",
+                            std::format("Failed to load roots file: {}",
+                                        cmd.roots_path->string()));
+      }
+      std::optional<Config> default_config;
+      if (std::ranges::any_of(*roots, [](const RootSpec& root) {
+            return root.config.empty();
+          })) {
+        std::string config_error;
+        default_config = find_config(cmd, argc, argv, config_error);
+        if (!default_config) return report_fatal(cmd, "ERROR", config_error);
       }
-      std::println(
-          stderr,
-          "\nPlease ensure config.json exists in one of these locations.");
-      std::println(stderr, "Check organizer.log for details.");
-      pause_console();
+      const int exit_code = run_roots(cmd, *roots, default_config);
+      log_pool_stats();
+      IOManager::log("--- Organizer Exited Normally ---");
       Exiv2::XmpParser::terminate();
-      return 1;
+      return exit_code;
     }
-    IOManager::log(std::format("Configuration loaded successfully from: {}",
-                               usedConfigPath.string()));
 
-    auto targetDirOpt = IOManager::get_downloads_folder_path();
-    if (!targetDirOpt) {
-      IOManager::log("CRITICAL: Could not find Downloads folder.");
-      std::println(stderr, "\n=== ERROR ===");
-      std::println(stderr, "Could not locate Downloads folder!");
-      std::println(stderr, "Check organizer.log for details.");
-      pause_console();
+    if (cmd.mode == Mode::Undo) {
+      const UndoResult result = IOManager::run_undo(kJournalPath,
+                                                    cmd.undo_filter);
+      std::println("Reverted {} moves, {} failed.", result.undone,
+                   result.failed);
+      log_pool_stats();
+      IOManager::log("--- Organizer Exited Normally ---");
       Exiv2::XmpParser::terminate();
-      return 1;
+      return result.failed == 0 ? kExitOk : kExitPartial;
     }
-    IOManager::log(std::format("Target directory: {}", targetDirOpt->string()));
 
-    if (!fs::exists(*targetDirOpt)) {
-      IOManager::log("CRITICAL: Target directory does not exist.");
-      std::println(stderr, "\n=== ERROR ===");
-      std::println(stderr, "Downloads folder does not exist: {}",
-                   targetDirOpt->string());
-      pause_console();
+    if (cmd.mode == Mode::Interactive && !stdin_is_terminal()) {
+      std::println(stderr, "No terminal available for the interactive UI.");
+      print_usage();
       Exiv2::XmpParser::terminate();
-      return 1;
+      return kExitUsage;
     }
 
-    IOManager::log("Initializing UI...");
-    auto application = std::make_shared<UI>(*configOpt, *targetDirOpt);
-    application->run();
+    std::string config_error;
+    auto configOpt = find_config(cmd, argc, argv, config_error);
+    if (!configOpt) {
+      return report_fatal(cmd, "ERROR", config_error);
+    }
 
-    IOManager::log("--- Organizer Exited Normally ---");
+    auto targetDirOpt = cmd.target_dir ? cmd.target_dir
+                                       : IOManager::get_downloads_folder_path();
+    if (!targetDirOpt) {
+      IOManager::log(LogLevel::Error,
+                     "CRITICAL: Could not find Downloads folder.");
+      return report_fatal(cmd, "ERROR", "Could not locate Downloads folder!");
+    }
+    IOManager::log(std::format("Target directory: {}", targetDirOpt->string()));
 
+    if (!fs::is_directory(*targetDirOpt)) {
+      IOManager::log(LogLevel::Error,
+                     "CRITICAL: Target directory does not exist.");
+      return report_fatal(cmd, "ERROR",
+                          std::format("Target folder does not exist: {}",
+                                      targetDirOpt->string()));
+    }
+
+    const int exit_code = run_mode(cmd, *configOpt, *targetDirOpt);
+    log_pool_stats();
+    IOManager::log("--- Organizer Exited Normally ---");
     Exiv2::XmpParser::terminate();
-    return 0;
+    return exit_code;
 
   } catch (const std::exception& e) {
-    IOManager::log(std::format("FATAL EXCEPTION: {}", e.what()));
-    std::println(stderr, "\n=== FATAL ERROR ===");
-    std::println(stderr, "Exception: {}", e.what());
-    std::println(stderr, "Check organizer.log for details.");
-    pause_console();
-    Exiv2::XmpParser::terminate();
-    return 1;
+    IOManager::log(LogLevel::Error,
+                   std::format("FATAL EXCEPTION: {}", e.what()));
+    return report_fatal(cmd, "FATAL ERROR",
+                        std::format("Exception: {}", e.what()));
   } catch (...) {
-    IOManager::log("FATAL: Unknown exception occurred.");
-    std::println(stderr, "\n=== FATAL ERROR ===");
-    std::println(stderr, "Unknown exception occurred!");
-    std::println(stderr, "Check organizer.log for details.");
-    pause_console();
-    Exiv2::XmpParser::terminate();
-    return 1;
+    IOManager::log(LogLevel::Error, "FATAL: Unknown exception occurred.");
+    return report_fatal(cmd, "FATAL ERROR", "Unknown exception occurred!");
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../AsciiCase.hpp"
+
+namespace {
+char fold(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool reference_equals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (fold(a[i]) != fold(b[i])) return false;
+  }
+  return true;
+}
+}  // namespace
+
+// Every length around the 8, 16 and 32 byte blocks is compared, with a
+// difference placed at each position, against a byte-by-byte reference.
+TEST(AsciiCaseTest, MatchesReferenceAtEveryLengthAndOffset) {
+  // '@', '[', '`' and '{' border the letter ranges; 0xC3 0x84 is "Ä".
+  const std::string alphabet = "aZ@[`{09._-\xC3\x84mQ";
+  for (size_t n = 0; n <= 70; ++n) {
+    std::string lower_text, upper_text;
+    for (size_t i = 0; i < n; ++i) {
+      const char c = alphabet[i % alphabet.size()];
+      lower_text += fold(c);
+      upper_text += c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+    }
+    EXPECT_TRUE(AsciiCase::equals(lower_text, upper_text)) << n;
+    EXPECT_EQ(AsciiCase::hash(lower_text), AsciiCase::hash(upper_text)) << n;
+
+    std::string lowered = upper_text;
+    AsciiCase::lower(lowered, lowered.data());
+    EXPECT_EQ(lowered, lower_text) << n;
+
+    for (size_t i = 0; i < n; ++i) {
+      for (char replacement : {'@', '\xE4', static_cast<char>(
+                                                lower_text[i] ^ 0x20)}) {
+        std::string other = upper_text;
+        other[i] = replacement;
+        EXPECT_EQ(AsciiCase::equals(lower_text, other),
+                  reference_equals(lower_text, other))
+            << n << " at " << i;
+      }
+    }
+  }
+}
+
+TEST(AsciiCaseTest, SuffixesAndLookups) {
+  EXPECT_TRUE(AsciiCase::ends_with("Setup.ZIP", ".zip"));
+  EXPECT_TRUE(AsciiCase::ends_with("a", ""));
+  EXPECT_FALSE(AsciiCase::ends_with("zip", ".zip"));
+  EXPECT_FALSE(AsciiCase::ends_with("archive.zap", ".zip"));
+
+  const AsciiCase::Set set = {"Package.json", ".JPG"};
+  EXPECT_TRUE(set.contains(std::string_view("package.JSON")));
+  EXPECT_TRUE(set.contains(std::string_view(".jpg")));
+  EXPECT_FALSE(set.contains(std::string_view(".jpeg")));
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../ContentSniffer.hpp"
+
+using namespace std::string_view_literals;
+
+namespace {
+std::vector<unsigned char> bytes(std::string_view text, size_t size = 0) {
+  std::vector<unsigned char> out(text.begin(), text.end());
+  if (out.size() < size) out.resize(size, 0);
+  return out;
+}
+}  // namespace
+
+TEST(ContentSnifferTest, MatchesLeadingSignatures) {
+  using ContentSniffer::match;
+  EXPECT_EQ(match(bytes("%PDF-1.7\n%\xE2\xE3")), ".pdf");
+  EXPECT_EQ(match(bytes("\x89PNG\r\n\x1A\n\0\0\0\rIHDR"sv, 64)), ".png");
+  EXPECT_EQ(match(bytes("\xFF\xD8\xFF\xE0\0\x10JFIF"sv, 64)), ".jpg");
+  EXPECT_EQ(match(bytes("RIFF\x10\0\0\0WEBPVP8 "sv, 64)), ".webp");
+  EXPECT_EQ(match(bytes("\0\0\0\x18" "ftypmp42"sv, 64)), ".mp4");
+  EXPECT_EQ(match(bytes("\0\0\0\x14" "ftypqt  "sv, 64)), ".mov");
+  EXPECT_EQ(match(bytes("PK\x03\x04\x14\0\0\0\0\0[Content_Types].xml"
+                        "PK\x03\x04word/document.xml"sv)),
+            ".docx");
+  EXPECT_EQ(match(bytes("PK\x03\x04\x14\0\0\0\0\0readme.txt"sv)), ".zip");
+
+  auto tar = bytes("notes.txt", 512);
+  std::memcpy(tar.data() + 257, "ustar", 5);
+  EXPECT_EQ(match(tar), ".tar");
+}
+
+// Weak or truncated signatures must not produce a match.
+TEST(ContentSnifferTest, RejectsWeakAndTruncatedSignatures) {
+  using ContentSniffer::match;
+  EXPECT_EQ(match(bytes("MZ this is plain text, not a program", 128)), "");
+  EXPECT_EQ(match(bytes("\0\x01\0"sv)), "");
+  EXPECT_EQ(match(bytes("just some text")), "");
+  EXPECT_EQ(match({}), "");
+
+  auto pe = bytes("MZ", 0x100);
+  const std::uint32_t pe_offset = 0x80;
+  std::memcpy(pe.data() + 0x3C, &pe_offset, sizeof(pe_offset));
+  std::memcpy(pe.data() + pe_offset, "PE\0\0", 4);
+  EXPECT_EQ(match(pe), ".exe");
+}
+
+// Files are read from disk, including signatures beyond the first 4 KB.
+TEST(ContentSnifferTest, SniffsFilesInBatches) {
+  const fs::path dir = fs::temp_directory_path() / "organizer_sniff_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::ofstream(dir / "download", std::ios::binary) << "%PDF-1.4\n";
+  {
+    std::string iso(0x8010, '\0');
+    iso.replace(0x8001, 5, "CD001");
+    std::ofstream(dir / "disk.bin", std::ios::binary) << iso;
+  }
+  std::ofstream(dir / "notes") << "hello";
+
+  const std::vector<fs::path> paths = {dir / "download", dir / "disk.bin",
+                                       dir / "notes", dir / "missing"};
+  const auto results = ContentSniffer::sniff_batch(paths);
+  ASSERT_EQ(results.size(), 4);
+  EXPECT_EQ(results[0], ".pdf");
+  EXPECT_EQ(results[1], ".iso");
+  EXPECT_EQ(results[2], "");
+  EXPECT_EQ(results[3], "");
+  fs::remove_all(dir);
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Deduplicator.hpp"
+#include "../IOManager.hpp"
+#include "../StreamHash.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+std::span<const unsigned char> as_bytes(std::string_view text) {
+  return {reinterpret_cast<const unsigned char*>(text.data()), text.size()};
+}
+}  // namespace
+
+class DeduplicatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_dedupe_test_run";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  void Write(const fs::path& relative_path, const std::string& content) {
+    const fs::path path = test_dir / relative_path;
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << content;
+  }
+
+  // A move of a top-level file into `category`, as the rule engine plans it.
+  Action Move(const std::string& name, const std::string& category) {
+    return {test_dir / name, test_dir / category / name,
+            Category::intern(category), ActionType::MOVE};
+  }
+
+  fs::path test_dir;
+};
+
+// The digest matches reference XXH64 values, however the input is split.
+TEST(StreamHashTest, MatchesReferenceInAnyChunking) {
+  EXPECT_EQ(StreamHash64::hash({}), 0xEF46DB3751D8E999ull);
+  EXPECT_EQ(StreamHash64::hash(as_bytes("abc")), 0x44BC2CF5AD770999ull);
+
+  std::string text;
+  for (int i = 0; i < 1000; ++i) text += static_cast<char>('a' + i % 26);
+  const std::uint64_t whole = StreamHash64::hash(as_bytes(text));
+  for (size_t step : {1u, 7u, 31u, 32u, 33u, 500u}) {
+    StreamHash64 hasher;
+    for (size_t i = 0; i < text.size(); i += step) {
+      hasher.update(as_bytes(std::string_view(text).substr(i, step)));
+    }
+    EXPECT_EQ(hasher.digest(), whole) << "step " << step;
+  }
+}
+
+// Files that share a size and both edges but differ in the middle are not
+// duplicates; identical files are, and a copy already in the destination is
+// the one kept.
+TEST_F(DeduplicatorTest, FindsDuplicatesThroughHashStages) {
+  const std::string edge(64, 'e');
+  Write("a.bin", edge + "same" + edge);
+  Write("b.bin", edge + "same" + edge);
+  Write("c.bin", edge + "diff" + edge);
+  Write("Other/old.bin", edge + "same" + edge);
+  Write("unique.bin", "something else");
+
+  std::vector<Action> plan = {Move("a.bin", "Other"), Move("b.bin", "Other"),
+                              Move("c.bin", "Other"),
+                              Move("unique.bin", "Other")};
+  DedupeOptions options;
+  options.policy = DedupePolicy::Skip;
+  options.edge_bytes = 16;
+  const DedupeStats stats = Deduplicator(options).process(plan);
+
+  EXPECT_EQ(stats.candidates, 5u);
+  EXPECT_EQ(stats.duplicates, 2u);
+  EXPECT_EQ(stats.edge_hashed, 4u);
+  EXPECT_EQ(stats.full_hashed, 4u);
+  ASSERT_EQ(plan.size(), 2u);
+  EXPECT_EQ(plan[0].from, test_dir / "c.bin");
+  EXPECT_EQ(plan[1].from, test_dir / "unique.bin");
+}
+
+// Deleted and hard-linked duplicates are journaled and can be undone.
+TEST_F(DeduplicatorTest, AppliesAndUndoesDuplicateActions) {
+  Write("keep.txt", "duplicate contents");
+  Write("copy (1).txt", "duplicate contents");
+  Write("copy (2).txt", "duplicate contents");
+  std::vector<Action> plan = {Move("copy (1).txt", "Documents"),
+                              Move("keep.txt", "Documents")};
+
+  DedupeOptions options;
+  options.policy = DedupePolicy::Delete;
+  Deduplicator(options).process(plan);
+  ASSERT_EQ(plan.size(), 2u);
+  EXPECT_EQ(plan[0].type, ActionType::REMOVE);
+  EXPECT_EQ(plan[0].to, test_dir / "keep.txt");
+
+  plan.push_back({test_dir / "copy (2).txt", test_dir / "keep.txt",
+                  Category::intern("Documents"), ActionType::HARDLINK});
+  const fs::path journal = test_dir / "journal.json";
+  const auto performed = IOManager::apply_plan(plan, journal);
+  ASSERT_EQ(performed.size(), 3u);
+  EXPECT_FALSE(fs::exists(test_dir / "copy (1).txt"));
+  EXPECT_TRUE(fs::exists(test_dir / "Documents" / "keep.txt"));
+#ifndef _WIN32
+  EXPECT_EQ(fs::hard_link_count(test_dir / "Documents" / "keep.txt"), 2u);
+#endif
+
+  const UndoResult result = UndoEngine().run(journal);
+  EXPECT_EQ(result.undone, 3u);
+  EXPECT_EQ(result.failed, 0u);
+  for (const char* name : {"keep.txt", "copy (1).txt", "copy (2).txt"}) {
+    ASSERT_TRUE(fs::exists(test_dir / name)) << name;
+    EXPECT_EQ(fs::hard_link_count(test_dir / name), 1u) << name;
+    std::ifstream in(test_dir / name);
+    std::string content;
+    std::getline(in, content);
+    EXPECT_EQ(content, "duplicate contents");
+  }
+}
+
+// A file that was edited after planning, keeping its size, is no longer a
+// duplicate and must survive the apply.
+TEST_F(DeduplicatorTest, RefusesDuplicatesThatChangedAfterPlanning) {
+  Write("keep.txt", "duplicate contents");
+  Write("keep copy.txt", "duplicate contents");
+  std::vector<Action> plan = {Move("keep copy.txt", "Documents"),
+                              Move("keep.txt", "Documents")};
+  DedupeOptions options;
+  options.policy = DedupePolicy::Delete;
+  Deduplicator(options).process(plan);
+  ASSERT_EQ(plan.size(), 2u);
+  ASSERT_EQ(plan[0].type, ActionType::REMOVE);
+
+  Write("keep copy.txt", "duplicate CONTENTS");
+  EXPECT_TRUE(Deduplicator::apply(plan[0]));
+  std::ifstream in(test_dir / "keep copy.txt");
+  std::string content;
+  std::getline(in, content);
+  EXPECT_EQ(content, "duplicate CONTENTS");
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <format>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+
+#include "../DirectoryReader.hpp"
+
+class DirectoryReaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_dirreader_test";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  fs::path test_dir;
+};
+
+// Each entry is reported with its own type, without following symlinks.
+TEST_F(DirectoryReaderTest, ReportsEntryTypes) {
+  std::ofstream(test_dir / "file.txt");
+  fs::create_directory(test_dir / "folder");
+  std::error_code ec;
+  fs::create_directory_symlink(test_dir / "folder", test_dir / "link", ec);
+  const bool have_symlink = !ec;
+
+  std::map<std::string, EntryType> types;
+  for (const auto& entry : read_directory(test_dir, ec)) {
+    types[entry_name_utf8(entry)] = entry.type;
+  }
+  ASSERT_FALSE(ec);
+
+  EXPECT_EQ(types.size(), have_symlink ? 3 : 2);
+  EXPECT_EQ(types["file.txt"], EntryType::Regular);
+  EXPECT_EQ(types["folder"], EntryType::Directory);
+  if (have_symlink) {
+    EXPECT_EQ(types["link"], EntryType::Symlink);
+    EXPECT_EQ(entry_type_of(test_dir / "link"), EntryType::Directory);
+  }
+
+  read_directory(test_dir / "missing", ec);
+  EXPECT_TRUE(ec);
+}
+
+// A directory larger than one read buffer is listed completely, once.
+TEST_F(DirectoryReaderTest, ListsLargeDirectoriesCompletely) {
+  constexpr int kFiles = 3000;
+  for (int i = 0; i < kFiles; ++i) {
+    std::ofstream(test_dir /
+                  std::format("a_fairly_long_file_name_{:05}.dat", i));
+  }
+
+  std::set<std::string> names;
+  DirectoryReader reader(test_dir);
+  std::vector<DirEntry> batch;
+  while (reader.next(batch)) {
+    for (const auto& entry : batch) names.insert(entry_name_utf8(entry));
+  }
+  EXPECT_FALSE(reader.error());
+  EXPECT_EQ(names.size(), kFiles);
+  EXPECT_TRUE(names.contains("a_fairly_long_file_name_02999.dat"));
+  EXPECT_EQ(extension_of("archive.tar.gz"), ".gz");
+  EXPECT_EQ(extension_of(".bashrc"), "");
+}
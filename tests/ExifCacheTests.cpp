@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+#include "../ExifCache.hpp"
+
+namespace fs = std::filesystem;
+
+#ifndef _WIN32
+// Verify that dates and negative results survive a reopen, and that a changed
+// file identity is treated as a miss.
+TEST(ExifCacheTest, PersistsPositiveAndNegativeResults) {
+  const fs::path cache_path =
+      fs::temp_directory_path() / "organizer_test_exif_cache.bin";
+  fs::remove(cache_path);
+
+  const FileIdentity photo{1, 100, 2048, 1'700'000'000'000'000'000, 0};
+  const FileIdentity screenshot{1, 101, 512, 1'700'000'000'000'000'000, 0};
+  {
+    auto cache = ExifCache::open(cache_path, 64);
+    ASSERT_NE(cache, nullptr);
+    cache->store(photo, std::string("2021:07:04 12:00:00"));
+    cache->store(screenshot, std::nullopt);
+  }
+
+  auto cache = ExifCache::open(cache_path, 64);
+  ASSERT_NE(cache, nullptr);
+  std::string date;
+  EXPECT_EQ(cache->lookup(photo, date), ExifCache::Lookup::HasDate);
+  EXPECT_EQ(date, "2021:07:04");
+  EXPECT_EQ(cache->lookup(screenshot, date), ExifCache::Lookup::NoDate);
+
+  FileIdentity edited = photo;
+  edited.mtime_ns += 1;
+  EXPECT_EQ(cache->lookup(edited, date), ExifCache::Lookup::Miss);
+
+  const auto stats = cache->stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.negative_hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+
+  cache.reset();
+  fs::remove(cache_path);
+}
+
+// Verify that the cache never grows beyond its slot count.
+TEST(ExifCacheTest, EvictsWhenBucketsAreFull) {
+  const fs::path cache_path =
+      fs::temp_directory_path() / "organizer_test_exif_cache_small.bin";
+  fs::remove(cache_path);
+
+  auto cache = ExifCache::open(cache_path, 8);
+  ASSERT_NE(cache, nullptr);
+  for (std::uint64_t ino = 0; ino < 20; ++ino) {
+    cache->store({1, ino, 1, 1, 0}, std::nullopt);
+  }
+  EXPECT_EQ(cache->stats().evictions, 12);
+
+  cache.reset();
+  fs::remove(cache_path);
+}
+#endif
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../ExifReader.hpp"
+
+namespace fs = std::filesystem;
+
+// Test fixture that writes small synthetic image files to a temporary folder.
+class ExifReaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_exif_test_run";
+    fs::create_directories(test_dir);
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  // Builds a TIFF structure whose Exif IFD holds only DateTimeOriginal.
+  static std::vector<std::uint8_t> MakeTiff(const std::string& date,
+                                            bool little_endian) {
+    std::vector<std::uint8_t> out;
+    auto u16 = [&](std::uint16_t v) {
+      if (little_endian) {
+        out.push_back(v & 0xFF);
+        out.push_back(v >> 8);
+      } else {
+        out.push_back(v >> 8);
+        out.push_back(v & 0xFF);
+      }
+    };
+    auto u32 = [&](std::uint32_t v) {
+      if (little_endian) {
+        u16(v & 0xFFFF);
+        u16(v >> 16);
+      } else {
+        u16(v >> 16);
+        u16(v & 0xFFFF);
+      }
+    };
+
+    out.push_back(little_endian ? 'I' : 'M');
+    out.push_back(little_endian ? 'I' : 'M');
+    u16(42);
+    u32(8);
+    // IFD0 at 8: a single ExifIFD pointer.
+    u16(1);
+    u16(0x8769);
+    u16(4);
+    u32(1);
+    u32(26);
+    u32(0);
+    // Exif IFD at 26: DateTimeOriginal stored at offset 44.
+    u16(1);
+    u16(0x9003);
+    u16(2);
+    u32(static_cast<std::uint32_t>(date.size() + 1));
+    u32(44);
+    u32(0);
+    out.insert(out.end(), date.begin(), date.end());
+    out.push_back('\0');
+    return out;
+  }
+
+  static std::vector<std::uint8_t> MakeJpeg(
+      const std::vector<std::uint8_t>& tiff) {
+    std::vector<std::uint8_t> out = {0xFF, 0xD8};
+    // An unrelated APP0 segment first, as most cameras write.
+    out.insert(out.end(), {0xFF, 0xE0, 0x00, 0x04, 0x00, 0x00});
+    const size_t length = 2 + 6 + tiff.size();
+    out.insert(out.end(), {0xFF, 0xE1, static_cast<std::uint8_t>(length >> 8),
+                           static_cast<std::uint8_t>(length & 0xFF)});
+    out.insert(out.end(), {'E', 'x', 'i', 'f', 0, 0});
+    out.insert(out.end(), tiff.begin(), tiff.end());
+    out.insert(out.end(), {0xFF, 0xDA, 0x00, 0x02, 0xFF, 0xD9});
+    return out;
+  }
+
+  fs::path WriteFile(const std::string& name,
+                     const std::vector<std::uint8_t>& bytes) {
+    fs::path path = test_dir / name;
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+    return path;
+  }
+
+  fs::path test_dir;
+};
+
+TEST_F(ExifReaderTest, ReadsDateFromJpegApp1) {
+  auto path =
+      WriteFile("photo.jpg", MakeJpeg(MakeTiff("2023:05:17 10:11:12", true)));
+  auto result = ExifReader::read_date_time_original(path);
+  ASSERT_EQ(result.status, ExifReader::Status::Found);
+  EXPECT_EQ(result.date, "2023:05:17");
+}
+
+TEST_F(ExifReaderTest, ReadsDateFromBigEndianTiffContainer) {
+  auto path = WriteFile("raw.nef", MakeTiff("2019:12:31 23:59:59", false));
+  auto result = ExifReader::read_date_time_original(path);
+  ASSERT_EQ(result.status, ExifReader::Status::Found);
+  EXPECT_EQ(result.date, "2019:12:31");
+}
+
+TEST_F(ExifReaderTest, ReportsMissingExifAndUnsupportedFormats) {
+  auto jpeg = WriteFile("plain.jpg", {0xFF, 0xD8, 0xFF, 0xDA, 0x00, 0x02});
+  EXPECT_EQ(ExifReader::read_date_time_original(jpeg).status,
+            ExifReader::Status::NotFound);
+
+  auto png = WriteFile("image.png", {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A,
+                                     0x0A});
+  EXPECT_EQ(ExifReader::read_date_time_original(png).status,
+            ExifReader::Status::Unsupported);
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <format>
+#include <string>
+
+#include "../Category.hpp"
+#include "../ExtensionTable.hpp"
+
+// Every inserted extension is found in any case, including ones too long for
+// the perfect-hash table, and nothing else is.
+TEST(ExtensionTableTest, FindsEveryExtensionIgnoringCase) {
+  ExtensionTable table;
+  for (int i = 0; i < 5000; ++i) {
+    table.insert(std::format(".e{}", i), static_cast<CategoryId>(i % 97));
+  }
+  table.insert(".JPG", 1000);
+  table.insert(".torrent", 1001);
+  table.insert(".crdownload", 1002);
+  table.insert(".jpg", 1003);  // Replaces ".JPG".
+  table.build();
+
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_EQ(table.find(std::format(".E{}", i)), i % 97) << i;
+  }
+  EXPECT_EQ(table.find(".Jpg"), 1003);
+  EXPECT_EQ(table.find(".TORRENT"), 1001);
+  EXPECT_EQ(table.find(".CrDownload"), 1002);
+  EXPECT_EQ(table.find(".e5000"), std::nullopt);
+  EXPECT_EQ(table.find(".jpgx"), std::nullopt);
+  EXPECT_EQ(table.find(""), std::nullopt);
+  EXPECT_EQ(ExtensionTable().find(".pdf"), std::nullopt);
+}
+
+TEST(CategoryTest, InternsNamesOnce) {
+  const Category documents = Category::intern("Documents");
+  EXPECT_EQ(Category::intern(std::string("Docu") + "ments"), documents);
+  EXPECT_NE(Category::intern("documents"), documents);
+  EXPECT_EQ(documents.name(), "Documents");
+  EXPECT_TRUE(Category().empty());
+  EXPECT_EQ(Category::intern(""), Category());
+  EXPECT_EQ(Category().name(), "");
+}
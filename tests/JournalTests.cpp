@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Journal.hpp"
+
+namespace fs = std::filesystem;
+
+class JournalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_journal_test_run";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+    journal_path = test_dir / "journal.json";
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  // Creates a file at `to` so that the entry counts as still in effect.
+  JournalEntry MakeMove(const std::string& name) {
+    fs::create_directories(test_dir / "Moved");
+    std::ofstream(test_dir / "Moved" / name) << "moved";
+    return {ActionType::MOVE, test_dir / name, test_dir / "Moved" / name,
+            "Moved", 0};
+  }
+
+  fs::path test_dir;
+  fs::path journal_path;
+};
+
+// Verify that entries appended across several writers are all read back.
+TEST_F(JournalTest, AppendsAcrossSessions) {
+  Journal::WriterOptions options;
+  options.sync_every = 3;
+  for (int session = 0; session < 2; ++session) {
+    auto writer = Journal::Writer::open(journal_path, options);
+    ASSERT_NE(writer, nullptr);
+    for (int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(
+          writer->append(MakeMove(std::format("{}_{}.txt", session, i))));
+    }
+    EXPECT_EQ(writer->entries_written(), 5u);
+  }
+
+  auto entries = Journal::read(journal_path);
+  ASSERT_EQ(entries.size(), 10u);
+  EXPECT_EQ(entries.front().from, test_dir / "0_0.txt");
+  EXPECT_EQ(entries.back().to, test_dir / "Moved" / "1_4.txt");
+}
+
+// Verify that recovery cuts off a torn record and drops moves that were
+// already reverted, and that an older array journal is converted.
+TEST_F(JournalTest, RecoversTornAndLegacyJournals) {
+  const JournalEntry kept = MakeMove("kept.txt");
+  const JournalEntry undone{ActionType::MOVE, test_dir / "undone.txt",
+                            test_dir / "Moved" / "undone.txt", "Moved", 0};
+  std::ofstream(undone.from) << "already back";
+  {
+    auto writer = Journal::Writer::open(journal_path);
+    ASSERT_TRUE(writer->append(kept));
+    ASSERT_TRUE(writer->append(undone));
+  }
+  std::ofstream(journal_path, std::ios::app) << R"({"action":"MOVE","fro)";
+
+  EXPECT_EQ(Journal::recover(journal_path), 1u);
+  auto entries = Journal::read(journal_path);
+  ASSERT_EQ(entries.size(), 1u);
+  EXPECT_EQ(entries[0].to, kept.to);
+
+  std::ofstream(journal_path, std::ios::trunc)
+      << nlohmann::json(std::vector<JournalEntry>{kept}).dump(2);
+  EXPECT_EQ(Journal::recover(journal_path), 1u);
+  std::ifstream in(journal_path);
+  std::string first_line;
+  std::getline(in, first_line);
+  EXPECT_EQ(first_line.front(), '{');
+}
+
+// Verify that a valid last record without its newline is kept, and that
+// recovery terminates it so the next append starts a line of its own.
+TEST_F(JournalTest, KeepsUnterminatedLastRecord) {
+  const JournalEntry first = MakeMove("first.txt");
+  {
+    auto writer = Journal::Writer::open(journal_path);
+    ASSERT_TRUE(writer->append(first));
+  }
+  std::string text;
+  {
+    std::ifstream in(journal_path);
+    std::getline(in, text);
+  }
+  std::ofstream(journal_path, std::ios::trunc) << text;
+
+  ASSERT_EQ(Journal::read(journal_path).size(), 1u);
+  EXPECT_EQ(Journal::recover(journal_path), 1u);
+  {
+    auto writer = Journal::Writer::open(journal_path);
+    ASSERT_TRUE(writer->append(MakeMove("second.txt")));
+  }
+  auto entries = Journal::read(journal_path);
+  ASSERT_EQ(entries.size(), 2u);
+  EXPECT_EQ(entries[0].to, first.to);
+  EXPECT_EQ(entries[1].from, test_dir / "second.txt");
+}
+
+// Verify that recovery never discards what it cannot parse: unreadable lines
+// are written back as they are, and an unreadable array journal is moved
+// aside rather than removed.
+TEST_F(JournalTest, KeepsWhatItCannotParse) {
+  const JournalEntry kept = MakeMove("kept.txt");
+  std::ofstream(journal_path) << "not a journal record\n"
+                              << nlohmann::json(kept).dump();
+  EXPECT_EQ(Journal::recover(journal_path), 1u);
+  {
+    std::ifstream in(journal_path);
+    std::string line;
+    ASSERT_TRUE(std::getline(in, line));
+    EXPECT_EQ(line, "not a journal record");
+  }
+  ASSERT_EQ(Journal::read(journal_path).size(), 1u);
+
+  std::ofstream(journal_path, std::ios::trunc) << "not a journal record\n";
+  EXPECT_EQ(Journal::recover(journal_path), 0u);
+  EXPECT_TRUE(fs::exists(journal_path));
+
+  std::ofstream(journal_path, std::ios::trunc) << "[{\"action\": ";
+  EXPECT_EQ(Journal::recover(journal_path), 0u);
+  EXPECT_FALSE(fs::exists(journal_path));
+  size_t aside = 0;
+  for (const auto& entry : fs::directory_iterator(test_dir)) {
+    const std::string name = entry.path().filename().string();
+    if (name.starts_with("journal.json.unreadable-")) ++aside;
+  }
+  EXPECT_EQ(aside, 1u);
+}
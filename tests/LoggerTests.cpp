@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <format>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Logger.hpp"
+
+// Collects the lines a Logger writes, without their timestamps.
+struct CollectingSink {
+  std::mutex mutex;
+  std::vector<std::string> lines;
+
+  Logger::Sink sink() {
+    return [this](std::string_view line, bool end_of_batch) {
+      if (end_of_batch) return;
+      std::scoped_lock lock(mutex);
+      lines.emplace_back(line.substr(line.find(" | ") + 3));
+    };
+  }
+};
+
+// Verify that concurrent producers lose nothing and keep their own order.
+TEST(LoggerTest, DeliversEveryMessageFromConcurrentProducers) {
+  CollectingSink collected;
+  LoggerOptions options;
+  options.capacity = 64;
+  options.never_drop_level = LogLevel::Debug;
+  {
+    Logger logger(collected.sink(), options);
+    std::vector<std::jthread> producers;
+    for (int t = 0; t < 4; ++t) {
+      producers.emplace_back([&logger, t] {
+        for (int i = 0; i < 500; ++i) {
+          logger.log(LogLevel::Info, std::format("{}:{}", t, i));
+        }
+      });
+    }
+    producers.clear();
+    logger.flush();
+    EXPECT_EQ(logger.stats().written, 2000u);
+    EXPECT_EQ(logger.stats().dropped, 0u);
+  }
+
+  std::vector<int> next(4, 0);
+  for (const auto& line : collected.lines) {
+    const int t = line[0] - '0';
+    EXPECT_EQ(line, std::format("{}:{}", t, next[t]++));
+  }
+}
+
+// Verify that levels are filtered, repeats are collapsed, and messages are
+// dropped and reported when the buffer is full.
+TEST(LoggerTest, FiltersCollapsesAndDrops) {
+  CollectingSink collected;
+  std::atomic<bool> release = false;
+  LoggerOptions options;
+  options.capacity = 4;
+  auto blocking_sink = [&, inner = collected.sink()](std::string_view line,
+                                                     bool end_of_batch) {
+    release.wait(false);
+    inner(line, end_of_batch);
+  };
+  Logger logger(blocking_sink, options);
+
+  EXPECT_FALSE(logger.log(LogLevel::Debug, "hidden"));
+  for (int i = 0; i < 3; ++i) logger.log(LogLevel::Info, "same");
+  logger.log(LogLevel::Info, "different");
+  for (int i = 0; i < 20; ++i) logger.log(LogLevel::Info, "overflow");
+  EXPECT_GT(logger.stats().dropped, 0u);
+
+  release = true;
+  release.notify_all();
+  logger.flush();
+
+  ASSERT_GE(collected.lines.size(), 3u);
+  EXPECT_EQ(collected.lines[0], "same");
+  EXPECT_EQ(collected.lines[1], "(previous message repeated 2 more times)");
+  EXPECT_EQ(collected.lines[2], "different");
+  EXPECT_EQ(logger.stats().suppressed, 2u);
+  EXPECT_TRUE(std::ranges::any_of(collected.lines, [](const auto& line) {
+    return line.ends_with("messages dropped, buffer full");
+  }));
+}
@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "../CrossDevice.hpp"
+#include "../MoveExecutor.hpp"
+#include "../NameIndex.hpp"
+#include "../UndoEngine.hpp"
+
+namespace fs = std::filesystem;
+
+class MoveExecutorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_executor_test_run";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  void CreateDummyFile(const fs::path& relative_path) {
+    fs::path full_path = test_dir / relative_path;
+    fs::create_directories(full_path.parent_path());
+    std::ofstream(full_path) << "dummy content";
+  }
+
+  fs::path test_dir;
+};
+
+// Verify that moves into several directories all land, that existing names
+// are never overwritten, and that the journal follows the plan's order.
+TEST_F(MoveExecutorTest, AppliesGroupedMovesInPlanOrder) {
+  std::vector<Action> plan;
+  for (int i = 0; i < 20; ++i) {
+    const std::string name = std::format("file{}.{}", i, i % 2 ? "pdf" : "zip");
+    const std::string category = i % 2 ? "Documents" : "Archives";
+    CreateDummyFile(name);
+    plan.push_back({test_dir / name, test_dir / category / name,
+                    Category::intern(category), ActionType::MOVE});
+  }
+  CreateDummyFile("Documents/file1.pdf");
+
+  MoveExecutorOptions options;
+  options.max_workers = 4;
+  std::vector<JournalEntry> journal = MoveExecutor(options).execute(plan);
+
+  ASSERT_EQ(journal.size(), plan.size());
+  for (size_t i = 0; i < plan.size(); ++i) {
+    EXPECT_EQ(journal[i].from, plan[i].from);
+    EXPECT_TRUE(fs::exists(journal[i].to));
+    EXPECT_FALSE(fs::exists(plan[i].from));
+  }
+  EXPECT_EQ(journal[1].to, test_dir / "Documents" / "file1 (1).pdf");
+}
+
+// Verify that the name index hands out the first free suffix, including
+// names that already exist on disk and names claimed earlier in the run.
+TEST_F(MoveExecutorTest, NameIndexClaimsFirstFreeSuffix) {
+  CreateDummyFile("report.pdf");
+  CreateDummyFile("report (1).pdf");
+  CreateDummyFile("report (3).pdf");
+
+  DirectoryNameIndex names(test_dir);
+  EXPECT_EQ(names.claim("notes.txt"), "notes.txt");
+  EXPECT_EQ(names.claim("notes.txt"), "notes (1).txt");
+  EXPECT_EQ(names.claim("report.pdf"), "report (2).pdf");
+  EXPECT_EQ(names.claim("report.pdf"), "report (4).pdf");
+
+  names.release("report (2).pdf");
+  EXPECT_FALSE(names.contains("report (2).pdf"));
+  EXPECT_TRUE(names.contains("report (3).pdf"));
+}
+
+#ifndef _WIN32
+// Verify that a cross-device move copies large files in chunks, keeps the
+// permissions and modification time, checks the copy and removes the
+// source.
+TEST_F(MoveExecutorTest, CrossDeviceMoveKeepsContentsAndMetadata) {
+  CrossDevice::Options options;
+  options.verify = true;
+  options.chunk_size = 1 << 20;
+  CrossDevice::configure(options);
+
+  std::string content;
+  for (int i = 0; content.size() < (7u << 19); ++i) {
+    content += std::format("line {}\n", i);
+  }
+  const fs::path from = test_dir / "big.bin";
+  std::ofstream(from, std::ios::binary) << content;
+  fs::permissions(from, fs::perms::owner_read | fs::perms::owner_write |
+                            fs::perms::group_read);
+  const auto mtime = fs::last_write_time(from) - std::chrono::hours(24);
+  fs::last_write_time(from, mtime);
+
+  fs::create_directories(test_dir / "Archives");
+  const fs::path to = test_dir / "Archives" / "big.bin";
+  MoveMethod method = MoveMethod::Rename;
+  const std::error_code ec = CrossDevice::move(from, to, method);
+  CrossDevice::configure({});
+
+  ASSERT_FALSE(ec) << ec.message();
+  EXPECT_NE(method, MoveMethod::Rename);
+  EXPECT_FALSE(fs::exists(from));
+  std::ifstream in(to, std::ios::binary);
+  EXPECT_EQ(std::string(std::istreambuf_iterator<char>(in), {}), content);
+  EXPECT_EQ(fs::status(to).permissions(),
+            fs::perms::owner_read | fs::perms::owner_write |
+                fs::perms::group_read);
+  EXPECT_EQ(fs::last_write_time(to), mtime);
+}
+
+// Verify that folders are copied with their contents and links, and that an
+// existing destination is never replaced nor left with a partial copy.
+TEST_F(MoveExecutorTest, CrossDeviceMoveCopiesTreesWithoutReplacing) {
+  CreateDummyFile("Project/src/main.cpp");
+  CreateDummyFile("Project/README");
+  fs::create_symlink("src/main.cpp", test_dir / "Project" / "link");
+  fs::create_directories(test_dir / "Code");
+
+  MoveMethod method = MoveMethod::Rename;
+  std::error_code ec = CrossDevice::move(test_dir / "Project",
+                                         test_dir / "Code" / "Project", method);
+  ASSERT_FALSE(ec) << ec.message();
+  EXPECT_FALSE(fs::exists(test_dir / "Project"));
+  EXPECT_TRUE(fs::is_regular_file(test_dir / "Code/Project/src/main.cpp"));
+  EXPECT_TRUE(fs::is_regular_file(test_dir / "Code/Project/README"));
+  EXPECT_EQ(fs::read_symlink(test_dir / "Code/Project/link"), "src/main.cpp");
+
+  CreateDummyFile("README");
+  ec = CrossDevice::move(test_dir / "README",
+                         test_dir / "Code" / "Project" / "README", method);
+  EXPECT_EQ(ec, std::errc::file_exists);
+  EXPECT_TRUE(fs::exists(test_dir / "README"));
+  size_t entries = 0;
+  for ([[maybe_unused]] const auto& entry :
+       fs::directory_iterator(test_dir / "Code" / "Project")) {
+    ++entries;
+  }
+  EXPECT_EQ(entries, 3u);
+}
+
+// Verify that a folder that gains or changes entries between its copy and
+// the commit stays whole, and that the copy is dropped.
+TEST_F(MoveExecutorTest, CrossDeviceMoveKeepsTreeWrittenWhileCopied) {
+  CreateDummyFile("Project/notes.txt");
+  CreateDummyFile("Project/src/main.cpp");
+  fs::create_directories(test_dir / "Code");
+  const fs::path from = test_dir / "Project";
+  const fs::path landed = test_dir / "Code" / "Project";
+
+  auto stage_and_commit = [&](auto&& write) {
+    std::error_code ec;
+    auto staged = CrossDevice::StagedCopy::create(from, landed.parent_path(),
+                                                  ec);
+    if (!staged) return ec;
+    write();
+    fs::rename(staged->path(), landed);
+    return staged->commit(landed);
+  };
+
+  std::error_code ec = stage_and_commit(
+      [&] { CreateDummyFile("Project/src/added.cpp"); });
+  EXPECT_EQ(ec, std::errc::device_or_resource_busy);
+  EXPECT_TRUE(fs::exists(from / "src" / "added.cpp"));
+  EXPECT_TRUE(fs::exists(from / "src" / "main.cpp"));
+  EXPECT_FALSE(fs::exists(landed));
+
+  ec = stage_and_commit([&] {
+    std::ofstream(from / "notes.txt", std::ios::app) << " and more";
+  });
+  EXPECT_EQ(ec, std::errc::device_or_resource_busy);
+  std::ifstream in(from / "notes.txt");
+  EXPECT_EQ(std::string(std::istreambuf_iterator<char>(in), {}),
+            "dummy content and more");
+  EXPECT_FALSE(fs::exists(landed));
+
+  ec = stage_and_commit([] {});
+  ASSERT_FALSE(ec) << ec.message();
+  EXPECT_FALSE(fs::exists(from));
+  EXPECT_TRUE(fs::exists(landed / "src" / "added.cpp"));
+  EXPECT_TRUE(fs::exists(landed / "notes.txt"));
+}
+
+// Verify that moves from another filesystem are journaled with their copy
+// method and can be undone. Needs a tmpfs at /dev/shm.
+TEST_F(MoveExecutorTest, MovesAndUndoesAcrossFilesystems) {
+  const fs::path other = "/dev/shm/organizer_executor_test_run";
+  std::error_code ec;
+  fs::remove_all(other, ec);
+  if (!fs::create_directories(other, ec) || ec) {
+    GTEST_SKIP() << "no /dev/shm";
+  }
+  struct stat a {}, b {};
+  if (::stat(other.c_str(), &a) != 0 || ::stat(test_dir.c_str(), &b) != 0 ||
+      a.st_dev == b.st_dev) {
+    fs::remove_all(other, ec);
+    GTEST_SKIP() << "/dev/shm is on the same filesystem";
+  }
+  std::ofstream(other / "report.pdf") << "dummy content";
+  CreateDummyFile("Documents/report.pdf");
+
+  const std::vector<Action> plan = {{other / "report.pdf",
+                                     test_dir / "Documents" / "report.pdf",
+                                     Category::intern("Documents"),
+                                     ActionType::MOVE}};
+  const fs::path journal_path = test_dir / "journal.json";
+  std::vector<JournalEntry> journal;
+  {
+    auto writer = Journal::Writer::open(journal_path);
+    ASSERT_TRUE(writer);
+    journal = MoveExecutor().execute(plan, {}, writer.get());
+  }
+  ASSERT_EQ(journal.size(), 1u);
+  EXPECT_EQ(journal[0].to, test_dir / "Documents" / "report (1).pdf");
+  EXPECT_NE(journal[0].method, MoveMethod::Rename);
+  EXPECT_FALSE(fs::exists(other / "report.pdf"));
+  EXPECT_TRUE(fs::exists(journal[0].to));
+
+  const UndoResult result = UndoEngine().run(journal_path);
+  EXPECT_EQ(result.undone, 1u);
+  EXPECT_TRUE(fs::exists(other / "report.pdf"));
+  EXPECT_FALSE(fs::exists(journal[0].to));
+  fs::remove_all(other, ec);
+}
+#endif
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <format>
+#include <string>
+
+#include "../NameMatcher.hpp"
+
+namespace {
+ConditionBits match(const NameMatcher& matcher, NameTarget target,
+                    std::string_view name, size_t conditions) {
+  ConditionBits bits;
+  bits.resize(conditions);
+  matcher.match(target, name, bits);
+  return bits;
+}
+}  // namespace
+
+// Literal, case-sensitive, glob and substring patterns each set the ids of
+// their conditions, and only for their own target.
+TEST(NameMatcherTest, SetsConditionsOfEveryMatchingPattern) {
+  NameMatcher matcher;
+  matcher.add(NameTarget::File, "Makefile", true, 0);
+  matcher.add(NameTarget::File, "setup.exe", false, 1);
+  matcher.add(NameTarget::File, "*installer*.msi", false, 2);
+  matcher.add(NameTarget::File, "*.ex?", false, 3);
+  matcher.add(NameTarget::File, "*", false, 4);
+  matcher.add(NameTarget::Subdirectory, "assets*", false, 5);
+  matcher.add(NameTarget::File, "setup.exe", false, 6);
+  matcher.build();
+
+  auto bits = match(matcher, NameTarget::File, "SETUP.EXE", 7);
+  EXPECT_FALSE(bits.test(0));
+  EXPECT_TRUE(bits.test(1));
+  EXPECT_FALSE(bits.test(2));
+  EXPECT_TRUE(bits.test(3));
+  EXPECT_TRUE(bits.test(4));
+  EXPECT_FALSE(bits.test(5));
+  EXPECT_TRUE(bits.test(6));
+
+  bits = match(matcher, NameTarget::File, "makefile", 7);
+  EXPECT_FALSE(bits.test(0));
+  bits = match(matcher, NameTarget::File, "Makefile", 7);
+  EXPECT_TRUE(bits.test(0));
+
+  bits = match(matcher, NameTarget::File, "Product-Installer-x64.MSI", 7);
+  EXPECT_TRUE(bits.test(2));
+  bits = match(matcher, NameTarget::File, "installer.msi.txt", 7);
+  EXPECT_FALSE(bits.test(2));
+
+  bits = match(matcher, NameTarget::Subdirectory, "Assets-2x", 7);
+  EXPECT_TRUE(bits.test(5));
+  EXPECT_FALSE(bits.test(4));
+}
+
+// Fragments that overlap or are suffixes of each other are all reported.
+TEST(NameMatcherTest, FindsOverlappingFragments) {
+  NameMatcher matcher;
+  const std::vector<std::string> patterns = {"*he*", "*she*", "*his*",
+                                             "*hers*", "x*y?z"};
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    matcher.add(NameTarget::File, patterns[i], false,
+                static_cast<std::uint32_t>(i));
+  }
+  matcher.build();
+
+  auto bits = match(matcher, NameTarget::File, "USHERS", patterns.size());
+  EXPECT_TRUE(bits.test(0));
+  EXPECT_TRUE(bits.test(1));
+  EXPECT_FALSE(bits.test(2));
+  EXPECT_TRUE(bits.test(3));
+
+  EXPECT_TRUE(match(matcher, NameTarget::File, "xaayyz", 5).test(4));
+  EXPECT_FALSE(match(matcher, NameTarget::File, "xaayz", 5).test(4));
+}
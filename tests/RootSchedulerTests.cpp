@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "../IOManager.hpp"
+#include "../RootScheduler.hpp"
+#include "../WorkerPool.hpp"
+
+// Verify that every root runs exactly once, no more than the allowed number
+// at a time, and that each gets an equal share of the pool.
+TEST(RootSchedulerTest, RunsEveryRootWithinItsTurns) {
+  constexpr size_t kRoots = 12;
+  std::atomic<int> running = 0;
+  std::atomic<int> peak = 0;
+  std::atomic<int> runs[kRoots] = {};
+
+  const RootScheduler scheduler(3);
+  const RootShare share = scheduler.share(kRoots);
+  EXPECT_EQ(share.io_workers,
+            std::max(1u, WorkerPool::shared().workers(PoolLane::Io) / 3));
+  EXPECT_EQ(share.cpu_workers,
+            std::max(1u, WorkerPool::shared().workers(PoolLane::Cpu) / 3));
+
+  const auto reports =
+      scheduler.run(kRoots, [&](size_t root, const RootShare& given) {
+        EXPECT_EQ(given.io_workers, share.io_workers);
+        const int now = ++running;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        runs[root]++;
+        --running;
+        RootReport report;
+        report.planned = root;
+        return report;
+      });
+
+  ASSERT_EQ(reports.size(), kRoots);
+  EXPECT_LE(peak.load(), 3);
+  for (size_t root = 0; root < kRoots; ++root) {
+    EXPECT_EQ(runs[root].load(), 1) << root;
+    EXPECT_TRUE(reports[root].ran);
+    EXPECT_EQ(reports[root].planned, root);
+  }
+}
+
+// Verify that a root that takes long does not hold up the roots after it:
+// they all finish while the first one is still running.
+TEST(RootSchedulerTest, SlowRootDoesNotStarveTheOthers) {
+  constexpr size_t kRoots = 6;
+  std::atomic<size_t> finished = 0;
+  bool others_finished_first = false;
+
+  RootScheduler(2).run(kRoots, [&](size_t root, const RootShare&) {
+    if (root == 0) {
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (finished < kRoots - 1 &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      others_finished_first = finished == kRoots - 1;
+    } else {
+      ++finished;
+    }
+    return RootReport{};
+  });
+
+  EXPECT_TRUE(others_finished_first);
+}
+
+// Verify that spellings of one folder share its journal, so that moves
+// applied through "dir/" are undone through "dir".
+TEST(RootSchedulerTest, AppliesAndUndoesThroughAnySpelling) {
+  namespace fs = std::filesystem;
+  const fs::path base = fs::temp_directory_path() / "organizer_roots_test_run";
+  fs::remove_all(base);
+  const fs::path target = base / "downloads";
+  fs::create_directories(target);
+  std::ofstream(target / "report.pdf") << "dummy content";
+
+  const fs::path slashed = fs::path(target.string() + "/");
+  EXPECT_EQ(root_key(slashed), root_key(target));
+  const fs::path journal = base / "organizer_journal.json";
+  const std::vector<Action> plan = {{target / "report.pdf",
+                                     target / "Documents" / "report.pdf",
+                                     Category::intern("Documents"),
+                                     ActionType::MOVE}};
+  ASSERT_EQ(IOManager::apply_plan(plan, root_file(journal, slashed)).size(),
+            1u);
+  ASSERT_FALSE(fs::exists(target / "report.pdf"));
+
+  const UndoResult result = IOManager::run_undo(root_file(journal, target));
+  EXPECT_EQ(result.undone, 1u);
+  EXPECT_TRUE(fs::exists(target / "report.pdf"));
+  fs::remove_all(base);
+}
+
+// Verify that a roots file naming one folder twice, under any spelling, is
+// rejected, while distinct folders load.
+TEST(RootSchedulerTest, RejectsTheSameFolderListedTwice) {
+  namespace fs = std::filesystem;
+  const fs::path base = fs::temp_directory_path() / "organizer_roots_dup_test";
+  fs::remove_all(base);
+  fs::create_directories(base / "a");
+  fs::create_directories(base / "b");
+  const fs::path roots = base / "roots.json";
+
+  std::ofstream(roots) << R"([{"target": "a"}, {"target": "b"}])";
+  auto loaded = IOManager::load_roots(roots);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(loaded->size(), 2u);
+
+  std::ofstream(roots, std::ios::trunc)
+      << R"([{"target": "a"}, {"target": "b"}, {"target": "./a/"}])";
+  EXPECT_FALSE(IOManager::load_roots(roots));
+  fs::remove_all(base);
+}
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <format>
 #include <fstream>
+#include <mutex>
 #include <vector>
 
 #include "../RuleEngine.hpp"  // Include the class we want to test
@@ -63,7 +65,7 @@ TEST_F(RuleEngineTest, CorrectlyIdentifiesPdfFile) {
   const auto& action = plan[0];
   EXPECT_EQ(action.from, test_dir / "mydocument.pdf");
   EXPECT_EQ(action.to, test_dir / "Documents" / "mydocument.pdf");
-  EXPECT_EQ(action.reason, "Documents");
+  EXPECT_EQ(action.category.name(), "Documents");
 }
 
 // ===================================================================
@@ -86,7 +88,7 @@ TEST_F(RuleEngineTest, HandlesUncategorizedFileAsOther) {
   EXPECT_EQ(action.from, test_dir / "unclassified.log");
   EXPECT_EQ(action.to.parent_path().filename(),
             "Other");  // Should go to "Other" dir
-  EXPECT_EQ(action.reason, "Other");
+  EXPECT_EQ(action.category.name(), "Other");
 }
 
 // ===================================================================
@@ -121,5 +123,171 @@ TEST_F(RuleEngineTest, CorrectlyIdentifiesProjectFolderByContent) {
   // The action should be to move the entire directory.
   EXPECT_EQ(action.from, project_folder);
   EXPECT_EQ(action.to, test_dir / "Projects" / "my-web-app");
-  EXPECT_EQ(action.reason, "Projects");
-}
\ No newline at end of file
+  EXPECT_EQ(action.category.name(), "Projects");
+}
+// Verify that case-insensitive conditions match regardless of the casing used
+// in config.json or on disk, and that all conditions of a rule must hold.
+TEST_F(RuleEngineTest, CompiledRulesMatchCaseInsensitively) {
+  Config config;
+  Rule installerRule;
+  installerRule.category = "Executables";
+  installerRule.priority = 1;
+  installerRule.conditions.push_back(
+      {"contains_filename_pattern", {"SETUP.exe"}});
+  installerRule.conditions.push_back({"has_no_subdirectories", {}});
+  config.rules.push_back(installerRule);
+
+  CreateDummyFile("tool/Setup.EXE");
+  CreateDummyFile("nested/setup.exe");
+  CreateDummyFile("nested/docs/readme.txt");
+
+  RuleEngine engine(config);
+  std::vector<Action> plan = engine.generate_plan(test_dir);
+
+  ASSERT_EQ(plan.size(), 1);
+  EXPECT_EQ(plan[0].from, test_dir / "tool");
+  EXPECT_EQ(plan[0].category.name(), "Executables");
+}
+
+// Verify that a folder sitting next to an archive of the same name is detected.
+TEST_F(RuleEngineTest, DetectsSubfolderMatchingArchive) {
+  Config config;
+  Rule extractedRule;
+  extractedRule.category = "Projects";
+  extractedRule.priority = 1;
+  extractedRule.conditions.push_back({"subfolder_matches_archive", {}});
+  config.rules.push_back(extractedRule);
+
+  CreateDummyFile("release/App/main.c");
+  CreateDummyFile("release/app.ZIP");
+
+  RuleEngine engine(config);
+  std::vector<Action> plan = engine.generate_plan(test_dir);
+
+  ASSERT_EQ(plan.size(), 1);
+  EXPECT_EQ(plan[0].to, test_dir / "Projects" / "release");
+}
+
+// Verify that a persisted scan index reproduces the same plan on a rescan and
+// that changes to a directory's contents invalidate its cached result.
+TEST_F(RuleEngineTest, ScanIndexReusesAndInvalidatesEntries) {
+  Config config;
+  config.categories[".pdf"] = "Documents";
+  Rule projectRule;
+  projectRule.category = "Projects";
+  projectRule.priority = 1;
+  projectRule.conditions.push_back({"contains_filename", {"Makefile"}});
+  config.rules.push_back(projectRule);
+
+  CreateDummyFile("report.pdf");
+  CreateDummyFile("sources/main.c");
+
+  // Kept outside test_dir so the index itself is not part of the scan.
+  const fs::path index_path =
+      fs::temp_directory_path() / "organizer_test_scan_index.bin";
+  fs::remove(index_path);
+  RuleEngineOptions options;
+  options.scan_index_path = index_path;
+  RuleEngine engine(config, options);
+
+  std::vector<Action> first = engine.generate_plan(test_dir);
+  ASSERT_EQ(first.size(), 1);
+  EXPECT_TRUE(fs::exists(index_path));
+
+  std::vector<Action> second = engine.generate_plan(test_dir);
+  ASSERT_EQ(second.size(), 1);
+  EXPECT_EQ(second[0].to, test_dir / "Documents" / "report.pdf");
+
+  CreateDummyFile("sources/Makefile");
+  std::vector<Action> third = engine.generate_plan(test_dir);
+  EXPECT_EQ(third.size(), 2);
+
+  fs::remove(index_path);
+}
+
+// Verify that a deep scan plans nested files one by one, moves folders that
+// match a folder rule as a whole, and honors the depth limit and exclusions.
+TEST_F(RuleEngineTest, DeepScanFlattensNestedFolders) {
+  Config config;
+  config.categories[".pdf"] = "Documents";
+  Rule projectRule;
+  projectRule.category = "Projects";
+  projectRule.priority = 1;
+  projectRule.conditions.push_back({"contains_filename", {"package.json"}});
+  config.rules.push_back(projectRule);
+
+  CreateDummyFile("intake/batch/report.pdf");
+  CreateDummyFile("intake/batch/b/c/too_deep.pdf");
+  CreateDummyFile("intake/app/package.json");
+  CreateDummyFile("intake/node_modules/vendored.pdf");
+  CreateDummyFile("Documents/organized.pdf");
+
+  RuleEngineOptions options;
+  options.walk.max_depth = 3;
+  options.walk.exclude = {"node_modules"};
+  options.walk.max_workers = 4;
+  RuleEngine engine(config, options);
+  std::vector<Action> plan = engine.generate_plan(test_dir);
+
+  ASSERT_EQ(plan.size(), 2);
+  EXPECT_EQ(plan[0].from, test_dir / "intake" / "app");
+  EXPECT_EQ(plan[0].to, test_dir / "Projects" / "app");
+  EXPECT_EQ(plan[1].from, test_dir / "intake" / "batch" / "report.pdf");
+  EXPECT_EQ(plan[1].to, test_dir / "Documents" / "report.pdf");
+}
+
+// Verify that files without a known extension are classified by their
+// contents when content sniffing is enabled, and only then.
+TEST_F(RuleEngineTest, SniffsContentOfUnknownExtensions) {
+  Config config;
+  config.categories[".pdf"] = "Documents";
+  {
+    std::ofstream(test_dir / "download", std::ios::binary) << "%PDF-1.5\n";
+    std::ofstream(test_dir / "invoice.bin", std::ios::binary) << "%PDF-1.5\n";
+  }
+  CreateDummyFile("notes");
+
+  std::vector<Action> plain = RuleEngine(config).generate_plan(test_dir);
+  EXPECT_TRUE(std::ranges::all_of(
+      plain, [](const Action& a) { return a.category.name() == "Other"; }));
+
+  config.sniff_content = true;
+  std::vector<Action> plan = RuleEngine(config).generate_plan(test_dir);
+  ASSERT_EQ(plan.size(), 3);
+  EXPECT_EQ(plan[0].to, test_dir / "Documents" / "download");
+  EXPECT_EQ(plan[1].to, test_dir / "Documents" / "invoice.bin");
+  EXPECT_EQ(plan[2].to, test_dir / "Other" / "notes");
+}
+
+// Verify that every planned move is streamed to the caller while the scan
+// runs, whichever stage planned it.
+TEST_F(RuleEngineTest, StreamsEveryActionOfTheScan) {
+  Config config;
+  config.categories[".pdf"] = "Documents";
+  Rule projectRule;
+  projectRule.category = "Projects";
+  projectRule.priority = 1;
+  projectRule.conditions.push_back({"contains_filename", {"Makefile"}});
+  config.rules.push_back(projectRule);
+  for (int i = 0; i < 300; ++i) {
+    CreateDummyFile(std::format("report{}.pdf", i));
+    CreateDummyFile(std::format("notes{}", i));
+  }
+  CreateDummyFile("sources/Makefile");
+
+  std::mutex streamed_mutex;
+  std::vector<fs::path> streamed;
+  std::vector<Action> plan = RuleEngine(config).generate_plan(
+      test_dir, std::nullopt, [&](std::span<const Action> batch) {
+        std::scoped_lock lock(streamed_mutex);
+        for (const auto& action : batch) streamed.push_back(action.from);
+      });
+
+  ASSERT_EQ(plan.size(), 601u);
+  std::ranges::sort(streamed);
+  ASSERT_EQ(streamed.size(), plan.size());
+  for (size_t i = 0; i < plan.size(); ++i) {
+    EXPECT_EQ(streamed[i], plan[i].from);
+  }
+  EXPECT_EQ(plan.back().to, test_dir / "Projects" / "sources");
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../SelectionSet.hpp"
+
+// Verify counting, flipping and iteration across word boundaries.
+TEST(SelectionSetTest, TracksBitsAcrossWords) {
+  SelectionSet selections;
+  selections.assign(130, true);
+  EXPECT_EQ(selections.count(), 130u);
+
+  selections.flip(0);
+  selections.flip(64);
+  selections.flip(129);
+  EXPECT_FALSE(selections.test(64));
+  EXPECT_TRUE(selections.test(63));
+  EXPECT_EQ(selections.count(), 127u);
+
+  selections.set_all(false);
+  selections.flip(5);
+  selections.flip(127);
+  std::vector<size_t> selected;
+  selections.for_each_selected([&](size_t i) { selected.push_back(i); });
+  EXPECT_EQ(selected, (std::vector<size_t>{5, 127}));
+  EXPECT_EQ(selections.count(), 2u);
+}
+
+// Verify that appending keeps the existing bits and fills partial words.
+TEST(SelectionSetTest, AppendsWithoutTouchingExistingBits) {
+  SelectionSet selections;
+  selections.append(3, true);
+  selections.flip(1);
+  selections.append(70, false);
+  selections.append(100, true);
+  EXPECT_EQ(selections.size(), 173u);
+  EXPECT_EQ(selections.count(), 102u);
+  EXPECT_TRUE(selections.test(0));
+  EXPECT_FALSE(selections.test(1));
+  EXPECT_FALSE(selections.test(72));
+  EXPECT_TRUE(selections.test(73));
+  EXPECT_TRUE(selections.test(172));
+
+  size_t visited = 0;
+  selections.for_each_selected([&](size_t i) {
+    EXPECT_LT(i, 173u);
+    visited++;
+  });
+  EXPECT_EQ(visited, 102u);
+}
@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
+#include "../WatchDaemon.hpp"
+
 int main(int argc, char** argv) {
+  // As in the application's watch mode: before any thread is started, so
+  // that the watch tests can signal the process safely.
+  WatchDaemon::block_stop_signals();
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include "../TreeWalker.hpp"
+
+TEST(TreeWalkerTest, GlobsMatchNamesAndRelativePaths) {
+  EXPECT_TRUE(glob_match("*.tmp", "download.tmp"));
+  EXPECT_FALSE(glob_match("*.tmp", "cache/download.tmp"));
+  EXPECT_TRUE(glob_match("cache/*", "cache/download.tmp"));
+  EXPECT_TRUE(glob_match("**/build", "build"));
+  EXPECT_TRUE(glob_match("**/build", "src/app/build"));
+  EXPECT_TRUE(glob_match("src/**/*.o", "src/a/b/main.o"));
+  EXPECT_TRUE(glob_match("file?.txt", "file1.txt"));
+  EXPECT_FALSE(glob_match("file?.txt", "file10.txt"));
+}
+
+// A tree with one large subtree is walked completely by several workers,
+// and entries below the depth limit or excluded are never visited.
+TEST(TreeWalkerTest, WalksWholeTreeInParallel) {
+  const fs::path root = fs::temp_directory_path() / "organizer_walker_test";
+  fs::remove_all(root);
+  for (int d = 0; d < 20; ++d) {
+    const fs::path dir = root / "big" / std::format("sub{}", d);
+    fs::create_directories(dir / "deeper");
+    for (int f = 0; f < 50; ++f) {
+      std::ofstream(dir / std::format("file{}.txt", f));
+    }
+    std::ofstream(dir / "deeper" / "hidden.txt");
+  }
+  fs::create_directories(root / "skip");
+  std::ofstream(root / "skip" / "file.txt");
+
+  TreeWalkOptions options;
+  options.max_depth = 2;
+  options.exclude = {"skip", "big/sub1*"};
+  options.max_workers = 4;
+
+  std::mutex mutex;
+  std::multiset<fs::path> visited;
+  auto stats = TreeWalker(options).walk(
+      root, [&](const WalkEntry& entry, unsigned, bool can_descend) {
+        std::scoped_lock lock(mutex);
+        visited.insert(entry.path);
+        return can_descend;
+      });
+
+  ASSERT_TRUE(stats);
+  // "big", the 9 subdirectories not excluded, and the 51 entries of each.
+  EXPECT_EQ(stats->entries, 1 + 9 + 9 * 51);
+  EXPECT_EQ(visited.size(), stats->entries);
+  EXPECT_EQ(stats->excluded, 1 + 11);
+  EXPECT_EQ(visited.count(root / "big" / "sub0" / "file0.txt"), 1);
+  EXPECT_EQ(visited.count(root / "big" / "sub0" / "deeper"), 1);
+  EXPECT_EQ(visited.count(root / "big" / "sub0" / "deeper" / "hidden.txt"), 0);
+
+  EXPECT_FALSE(TreeWalker().walk(root / "missing",
+                                 [](const auto&, unsigned, bool) {
+                                   return false;
+                                 }));
+  fs::remove_all(root);
+}
+
+// A batch whose preparation throws is skipped, and the walk still finishes
+// with the other workers instead of waiting for it.
+TEST(TreeWalkerTest, FinishesWhenPreparingABatchThrows) {
+  const fs::path root = fs::temp_directory_path() / "organizer_walker_throw";
+  fs::remove_all(root);
+  for (int d = 0; d < 8; ++d) {
+    const fs::path dir = root / std::format("sub{}", d);
+    fs::create_directories(dir);
+    std::ofstream(dir / "file.txt");
+  }
+
+  TreeWalkOptions options;
+  options.max_workers = 4;
+  std::atomic<size_t> visited = 0;
+  auto stats = TreeWalker(options).walk(
+      root,
+      [&](const WalkEntry&, unsigned, bool can_descend) {
+        visited++;
+        return can_descend;
+      },
+      {},
+      [](std::vector<WalkEntry>& batch, unsigned depth) {
+        if (depth == 1 && batch.front().path.parent_path().filename() ==
+                              "sub3") {
+          throw std::runtime_error("prepare failed");
+        }
+      });
+
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(visited.load(), 8u + 7u);
+  fs::remove_all(root);
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Journal.hpp"
+#include "../UndoEngine.hpp"
+
+namespace fs = std::filesystem;
+
+class UndoEngineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_undo_test_run";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+    journal_path = test_dir / "journal.json";
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  // Performs a move and journals it the way the executor would.
+  void Move(Journal::Writer& journal, const fs::path& from, const fs::path& to,
+            const std::string& category, std::int64_t time_ms) {
+    fs::create_directories(to.parent_path());
+    fs::rename(from, to);
+    ASSERT_TRUE(journal.append({ActionType::MOVE, from, to, category,
+                                time_ms}));
+  }
+
+  void CreateDummyFile(const fs::path& path) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << "dummy content";
+  }
+
+  fs::path test_dir;
+  fs::path journal_path;
+};
+
+// Verify that a chain of moves through the same paths is reverted in order
+// across batch boundaries, alongside many independent moves.
+TEST_F(UndoEngineTest, RevertsChainsAndIndependentMoves) {
+  {
+    auto journal = Journal::Writer::open(journal_path);
+    ASSERT_NE(journal, nullptr);
+    for (int i = 0; i < 50; ++i) {
+      const fs::path file = test_dir / std::format("file{}.txt", i);
+      CreateDummyFile(file);
+      Move(*journal, file, test_dir / "Documents" / file.filename(),
+           "Documents", 1000 + i);
+    }
+    // a -> b, then the new b -> c: undo must revert c -> b before b -> a.
+    CreateDummyFile(test_dir / "a.txt");
+    Move(*journal, test_dir / "a.txt", test_dir / "b.txt", "Other", 2000);
+    Move(*journal, test_dir / "b.txt", test_dir / "c.txt", "Other", 2001);
+  }
+
+  UndoOptions options;
+  options.batch_size = 7;
+  UndoResult result = UndoEngine(options).run(journal_path);
+
+  EXPECT_EQ(result.undone, 52u);
+  EXPECT_EQ(result.failed, 0u);
+  EXPECT_TRUE(fs::exists(test_dir / "a.txt"));
+  EXPECT_FALSE(fs::exists(test_dir / "c.txt"));
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_TRUE(fs::exists(test_dir / std::format("file{}.txt", i)));
+  }
+  EXPECT_FALSE(fs::exists(journal_path));
+}
+
+// Verify that only the selected category and time range are reverted, and
+// that the rest stays in the journal.
+TEST_F(UndoEngineTest, SelectsByCategoryAndTime) {
+  {
+    auto journal = Journal::Writer::open(journal_path);
+    for (int i = 0; i < 4; ++i) {
+      const std::string category = i % 2 ? "Images" : "Archives";
+      const fs::path file = test_dir / std::format("f{}.bin", i);
+      CreateDummyFile(file);
+      Move(*journal, file, test_dir / category / file.filename(), category,
+           (i + 1) * 1000);
+    }
+  }
+
+  UndoFilter filter;
+  filter.categories = {"Images"};
+  filter.since = std::chrono::system_clock::time_point(
+      std::chrono::milliseconds(3000));
+  UndoResult result = UndoEngine().run(journal_path, filter);
+
+  EXPECT_EQ(result.undone, 1u);
+  EXPECT_EQ(result.skipped, 3u);
+  EXPECT_TRUE(fs::exists(test_dir / "f3.bin"));
+  EXPECT_TRUE(fs::exists(test_dir / "Images" / "f1.bin"));
+
+  auto remaining = Journal::read(journal_path);
+  ASSERT_EQ(remaining.size(), 3u);
+  EXPECT_EQ(remaining[0].from, test_dir / "f0.bin");
+  EXPECT_EQ(remaining[2].from, test_dir / "f2.bin");
+}
+
+// Verify that lines undo cannot parse stay in the journal, including when
+// they are all that is left.
+TEST_F(UndoEngineTest, KeepsUnreadableRecords) {
+  {
+    auto journal = Journal::Writer::open(journal_path);
+    CreateDummyFile(test_dir / "a.txt");
+    Move(*journal, test_dir / "a.txt", test_dir / "Other" / "a.txt", "Other",
+         1000);
+  }
+  std::ofstream(journal_path, std::ios::app) << "not a journal record\n";
+
+  UndoResult result = UndoEngine().run(journal_path);
+  EXPECT_EQ(result.undone, 1u);
+  EXPECT_TRUE(fs::exists(test_dir / "a.txt"));
+
+  std::ifstream in(journal_path);
+  std::string line;
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "not a journal record");
+  EXPECT_FALSE(std::getline(in, line));
+
+  // Only the unreadable record is left; it survives a second run.
+  result = UndoEngine().run(journal_path);
+  EXPECT_EQ(result.undone, 0u);
+  EXPECT_TRUE(fs::exists(journal_path));
+}
+
+#ifndef _WIN32
+// Verify that a deleted duplicate comes back with the kept copy's contents,
+// permissions and modification time.
+TEST_F(UndoEngineTest, RestoresDeletedDuplicateWithMetadata) {
+  const fs::path kept = test_dir / "Documents" / "report.pdf";
+  const fs::path removed = test_dir / "report.pdf";
+  CreateDummyFile(kept);
+  fs::permissions(kept, fs::perms::owner_read | fs::perms::group_read);
+  const auto mtime = fs::last_write_time(kept) - std::chrono::hours(24);
+  fs::last_write_time(kept, mtime);
+  {
+    auto journal = Journal::Writer::open(journal_path);
+    ASSERT_TRUE(journal->append(
+        {ActionType::REMOVE, removed, kept, "Documents", 1000}));
+  }
+
+  const UndoResult result = UndoEngine().run(journal_path);
+  EXPECT_EQ(result.undone, 1u);
+  ASSERT_TRUE(fs::exists(removed));
+  std::ifstream in(removed);
+  EXPECT_EQ(std::string(std::istreambuf_iterator<char>(in), {}),
+            "dummy content");
+  EXPECT_EQ(fs::status(removed).permissions(),
+            fs::perms::owner_read | fs::perms::group_read);
+  EXPECT_EQ(fs::last_write_time(removed), mtime);
+  EXPECT_TRUE(fs::exists(kept));
+}
+#endif
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <stop_token>
+#include <thread>
+
+#include "../WatchDaemon.hpp"
+#include "../types.hpp"
+
+#ifdef __linux__
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+class WatchDaemonTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir = fs::temp_directory_path() / "organizer_watch_test_run";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    fs::remove_all(test_dir, ec);
+  }
+
+  fs::path test_dir;
+};
+
+#ifdef __linux__
+// Verify that a SIGTERM sent to the process from another thread stops the
+// daemon through its signalfd instead of killing the process. TestMain
+// blocks the signals before any thread starts, as main() does.
+TEST_F(WatchDaemonTest, StopsOnSigtermFromAnotherThread) {
+  Config config;
+  RuleEngine engine(config);
+  WatchOptions options;
+  options.initial_scan = false;
+  options.journal_path = test_dir / "journal.json";
+  WatchDaemon daemon(engine, test_dir, options);
+
+  std::stop_source fallback;
+  auto running = std::async(std::launch::async, [&] {
+    return daemon.run(fallback.get_token());
+  });
+  std::jthread sender([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ::kill(::getpid(), SIGTERM);
+  });
+
+  const bool stopped =
+      running.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+  if (!stopped) fallback.request_stop();
+  EXPECT_TRUE(stopped);
+  EXPECT_TRUE(running.get());
+
+  // The signal was consumed, not left pending for the rest of the process.
+  sigset_t pending;
+  sigpending(&pending);
+  EXPECT_FALSE(sigismember(&pending, SIGTERM));
+}
+#endif
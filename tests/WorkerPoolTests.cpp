@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "../WorkerPool.hpp"
+
+// Every index is visited exactly once, and nested parallel loops finish even
+// when every worker of the lane is already busy with an outer iteration.
+TEST(WorkerPoolTest, RunsNestedLoopsWithoutStarving) {
+  std::atomic<int> sum = 0;
+  {
+    WorkerPool pool({.cpu_workers = 2, .io_workers = 1});
+    std::vector<std::atomic<int>> visits(64);
+    pool.for_each_index(PoolLane::Io, 8, [&](size_t outer) {
+      pool.for_each_index(PoolLane::Io, 8, [&](size_t inner) {
+        visits[outer * 8 + inner]++;
+      });
+    });
+    for (const auto& count : visits) EXPECT_EQ(count.load(), 1);
+
+    pool.async(PoolLane::Cpu, [&] {
+          pool.for_each_index(PoolLane::Cpu, 100, [&](size_t) { sum += 2; });
+        }).get();
+    EXPECT_EQ(sum.load(), 200);
+    pool.submit(PoolLane::Cpu, [&] { sum += 1; });
+
+    const WorkerPoolStats stats = pool.stats();
+    EXPECT_EQ(stats.cpu.workers, 2u);
+    EXPECT_EQ(stats.io.workers, 1u);
+    EXPECT_GE(stats.cpu.peak_queued, 1u);
+  }
+  // The destructor runs what is still queued.
+  EXPECT_EQ(sum.load(), 201);
+}
+
+// A stop request ends the loop early; a thrown exception reaches the caller
+// once every running slot has returned.
+TEST(WorkerPoolTest, StopsAndPropagatesErrors) {
+  WorkerPool pool({.cpu_workers = 3, .io_workers = 1});
+  std::stop_source stop;
+  std::atomic<size_t> visited = 0;
+  pool.for_each_index(
+      PoolLane::Cpu, 100000,
+      [&](size_t i) {
+        visited++;
+        if (i == 10) stop.request_stop();
+      },
+      stop.get_token());
+  EXPECT_LT(visited.load(), 100000u);
+
+  EXPECT_THROW(pool.for_each_index(PoolLane::Cpu, 50,
+                                   [](size_t i) {
+                                     if (i == 7) throw std::runtime_error("x");
+                                   }),
+               std::runtime_error);
+  auto failed = pool.async(PoolLane::Io,
+                           [] { throw std::runtime_error("async"); });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+}
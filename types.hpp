@@ -1,10 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
 
+#include "Category.hpp"
+
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
@@ -24,6 +27,10 @@ inline void from_json(const json& j, Condition& c) {
   }
 }
 
+inline void to_json(json& j, const Condition& c) {
+  j = json{{"type", c.type}, {"values", c.values}, {"threshold", c.threshold}};
+}
+
 struct Rule {
   std::string category;
   int priority;
@@ -34,19 +41,53 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Rule, category, priority, conditions);
 struct Config {
   std::unordered_map<std::string, std::string> categories;
   std::vector<Rule> rules;
+  // Files with an unknown extension are classified by their contents.
+  bool sniff_content = false;
 };
 
-enum class ActionType { MOVE };
-NLOHMANN_JSON_SERIALIZE_ENUM(ActionType, {{ActionType::MOVE, "MOVE"}});
+// A target folder of a multi-root run and the config it is organized by;
+// empty for the default config.
+struct RootSpec {
+  fs::path target;
+  fs::path config;
+};
+
+// MOVE relocates `from` to `to`. The others resolve a duplicate `from`
+// against the identical file at `to`, which is left untouched.
+enum class ActionType { MOVE, REMOVE, HARDLINK, REFLINK };
+NLOHMANN_JSON_SERIALIZE_ENUM(ActionType, {{ActionType::MOVE, "MOVE"},
+                                          {ActionType::REMOVE, "REMOVE"},
+                                          {ActionType::HARDLINK, "HARDLINK"},
+                                          {ActionType::REFLINK, "REFLINK"}});
+// How a MOVE was carried out: a rename within one filesystem, or a copy to
+// another one followed by removing the source.
+enum class MoveMethod : std::uint8_t {
+  Rename,
+  CopyFileRange,
+  Sendfile,
+  Buffered
+};
+NLOHMANN_JSON_SERIALIZE_ENUM(MoveMethod,
+                             {{MoveMethod::Rename, "rename"},
+                              {MoveMethod::CopyFileRange, "copy_file_range"},
+                              {MoveMethod::Sendfile, "sendfile"},
+                              {MoveMethod::Buffered, "buffered"}});
 struct JournalEntry {
-  ActionType action;
+  ActionType action = ActionType::MOVE;
   fs::path from;
   fs::path to;
+  // The category that caused the move, and when it completed (Unix time in
+  // milliseconds). Both are empty in journals written by older versions.
+  std::string category;
+  std::int64_t time_ms = 0;
+  MoveMethod method = MoveMethod::Rename;
 };
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(JournalEntry, action, from, to);
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(JournalEntry, action, from, to,
+                                                category, time_ms, method);
 
 struct Action {
   fs::path from;
   fs::path to;
-  std::string reason;
+  Category category;
+  ActionType type = ActionType::MOVE;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <format>
 #include <string>
@@ -16,44 +17,19 @@ inline std::string safe_path_to_string(const fs::path& p) {
                      u8str.length());
 }
 
-// A simple, locale-independent function to convert a string to lowercase.
-// It only handles basic ASCII characters, which is safe and sufficient for
-// things like file extensions and common keywords.
-inline std::string string_to_lower_ascii(std::string_view sv) {
-  std::string result;
-  result.reserve(sv.length());
-  for (char c : sv) {
-    if (c >= 'A' && c <= 'Z') {
-      result += static_cast<char>(c + ('a' - 'A'));
-    } else {
-      result += c;
-    }
-  }
-  return result;
+// The inverse of safe_path_to_string: builds a path from UTF-8 text.
+inline fs::path path_from_utf8(std::string_view utf8) {
+  return fs::path(std::u8string(reinterpret_cast<const char8_t*>(utf8.data()),
+                                utf8.size()));
 }
 
-// Generates a unique path by appending a number (e.g., "file (1).txt")
-// if the target path already exists. This prevents overwriting files.
-inline fs::path generate_unique_path(const fs::path& target_path) {
-  if (!fs::exists(target_path)) {
-    return target_path;
+// 64-bit FNV-1a hash. Stable across builds and platforms, so it can be used
+// for values that are persisted to disk.
+inline std::uint64_t fnv1a_64(std::string_view data,
+                              std::uint64_t hash = 14695981039346656037ull) {
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 1099511628211ull;
   }
-
-  const fs::path parent_dir = target_path.parent_path();
-  const std::string stem_str = safe_path_to_string(target_path.stem());
-  const fs::path ext = target_path.extension();
-
-  int counter = 1;
-  fs::path new_path;
-  do {
-    // Construct the new filename from UTF-8 strings
-    const std::string new_filename_str =
-        std::format("{} ({}){}", stem_str, counter++, safe_path_to_string(ext));
-    // Modern C++20/23 way to construct UTF-8 path: cast to char8_t*
-    new_path =
-        parent_dir /
-        fs::path(reinterpret_cast<const char8_t*>(new_filename_str.c_str()));
-  } while (fs::exists(new_path));
-
-  return new_path;
-}
\ No newline at end of file
+  return hash;
+}